@@ -1,5 +1,6 @@
 #!/usr/bin/env python3
 import argparse
+import glob
 import os
 import platform
 import shutil
@@ -65,9 +66,16 @@ def clean() -> int:
         "iris.log",
         "tests/fixture/read_only.txt",
         "tests/fixture/temp_file.txt",
+        "tests/fixture/large_temp_file.txt",
+        "tests/fixture/temp_save_file.txt",
+        "tests/fixture/temp_edit_file.txt",
+        "tests/fixture/temp_journal_file.txt",
         "tests/fixture/does_not_exist.txt",
     ]
 
+    # Journals left behind by killing iris mid-test
+    files.extend(glob.glob("tests/fixture/.*.iris-swp"))
+
     for file in files:
         if os.path.isfile(file):
             print(f"[LOG] Removing {file}")
@@ -4,7 +4,6 @@
 #include <cstdint>
 #include <optional>
 
-#include "change.h"
 #include "controller.h"
 #include "spdlog/spdlog.h"
 #include "view.h"
@@ -76,34 +75,14 @@ template <typename T, typename U>
                     return Redraw(RedrawType::None);
                 }
 
-                // For cursor movement
-                std::size_t prev_line_len = 0;
-                if (v->get_active_model()->current_line > 0) {
-                    prev_line_len = v->get_active_model()
-                                        ->buf.at(v->get_active_model()->current_line - 1)
-                                        .size();
-                }
-
-                // Log for undo
-                char prev_char = '\n';
-                if (v->get_active_model()->current_char > 0) {
-                    prev_char = v->get_active_model()
-                                    ->buf.at(v->get_active_model()->current_line)
-                                    .at(v->get_active_model()->current_char - 1);
-                }
-
-                v->get_active_model()->undo_stack.push_back(Change(
-                    ActionType::Backspace, v->get_active_model()->current_line,
-                    v->get_active_model()->current_char, prev_char));
-
-                // actual backspace
+                v->get_active_model()->begin_undo_group();
                 Redraw ret = v->get_active_model()->backspace();
-                if (ret.type == RedrawType::Screen) {
-                    v->cur.move_up();
-                    v->cur.move_right(int32_t(prev_line_len));
-                } else {
-                    v->cur.move_left(ret.count);
-                }
+                v->get_active_model()->end_undo_group();
+                if (ret.type == RedrawType::Screen) { v->cur.move_up(); }
+
+                // NOTE: A deleted tab can take up more than one column, so
+                // place the cursor from the model rather than by `ret.count`
+                v->cur.move(v->cur.vertical, v->screen_column());
 
                 return ret;
             }
@@ -117,10 +96,9 @@ template <typename T, typename U>
             auto logger = spdlog::get("basic_logger");
             if (logger != nullptr) { logger->info("Action called: DedentLine"); }
 
-            v->get_active_model()->undo_stack.push_back(
-                Change(ActionType::DedentLine, v->get_active_model()->current_line, ' '));
-
+            v->get_active_model()->begin_undo_group();
             v->get_active_model()->dedent_curr_line();
+            v->get_active_model()->end_undo_group();
         } break;
 
         case ActionType::DelCurrentChar: {
@@ -128,13 +106,11 @@ template <typename T, typename U>
                 auto logger = spdlog::get("basic_logger");
                 if (logger != nullptr) { logger->info("Action called: DelCurrentChar"); }
 
-                v->get_active_model()->undo_stack.push_back(Change(
-                    ActionType::DelCurrentChar, v->get_active_model()->current_line,
-                    v->get_active_model()->current_char,
-                    v->get_active_model()->get_current_char()));
+                v->get_active_model()->begin_undo_group();
                 v->cursor_right(1);
                 Redraw ret = v->get_active_model()->backspace();
-                v->cur.move_left();
+                v->get_active_model()->end_undo_group();
+                v->cur.move(v->cur.vertical, v->screen_column());
 
                 return ret;
             }
@@ -144,12 +120,9 @@ template <typename T, typename U>
             auto logger = spdlog::get("basic_logger");
             if (logger != nullptr) { logger->info("Action called: DelCurrentLine"); }
 
-            v->get_active_model()->undo_stack.push_back(Change(
-                ActionType::DelCurrentLine, v->get_active_model()->current_line,
-                v->get_active_model()->current_char,
-                v->get_active_model()->buf.at(v->get_active_model()->current_line)));
-
+            v->get_active_model()->begin_undo_group();
             v->get_active_model()->delete_current_line();
+            v->get_active_model()->end_undo_group();
             v->change_model_cursor();
             v->draw_screen();
         } break;
@@ -161,11 +134,9 @@ template <typename T, typename U>
             const std::optional<WordPos> word = v->get_active_model()->current_word();
             if (!word.has_value()) { break; }
 
-            v->get_active_model()->undo_stack.push_back(Change(
-                ActionType::DelCurrentWord, v->get_active_model()->current_line,
-                word.value().start_pos, word.value().text));
-
+            v->get_active_model()->begin_undo_group();
             v->get_active_model()->delete_current_word(word.value());
+            v->get_active_model()->end_undo_group();
         } break;
 
         case ActionType::EndOfLine: {
@@ -178,10 +149,9 @@ template <typename T, typename U>
         case ActionType::IndentLine: {
             auto logger = spdlog::get("basic_logger");
             if (logger != nullptr) { logger->info("Action called: IndentLine"); }
+            v->get_active_model()->begin_undo_group();
             v->get_active_model()->indent_curr_line();
-
-            v->get_active_model()->undo_stack.push_back(
-                Change(ActionType::IndentLine, v->get_active_model()->current_line, ' '));
+            v->get_active_model()->end_undo_group();
         } break;
 
         case ActionType::JumpEndOfWord: {
@@ -275,7 +245,9 @@ template <typename T, typename U>
             auto logger = spdlog::get("basic_logger");
             if (logger != nullptr) { logger->info("Action called: MoveLineDown"); }
 
+            v->get_active_model()->begin_undo_group();
             bool actionable = v->get_active_model()->move_line_down();
+            v->get_active_model()->end_undo_group();
             if (actionable) { v->cursor_down(); }
             return {};
         } break;
@@ -284,7 +256,9 @@ template <typename T, typename U>
             auto logger = spdlog::get("basic_logger");
             if (logger != nullptr) { logger->info("Action called: MoveLineUp"); }
 
+            v->get_active_model()->begin_undo_group();
             bool actionable = v->get_active_model()->move_line_up();
+            v->get_active_model()->end_undo_group();
             if (actionable) { v->cursor_up(); }
             return {};
         } break;
@@ -293,20 +267,16 @@ template <typename T, typename U>
             auto logger = spdlog::get("basic_logger");
             if (logger != nullptr) { logger->info("Action called: Newline"); }
 
-            v->get_active_model()->undo_stack.push_back(Change(
-                ActionType::Newline, v->get_active_model()->current_line,
-                v->get_active_model()->current_char));
-
-            const std::size_t count = v->get_active_model()->newline();
+            v->get_active_model()->begin_undo_group();
+            std::ignore = v->get_active_model()->newline();
+            v->get_active_model()->end_undo_group();
             if (!(v->cur.vertical == v->view_size.vertical - 2)) {
                 v->cur.move_down();
             } else {
                 v->get_active_model()->view_offset++;
             }
 
-            for (std::size_t i = 0; i < count; i++) {
-                v->cur.move_left();
-            }
+            v->cur.move(v->cur.vertical, v->screen_column());
 
             return {};
         } break;
@@ -343,12 +313,9 @@ template <typename T, typename U>
             auto logger = spdlog::get("basic_logger");
             if (logger != nullptr) { logger->info("Action called: Newline"); }
 
+            v->get_active_model()->begin_undo_group();
             v->get_active_model()->toggle_case();
-
-            v->get_active_model()->undo_stack.push_back(Change(
-                ActionType::ToggleCase, v->get_active_model()->current_line,
-                v->get_active_model()->current_char));
-
+            v->get_active_model()->end_undo_group();
         } break;
 
         case ActionType::TriggerRedo: {
@@ -356,7 +323,9 @@ template <typename T, typename U>
                 auto logger = spdlog::get("basic_logger");
                 if (logger != nullptr) { logger->info("Action called: TriggerRedo"); }
 
-                return v->get_active_model()->redo(v->view_size.horizontal);
+                const bool redraw = v->get_active_model()->redo(v->view_size.horizontal);
+                v->change_model_cursor();
+                return redraw;
             }
 
             return {};
@@ -367,7 +336,9 @@ template <typename T, typename U>
                 auto logger = spdlog::get("basic_logger");
                 if (logger != nullptr) { logger->info("Action called: TriggerUndo"); }
 
-                return v->get_active_model()->undo(v->view_size.horizontal);
+                const bool redraw = v->get_active_model()->undo(v->view_size.horizontal);
+                v->change_model_cursor();
+                return redraw;
             }
 
             return {};
@@ -447,12 +418,10 @@ template <typename T, typename U>
                 auto logger = spdlog::get("basic_logger");
                 if (logger != nullptr) { logger->info("Action called: InsertChar"); }
 
+                v->get_active_model()->begin_undo_group();
                 v->get_active_model()->insert(action.payload);
+                v->get_active_model()->end_undo_group();
                 v->cur.move_right();
-
-                v->get_active_model()->undo_stack.push_back(Change(
-                    ActionType::InsertChar, v->get_active_model()->current_line,
-                    v->get_active_model()->current_char, action.payload));
             }
             return {};
         } break;
@@ -462,11 +431,9 @@ template <typename T, typename U>
                 auto logger = spdlog::get("basic_logger");
                 if (logger != nullptr) { logger->info("Action called: ReplaceChar"); }
 
-                v->get_active_model()->undo_stack.push_back(Change(
-                    ActionType::ReplaceChar, v->get_active_model()->current_line,
-                    v->get_active_model()->current_char,
-                    v->get_active_model()->get_current_char()));
+                v->get_active_model()->begin_undo_group();
                 v->get_active_model()->replace_char(action.payload);
+                v->get_active_model()->end_undo_group();
             }
         } break;
 
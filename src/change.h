@@ -1,27 +1,37 @@
 #ifndef CHANGE_H
 #define CHANGE_H
 
-#include <optional>
+#include <cstddef>
 #include <string>
+#include <vector>
 
 using uint_t = unsigned int;
 
-// Forward declare to prevent circular header includes
-enum class ActionType;
+// Lines [first, first + after.size()) of the buffer, which were `before`
+// until the edit was made
+struct Hunk {
+    std::size_t first = 0;
+    std::vector<std::string> before = {};
+    std::vector<std::string> after = {};
+};
 
+// One step of undo: everything a command, or a visit to Write mode, changed.
+// Its hunks are kept in the order they were made, each in the line numbers of
+// the buffer at the time
 struct Change {
-    const ActionType action;
-    const uint_t line_pos;
-    const uint_t char_pos;
-    std::optional<char> payload;
-    std::optional<const std::string> text;
+    std::vector<Hunk> hunks = {};
+    // Where the cursor was when it was started
+    uint_t line_pos = 0;
+    uint_t char_pos = 0;
+};
 
-    Change(const ActionType a, const uint_t ln, const uint_t ch)
-        : action(a), line_pos(ln), char_pos(ch) {}
-    Change(const ActionType a, const uint_t ln, const uint_t ch, const char c)
-        : action(a), line_pos(ln), char_pos(ch), payload(c) {}
-    Change(const ActionType a, const uint_t ln, const uint_t ch, const std::string str)
-        : action(a), line_pos(ln), char_pos(ch), text(str) {}
+// The change being put together while an undo group is open (see
+// `Model::begin_undo_group`). Only the last hunk is still growing, and `end`
+// is where it ends in the buffer as it is now
+struct UndoGroup {
+    std::size_t depth = 0;
+    Change change = {};
+    std::size_t end = 0;
 };
 
 #endif  // CHANGE_H
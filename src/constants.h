@@ -8,6 +8,36 @@
 const bool LINE_NUMBERS = true;
 const int TAB_SIZE = 4;
 const std::size_t LINE_BORDER = 100;
+// Files at least this big are split into lines across multiple threads
+const std::size_t PARALLEL_LOAD_SIZE = 8 * 1024 * 1024;
+// Files at least this big only load the first screen before the editor opens,
+// the rest is read in the background a chunk at a time
+const std::size_t STREAMING_LOAD_SIZE = 32 * 1024 * 1024;
+const std::size_t STREAMING_CHUNK_SIZE = 4 * 1024 * 1024;
+// Read-only files at least this big are never fully loaded, only the pages
+// around the viewport are kept in memory
+const std::size_t PAGED_LOAD_SIZE = 256 * 1024 * 1024;
+const std::size_t PAGE_BYTES = 1024 * 1024;
+const std::size_t PAGE_CACHE_SIZE = 16;
+// Files at least this big are kept in a gap buffer of lines, and at least
+// PIECE_TABLE_SIZE in a piece table, so adding or removing a line doesn't
+// shift every line after it. Buffers not made from a file use a piece table
+// from PIECE_TABLE_LINES
+const std::size_t GAP_BUFFER_SIZE = 1024 * 1024;
+const std::size_t PIECE_TABLE_SIZE = 16 * 1024 * 1024;
+const std::size_t PIECE_TABLE_LINES = 100000;
+// Lines loaded into an arena are packed into slabs of at least this size
+const std::size_t ARENA_SLAB_SIZE = 1024 * 1024;
+// How often unsaved edits are flushed to the crash recovery journal
+const int JOURNAL_SYNC_MS = 1000;
+// Undo history past this many bytes is moved out of memory into its file, to
+// be read back if it's undone that far
+const std::size_t UNDO_MEMORY_BUDGET = 8 * 1024 * 1024;
+// Buffers kept in a rope or piece table keep a copy of themselves this often in
+// their undo history, so a jump through a lot of it only has to redo the last
+// few changes
+const std::size_t UNDO_SNAPSHOT_INTERVAL = 1000;
+const std::size_t UNDO_SNAPSHOTS = 64;
 
 const rawterm::Color COLOR_UI_BG = rawterm::Colors::gray;
 const rawterm::Color COLOR_DARK_YELLOW = rawterm::Color("#FFdd33");
@@ -5,6 +5,8 @@
 #include <format>
 #include <optional>
 #include <ranges>
+#include <unordered_map>
+#include <utility>
 
 #include <rawterm/core.h>
 #include <rawterm/cursor.h>
@@ -14,11 +16,48 @@
 
 #include "action.h"
 #include "constants.h"
-#include "enumerate.h"
+#include "journal.h"
+#include "parallel.h"
 #include "view.h"
 
+[[nodiscard]] static std::string failed_saves_message(const std::vector<std::string>& files) {
+    std::string msg = "Could not save ";
+    for (std::size_t i = 0; i < files.size(); i++) {
+        if (i) { msg += ", "; }
+        msg += files.at(i);
+    }
+
+    return msg;
+}
+
+[[nodiscard]] static std::string in_use_message(const std::string& filename) {
+    return std::format("{} is being edited in another buffer or instance of iris", filename);
+}
+
+// How far `;earlier` or `;later` should go: a number of changes, or with a
+// unit of s, m, h or d after it, a number of seconds
+[[nodiscard]] static std::optional<std::pair<int64_t, bool>> travel_amount(
+    const std::string& arg) {
+    static const std::unordered_map<char, int64_t> units = {
+        {'s', 1}, {'m', 60}, {'h', 60 * 60}, {'d', 24 * 60 * 60}};
+
+    std::size_t end = 0;
+    int64_t count = 0;
+    try {
+        count = std::stoll(arg, &end);
+    } catch (const std::invalid_argument& e) {
+        return {};
+    } catch (const std::out_of_range& e) {
+        return {};
+    }
+
+    if (count < 0) { return {}; }
+    if (end == arg.size()) { return std::pair(count, false); }
+    if (end + 1 != arg.size() || !units.contains(arg.at(end))) { return {}; }
+    return std::pair(count * units.at(arg.at(end)), true);
+}
+
 Controller::Controller() : term_size(rawterm::get_term_size()), view(View(this, term_size)) {
-    models.reserve(8);
     meta_buffers.reserve(8);
 }
 
@@ -28,6 +67,14 @@ void Controller::set_mode(Mode m) {
     }
 
     mode = m;
+    if (view.view_models.size()) {
+        if (m == Mode::Write) {
+            view.get_active_model()->start_typing();
+        } else {
+            view.get_active_model()->stop_typing();
+        }
+    }
+
     switch (m) {
         case Mode::Read:
             rawterm::Cursor::cursor_block();
@@ -56,27 +103,33 @@ void Controller::set_mode(Mode m) {
 
 void Controller::create_view(const Flags& flags) {
     if (flags.file.empty()) {
-        models.emplace_back(term_size.vertical - 2, "NO NAME");
-        view.add_model(&models.at(models.size() - 1));
+        view.add_model(models.emplace(term_size.vertical - 2, "NO NAME"));
     } else {
         auto logger = spdlog::get("basic_logger");
         if (logger != nullptr) { logger->info("Creating view from file: " + flags.file); }
 
-        opt_lines_t file_chars = open_file(flags.file);
+        std::optional<OpenedFile> opened =
+            open_text_buffer(flags.file, std::size_t(term_size.vertical), flags.readonly);
 
-        if (file_chars.has_value()) {
-            models.emplace_back(file_chars.value(), flags.file);
-            view.add_model(&models.at(models.size() - 1));
+        if (opened.has_value()) {
+            const ModelHandle handle = models.emplace(std::move(opened.value().buf), flags.file);
+            Model* model = models.get(handle);
+            model->loader = std::move(opened.value().rest);
+            view.add_model(handle);
 
             if (flags.lineno) {
-                std::size_t line_num =
-                    std::min(flags.lineno, models.at(models.size() - 1).buf.size());
-                view.cursor_down(uint32_t(std::min(line_num - 1, file_chars.value().size())));
+                if (flags.lineno > model->line_count()) {
+                    model->wait_for_load();
+                    view.set_lineno_offset(model);
+                }
+
+                std::size_t line_num = std::min(flags.lineno, model->line_count());
+                view.cursor_down(uint32_t(line_num - 1));
                 view.center_current_line();
             }
         } else {
-            models.emplace_back(term_size.vertical - 2, (flags.file.empty() ? "" : flags.file));
-            view.add_model(&models.at(models.size() - 1));
+            view.add_model(
+                models.emplace(term_size.vertical - 2, (flags.file.empty() ? "" : flags.file)));
         }
 
         if (flags.readonly) { view.get_active_model()->readonly = true; }
@@ -92,6 +145,7 @@ void Controller::start_action_engine() {
         if (redraw_all) {
             view.draw_screen();
             redraw_all = false;
+            offer_recovery();
         } else if (quit_flag) {
             break;
         }
@@ -108,6 +162,16 @@ void Controller::start_action_engine() {
         rawterm::signal_handler(rawterm::Signal::SIG_CONT, sig_resize_redraw);
         rawterm::signal_handler(rawterm::Signal::SIG_WINCH, sig_resize_redraw);
 
+        std::ignore = poll_background_saves();
+
+        // Merge in the rest of any file that's finished loading
+        if (poll_background_loads()) {
+            view.set_lineno_offset(view.get_active_model());
+            redraw_all = true;
+        } else if (!k.has_value() && view.get_active_model()->loading()) {
+            view.draw_status_bar();
+        }
+
         if (!(k.has_value())) { continue; }
 
         if (view.overlay_open) {
@@ -196,6 +260,8 @@ void Controller::start_action_engine() {
 
                 // Delete
             } else if (k.value() == rawterm::Key('d')) {
+                if (is_readonly_model()) { continue; }
+
                 auto k2 = rawterm::wait_for_input();
                 if (!(k2.isCharInput())) { continue; }
 
@@ -239,8 +305,11 @@ void Controller::start_action_engine() {
 
                 // Move to bottom of file
             } else if (k.value() == rawterm::Key('G', rawterm::Mod::Shift)) {
-                std::size_t count =
-                    view.get_active_model()->buf.size() - view.get_active_model()->current_line;
+                view.get_active_model()->wait_for_load();
+                view.set_lineno_offset(view.get_active_model());
+
+                std::size_t count = view.get_active_model()->line_count() -
+                                    view.get_active_model()->current_line;
                 for (std::size_t i = 0; i < count; i++) {
                     std::ignore =
                         parse_action<void, bool>(&view, Action<void> {ActionType::MoveCursorDown});
@@ -304,10 +373,13 @@ void Controller::start_action_engine() {
             } else if (k.value() == rawterm::Key('o')) {
                 if (is_readonly_model()) { continue; }
 
+                // NOTE: The new line is undone along with whatever's typed on it
                 parse_action<void, None>(&view, Action<void> {ActionType::EndOfLine});
+                view.get_active_model()->begin_undo_group();
                 parse_action<void, None>(&view, Action<void> {ActionType::Newline});
                 redraw_all = true;
                 parse_action<Mode, None>(&view, Action<Mode> {ActionType::ChangeMode, Mode::Write});
+                view.get_active_model()->end_undo_group();
 
                 // add new line and go to insert mode (above)
             } else if (k.value() == rawterm::Key('O', rawterm::Mod::Shift)) {
@@ -319,11 +391,13 @@ void Controller::start_action_engine() {
                     horizontal_cursor_pos--;
                 }
 
+                view.get_active_model()->begin_undo_group();
                 parse_action<void, None>(&view, Action<void> {ActionType::Newline});
                 std::ignore =
                     parse_action<void, bool>(&view, Action<void> {ActionType::MoveCursorUp});
                 redraw_all = true;
                 parse_action<Mode, None>(&view, Action<Mode> {ActionType::ChangeMode, Mode::Write});
+                view.get_active_model()->end_undo_group();
 
                 // Replace current char
             } else if (k.value() == rawterm::Key('r')) {
@@ -446,8 +520,7 @@ void Controller::start_action_engine() {
         if (!redraw_all) {
             view.draw_status_bar();
 
-            if (view.get_active_model()->undo_stack.size() == 1 ||
-                view.get_active_model()->undo_stack.empty()) {
+            if (view.get_active_model()->undo_log.depth() <= 1) {
                 view.draw_tab_bar();
             }
         }
@@ -594,16 +667,43 @@ bool Controller::parse_command() {
             return false;
         }
 
-        if (!(view.set_buffer(bufnr, models.size()))) {
+        if (!(view.set_buffer(bufnr))) {
+            view.display_message(msg, rawterm::Colors::red);
+            return false;
+        }
+
+        return true;
+
+        // go to byte offset
+    } else if (cmd.substr(0, 4) == ";go " && cmd.size() > 4) {
+        Model* model = view.get_active_model();
+        const std::string msg = "Offset is outside of the file";
+        std::size_t offset = 0;
+
+        try {
+            offset = std::stoul(cmd.substr(4, cmd.size()));
+        } catch (const std::invalid_argument& e) {
+            view.display_message(msg, rawterm::Colors::red);
+            return false;
+        } catch (const std::out_of_range& e) {
+            view.display_message(msg, rawterm::Colors::red);
+            return false;
+        }
+
+        if (offset >= model->offset_index().bytes()) {
             view.display_message(msg, rawterm::Colors::red);
             return false;
         }
 
+        const std::size_t idx = model->line_at(offset);
+        model->current_char = uint_t(offset - model->offset_of(idx));
+        view.set_current_line(uint_t(idx + 1));
         return true;
 
         // search
         // TODO: Try and find a way to display the search_str
     } else if (cmd.substr(0, 2) == ";f") {
+        view.get_active_model()->wait_for_load();
         auto new_pos = view.get_active_model()->find_next_str(cmd);
         if (new_pos.has_value()) {
             view.get_active_model()->current_line = uint_t(new_pos.value().vertical);
@@ -636,11 +736,111 @@ bool Controller::parse_command() {
 
         // find/replace (sed)
     } else if (cmd.substr(0, 2) == ";s" && cmd.size() > 2) {
+        if (is_readonly_model(true)) { return false; }
         view.get_active_model()->search_and_replace(cmd.substr(3, cmd.size()));
         return true;
 
+        // jump to a state in the undo history
+    } else if (cmd.substr(0, 6) == ";undo " && cmd.size() > 6) {
+        if (is_readonly_model(true)) { return false; }
+        Model* model = view.get_active_model();
+        const std::string msg = "No such change";
+        std::size_t target = 0;
+
+        try {
+            target = std::stoul(cmd.substr(6, cmd.size()));
+        } catch (const std::invalid_argument& e) {
+            view.display_message(msg, rawterm::Colors::red);
+            return false;
+        } catch (const std::out_of_range& e) {
+            view.display_message(msg, rawterm::Colors::red);
+            return false;
+        }
+
+        model->restore_history();
+        if (target > model->undo_log.size()) {
+            view.display_message(msg, rawterm::Colors::red);
+            return false;
+        }
+
+        std::ignore = model->go_to_state(target, view.view_size.horizontal);
+        view.set_lineno_offset(model);
+        view.change_model_cursor();
+        return true;
+
+        // move back or forward through the undo history
+    } else if (
+        (cmd.substr(0, 9) == ";earlier " && cmd.size() > 9) ||
+        (cmd.substr(0, 7) == ";later " && cmd.size() > 7)) {
+        if (is_readonly_model(true)) { return false; }
+        Model* model = view.get_active_model();
+        const bool back = cmd.at(1) == 'e';
+
+        const auto amount = travel_amount(cmd.substr(back ? 9 : 7, cmd.size()));
+        if (!amount.has_value()) {
+            view.display_message("Expected a count, or a time such as 10m", rawterm::Colors::red);
+            return false;
+        }
+
+        const int64_t by = back ? -amount.value().first : amount.value().first;
+        std::ignore = model->travel(by, amount.value().second, view.view_size.horizontal);
+        view.set_lineno_offset(model);
+        view.change_model_cursor();
+        return true;
+
+    } else if (cmd == ";recover") {
+        Model* model = view.get_active_model();
+        model->journal_pending = false;
+        if (is_readonly_model(true)) { return false; }
+
+        if (journal_in_use(model->filename)) {
+            view.display_message(in_use_message(model->filename), rawterm::Colors::red);
+            return false;
+        }
+
+        // NOTE: Edits made since would be replayed over
+        const std::optional<std::vector<JournalEntry>> entries =
+            model->journal == nullptr ? read_journal(model->filename) : std::nullopt;
+        if (!entries.has_value()) {
+            view.display_message("Nothing to recover", rawterm::Colors::red);
+            return false;
+        }
+
+        if (!model->replay(entries.value())) {
+            view.display_message("Journal doesn't match the file", rawterm::Colors::red);
+        }
+
+        model->current_line = std::min(model->current_line, uint_t(model->line_count() - 1));
+        model->current_char = 0;
+        view.set_lineno_offset(model);
+        view.change_model_cursor();
+        return true;
+
+    } else if (cmd == ";discard") {
+        Model* model = view.get_active_model();
+        model->journal_pending = false;
+        if (is_readonly_model(true)) { return false; }
+
+        if (journal_in_use(model->filename)) {
+            view.display_message(in_use_message(model->filename), rawterm::Colors::red);
+            return false;
+        }
+
+        if (model->journal_spent || !read_journal(model->filename).has_value()) {
+            view.display_message("Nothing to discard", rawterm::Colors::red);
+            return false;
+        }
+
+        model->discard_journal();
+        return true;
+
     } else if (cmd == ";wqa") {
-        [[maybe_unused]] WriteAllData write_data = write_all();
+        const WriteAllData write_data = write_all();
+        if (!write_data.valid) {
+            view.display_message(failed_saves_message(write_data.failed), rawterm::Colors::red);
+            return false;
+        }
+
         std::ignore = quit_app(true);
         return true;
 
@@ -652,13 +852,7 @@ bool Controller::parse_command() {
         return false;
 
     } else if (cmd == ";wa") {
-        WriteAllData write_data = write_all();
-        if (write_data.valid) {
-            std::string msg = std::format("Saved {} files", write_data.files);
-            view.display_message(msg, rawterm::Colors::green);
-        } else {
-            view.display_message("Error with saving files", rawterm::Colors::red);
-        }
+        start_save_all();
 
     } else if (cmd.substr(0, 2) == ";w") {
         std::optional<std::string> chosen_filename = std::nullopt;
@@ -667,11 +861,9 @@ bool Controller::parse_command() {
             rtrim(chosen_filename.value());
         }
 
-        WriteData file_write = write_to_file(view.get_active_model(), chosen_filename);
-        if (file_write.valid) {
-            std::string msg =
-                std::format("Saved {} bytes ({} lines)", file_write.bytes, file_write.lines);
-            view.display_message(msg, rawterm::Colors::green);
+        // Written in the background and reported by `poll_background_saves`
+        if (start_save(view.get_active_model(), chosen_filename)) {
+            view.draw_status_bar();
         } else {
             view.display_message(
                 "Could not save file: no filename specified", rawterm::Colors::red);
@@ -719,15 +911,41 @@ bool Controller::parse_command() {
     return false;
 }
 
-[[nodiscard]] bool Controller::is_readonly_model() {
-    return view.get_active_model()->readonly;
+// NOTE: This guards every editing command, so it's also where we wait for a
+// file that's still loading. Edits to lines that have been read go ahead, but
+// one at the last line read, or to the `whole` buffer, waits for the rest
+[[nodiscard]] bool Controller::is_readonly_model(const bool whole) {
+    Model* model = view.get_active_model();
+    if (model->readonly) { return true; }
+
+    // Any edit would have to be thrown away to recover the crash's, so none
+    // are made until it's been dealt with
+    if (model->journal_pending) {
+        view.display_message(
+            "Found unsaved edits from a crash. Use `;recover` or `;discard` first",
+            COLOR_DARK_YELLOW);
+        return true;
+    }
+
+    if (model->loading() && (whole || model->current_line + 1 >= model->line_count())) {
+        model->wait_for_load();
+        view.set_lineno_offset(model);
+    }
+
+    return false;
 }
 
 [[nodiscard]] bool Controller::quit_app(bool skip_check) {
     if (view.visible_tab_bar()) {
         if (check_for_saved_file(skip_check)) {
+            const ModelHandle handle = view.view_models.at(view.active_model);
             view.view_models.erase(view.view_models.begin() + std::ptrdiff_t(view.active_model));
 
+            // The buffer goes with its last tab
+            if (std::ranges::find(view.view_models, handle) == view.view_models.end()) {
+                models.erase(handle);
+            }
+
             if (view.active_model > 0) {
                 view.active_model--;
             } else {
@@ -747,7 +965,12 @@ bool Controller::parse_command() {
 }
 
 [[nodiscard]] bool Controller::check_for_saved_file(bool skip) {
-    if (!skip && view.get_active_model()->unsaved) {
+    if (skip) { return true; }
+
+    // A save that's still running might be about to clear `unsaved`
+    std::ignore = poll_save(view.get_active_model(), true);
+
+    if (view.get_active_model()->unsaved) {
         view.display_message("Unsaved changes. Use `;q!` to discard", rawterm::Colors::red);
         return false;
     }
@@ -756,57 +979,221 @@ bool Controller::parse_command() {
 }
 
 void Controller::add_model(const std::string& filename) {
-    opt_lines_t contents = open_file(filename);
-    if (contents.has_value()) {
-        models.emplace_back(contents.value(), filename);
+    std::optional<OpenedFile> opened =
+        open_text_buffer(filename, std::size_t(term_size.vertical), false);
+    ModelHandle handle = {};
+    if (opened.has_value()) {
+        handle = models.emplace(std::move(opened.value().buf), filename);
+        models.get(handle)->loader = std::move(opened.value().rest);
     } else {
-        models.emplace_back(term_size.vertical - 2, filename);
+        handle = models.emplace(term_size.vertical - 2, filename);
     }
 
     const int vert = int(1 + view.visible_tab_bar());
-    const int hor = 1 + int(view.set_lineno_offset(&models.at(models.size() - 1)));
+    const int hor = 1 + int(view.set_lineno_offset(models.get(handle)));
     view.cur.move(vert, hor);
-    view.view_models.at(view.active_model) = &models.at(models.size() - 1);
+    view.view_models.at(view.active_model) = handle;
 }
 
-[[nodiscard]] WriteAllData Controller::write_all() {
-    WriteAllData write_all_data = {};
+// Returns true if any model had the rest of its file merged in
+[[nodiscard]] bool Controller::poll_background_loads() {
+    bool merged = false;
+    for (auto& m : models) {
+        if (m.poll_load()) { merged = true; }
+    }
+
+    return merged;
+}
+
+// Point out unsaved edits left behind by a crash, the first time a buffer is
+// shown
+void Controller::offer_recovery() {
+    Model* model = view.get_active_model();
+    if (model->journal_checked) { return; }
+    model->journal_checked = true;
+
+    if (model->journal != nullptr) { return; }
+
+    if (journal_in_use(model->filename)) {
+        view.display_message(in_use_message(model->filename), COLOR_DARK_YELLOW);
+        return;
+    }
+
+    if (!read_journal(model->filename).has_value()) { return; }
+    model->journal_pending = true;
+    const std::string msg = std::format(
+        "Found unsaved edits to {}. Use `;recover` to restore them or `;discard` to drop them",
+        model->filename);
+    view.display_message(msg, COLOR_DARK_YELLOW);
+}
+
+// Show how any saves running in the background went, once they've finished.
+// Returns true if any did
+[[nodiscard]] bool Controller::poll_background_saves() {
+    std::vector<WriteData> saved = {};
+    std::vector<std::string> failed = {};
+    bool finished = false;
+
+    for (const ModelHandle handle : models.handles()) {
+        Model* m = models.get(handle);
+        const std::optional<WriteData> data = poll_save(m);
+        if (!data.has_value()) { continue; }
+        finished = true;
+
+        // Part of a `;wa`, which is reported as a whole
+        const auto waiting = std::ranges::find(saving_all, handle);
+        if (waiting != saving_all.end()) {
+            saving_all.erase(waiting);
+            if (data.value().valid) {
+                saving_all_result.value().files++;
+            } else {
+                saving_all_result.value().failed.push_back(m->filename);
+            }
+            continue;
+        }
+
+        if (data.value().valid) {
+            saved.push_back(data.value());
+        } else {
+            failed.push_back(m->filename);
+        }
+    }
+
+    // NOTE: Even with nothing finished, a `;wa` could be waiting on a save
+    // that `;q` has since waited on
+    if (!finished) { return report_save_all(); }
+
+    view.draw_tab_bar();
+    view.draw_status_bar();
+
+    if (!failed.empty()) {
+        view.display_message(failed_saves_message(failed), rawterm::Colors::red);
+    } else if (saved.size() == 1) {
+        const std::string msg =
+            std::format("Saved {} bytes ({} lines)", saved.front().bytes, saved.front().lines);
+        view.display_message(msg, rawterm::Colors::green);
+    } else if (saved.size() > 1) {
+        const std::string msg = std::format("Saved {} files", saved.size());
+        view.display_message(msg, rawterm::Colors::green);
+    }
+
+    // NOTE: Shown last so a failure in it isn't hidden by another save's message
+    std::ignore = report_save_all();
+    return true;
+}
+
+// Show the result of a `;wa` once its last file has been written, listing
+// any that failed. Returns true if it was shown
+[[nodiscard]] bool Controller::report_save_all() {
+    const std::optional<WriteAllData> data = take_save_all();
+    if (!data.has_value()) { return false; }
+
+    view.draw_tab_bar();
+    view.draw_status_bar();
+
+    if (!data.value().valid) {
+        view.display_message(failed_saves_message(data.value().failed), rawterm::Colors::red);
+    } else {
+        const std::string msg = std::format("Saved {} files", data.value().files);
+        view.display_message(msg, rawterm::Colors::green);
+    }
+
+    return true;
+}
+
+// The combined result of a `;wa`, once none of its saves are still running
+[[nodiscard]] std::optional<WriteAllData> Controller::take_save_all() {
+    if (!saving_all_result.has_value()) { return {}; }
+
+    // A buffer closed mid-save has nothing left to report, and one whose save
+    // was waited on elsewhere (e.g. by `;q`) went by whether it reached disk
+    std::erase_if(saving_all, [&](const ModelHandle h) {
+        const Model* m = models.get(h);
+        if (m == nullptr) { return true; }
+        if (m->saving != nullptr) { return false; }
+
+        if (m->disk_synced) {
+            saving_all_result.value().files++;
+        } else {
+            saving_all_result.value().failed.push_back(m->filename);
+        }
+        return true;
+    });
+
+    if (!saving_all.empty()) { return {}; }
+
+    WriteAllData data = std::move(saving_all_result.value());
+    saving_all_result = std::nullopt;
+    data.valid = data.failed.empty();
+    return data;
+}
 
+// Write every named model in the background for `;wa`. However many files
+// there are, `poll_background_saves` shows one message once they're all done
+void Controller::start_save_all() {
+    saving_all.clear();
+    saving_all_result = WriteAllData();
+
+    for (const ModelHandle handle : models.handles()) {
+        Model* m = models.get(handle);
+        // NOTE: As with `write_all`, a buffer waiting on `;recover` or
+        // `;discard` is left alone
+        if (m->filename == "NO NAME" || m->journal_pending) { continue; }
+
+        if (start_save(m, std::nullopt)) {
+            saving_all.push_back(handle);
+        } else {
+            saving_all_result.value().failed.push_back(m->filename);
+        }
+    }
+
+    // Nothing was started, so there's nothing to wait for
+    std::ignore = report_save_all();
+}
+
+// Save every named model, spread across a pool of threads. A file failing to
+// save doesn't stop the others
+[[nodiscard]] WriteAllData Controller::write_all() {
+    // NOTE: A buffer still waiting on `;recover` or `;discard` can't have been
+    // edited, and writing it would strand the edits left by the crash
+    std::vector<Model*> to_save = {};
     for (auto&& m : models) {
-        if (m.filename == "NO NAME") { continue; }
+        if (m.filename != "NO NAME" && !m.journal_pending) { to_save.push_back(&m); }
+    }
 
-        if (write_to_file(&m, std::nullopt).valid) {
+    // NOTE: Each model is only touched by the worker that saves it
+    std::vector<WriteData> results(to_save.size());
+    parallel_for(to_save.size(), [&](std::size_t idx) {
+        results.at(idx) = write_to_file(to_save.at(idx), std::nullopt);
+    });
+
+    WriteAllData write_all_data = {};
+    for (std::size_t idx = 0; idx < results.size(); idx++) {
+        if (results.at(idx).valid) {
             write_all_data.files++;
         } else {
-            write_all_data.valid = false;
-            return write_all_data;
+            write_all_data.failed.push_back(to_save.at(idx)->filename);
         }
     }
 
-    write_all_data.valid = true;
+    write_all_data.valid = write_all_data.failed.empty();
     return write_all_data;
 }
 
 [[nodiscard]] QuitAll Controller::quit_all() {
-    // remove every model that's saved
-    models.erase(
-        std::remove_if(
-            models.begin(), models.end(),
-            [](const Model& m) { return !m.unsaved || m.filename == "NO NAME"; }),
-        models.end());
-
-    if (!models.size()) {
-        view.view_models.clear();
-        return QuitAll::Close;
+    // Let any saves still running decide which models are unsaved
+    for (auto& m : models) {
+        std::ignore = poll_save(&m, true);
     }
 
-    // Clear the pointers
-    view.view_models.clear();
-    for (auto& model : models) {
-        view.view_models.push_back(&model);
+    // remove every model that's saved
+    for (const ModelHandle handle : models.handles()) {
+        const Model* const m = models.get(handle);
+        if (!m->unsaved || m->filename == "NO NAME") { models.erase(handle); }
     }
 
-    // If there's anything left, display to the user
+    // Show what's left, one tab each
+    view.view_models = models.handles();
     if (view.view_models.size()) {
         view.active_model = 0;
         return QuitAll::Redraw;
@@ -818,8 +1205,10 @@ void Controller::add_model(const std::string& filename) {
 [[nodiscard]] bool Controller::display_all_buffers() {
     std::vector<std::string> filenames = {};
 
-    for (const auto&& [idx, m] : enumerate<Model>(models)) {
-        std::string line = std::format("{} \u2502 {}", idx, m.filename);
+    // NOTE: A buffer is numbered by its slot, so there can be gaps
+    for (const ModelHandle handle : models.handles()) {
+        const Model& m = *models.get(handle);
+        std::string line = std::format("{} \u2502 {}", handle.index, m.filename);
 
         if (m.unsaved) { line += rawterm::bold("*"); }
         filenames.push_back(line);
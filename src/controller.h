@@ -6,7 +6,9 @@
 #include <rawterm/core.h>
 
 #include "flags.h"
+#include "loader.h"
 #include "model.h"
+#include "slot_map.h"
 #include "text_io.h"
 #include "view.h"
 
@@ -24,12 +26,16 @@ struct Redraw {
 
 struct Controller {
     rawterm::Pos term_size;
-    std::vector<Model> models = {};
+    SlotMap<Model> models = {};
     std::vector<Model> meta_buffers = {};
     View view;
     Mode mode = Mode::Read;
     bool quit_flag = false;
 
+    // A `;wa` still being written. It's reported once, after the last save
+    std::vector<ModelHandle> saving_all = {};
+    std::optional<WriteAllData> saving_all_result = std::nullopt;
+
     Controller();
     void set_mode(Mode m);
     [[nodiscard]] const std::string get_mode() const;
@@ -37,10 +43,16 @@ struct Controller {
     void start_action_engine();
     bool enter_command_mode();
     bool parse_command();
-    [[nodiscard]] bool is_readonly_model();
+    [[nodiscard]] bool is_readonly_model(const bool whole = false);
     [[nodiscard]] bool quit_app(bool);
     [[nodiscard]] bool check_for_saved_file(bool);
     void add_model(const std::string&);
+    [[nodiscard]] bool poll_background_loads();
+    [[nodiscard]] bool poll_background_saves();
+    void start_save_all();
+    [[nodiscard]] bool report_save_all();
+    [[nodiscard]] std::optional<WriteAllData> take_save_all();
+    void offer_recovery();
     [[nodiscard]] WriteAllData write_all();
     [[nodiscard]] QuitAll quit_all();
     [[nodiscard]] bool display_all_buffers();
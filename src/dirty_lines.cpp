@@ -0,0 +1,76 @@
+#include "dirty_lines.h"
+
+#include <algorithm>
+#include <bit>
+
+static const std::size_t WORD_BITS = 64;
+
+void DirtyLines::set(const std::size_t idx) {
+    if (idx / WORD_BITS >= words.size()) { words.resize(idx / WORD_BITS + 1, 0); }
+    words.at(idx / WORD_BITS) |= uint64_t(1) << (idx % WORD_BITS);
+}
+
+[[nodiscard]] bool DirtyLines::test(const std::size_t idx) const {
+    if (idx / WORD_BITS >= words.size()) { return false; }
+    return (words.at(idx / WORD_BITS) >> (idx % WORD_BITS)) & 1;
+}
+
+// A line was added at `idx`, so every line from there on moves down one. The
+// new line counts as edited
+void DirtyLines::insert(const std::size_t idx) {
+    const std::size_t word = idx / WORD_BITS;
+    if (word >= words.size()) {
+        set(idx);
+        return;
+    }
+
+    if (words.back() >> (WORD_BITS - 1)) { words.push_back(0); }
+
+    for (std::size_t i = words.size() - 1; i > word; i--) {
+        words.at(i) = (words.at(i) << 1) | (words.at(i - 1) >> (WORD_BITS - 1));
+    }
+
+    const uint64_t low_mask = (uint64_t(1) << (idx % WORD_BITS)) - 1;
+    const uint64_t low = words.at(word) & low_mask;
+    words.at(word) = low | ((words.at(word) & ~low_mask) << 1);
+
+    set(idx);
+}
+
+// The line at `idx` was removed, so every line after it moves up one
+void DirtyLines::erase(const std::size_t idx) {
+    const std::size_t word = idx / WORD_BITS;
+    if (word >= words.size()) { return; }
+
+    const uint64_t low_mask = (uint64_t(1) << (idx % WORD_BITS)) - 1;
+    const uint64_t low = words.at(word) & low_mask;
+    words.at(word) = low | ((words.at(word) >> 1) & ~low_mask);
+
+    for (std::size_t i = word; i + 1 < words.size(); i++) {
+        words.at(i) |= words.at(i + 1) << (WORD_BITS - 1);
+        words.at(i + 1) >>= 1;
+    }
+}
+
+void DirtyLines::clear() {
+    words.clear();
+}
+
+[[nodiscard]] bool DirtyLines::empty() const {
+    return std::all_of(words.begin(), words.end(), [](uint64_t w) { return w == 0; });
+}
+
+// The first dirty line at or after `idx`, or npos. Skips clean lines a word
+// at a time
+[[nodiscard]] std::size_t DirtyLines::next(const std::size_t idx) const {
+    std::size_t word = idx / WORD_BITS;
+    if (word >= words.size()) { return std::string::npos; }
+
+    uint64_t bits = words.at(word) & ~((uint64_t(1) << (idx % WORD_BITS)) - 1);
+    while (!bits) {
+        if (++word >= words.size()) { return std::string::npos; }
+        bits = words.at(word);
+    }
+
+    return word * WORD_BITS + std::size_t(std::countr_zero(bits));
+}
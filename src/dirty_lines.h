@@ -0,0 +1,23 @@
+#ifndef DIRTY_LINES_H
+#define DIRTY_LINES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One bit per line of a buffer, set for lines edited since the last save.
+// Lines past the end of `words` are clean
+struct DirtyLines {
+    std::vector<uint64_t> words = {};
+
+    void set(const std::size_t);
+    [[nodiscard]] bool test(const std::size_t) const;
+    void insert(const std::size_t);
+    void erase(const std::size_t);
+    void clear();
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] std::size_t next(const std::size_t) const;
+};
+
+#endif  // DIRTY_LINES_H
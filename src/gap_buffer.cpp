@@ -0,0 +1,217 @@
+#include "gap_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+// Slots (or chars) left free whenever a gap has to grow
+static const std::size_t MIN_GAP = 64;
+
+GapBuffer::GapBuffer(std::vector<std::string> lines)
+    : slots(std::move(lines)),
+      info(slots.size()),
+      gap_start(slots.size()),
+      gap_end(slots.size()) {}
+
+[[nodiscard]] std::size_t GapBuffer::size() const {
+    return slots.size() - (gap_end - gap_start);
+}
+
+[[nodiscard]] std::string_view GapBuffer::at(const std::size_t idx) const {
+    if (idx >= size()) { throw std::out_of_range("GapBuffer::at"); }
+    return slots[slot(idx)];
+}
+
+// NOTE: The line is about to change, so what's known about it is forgotten
+[[nodiscard]] std::string& GapBuffer::edit(const std::size_t idx) {
+    if (idx >= size()) { throw std::out_of_range("GapBuffer::edit"); }
+    info[slot(idx)].forget();
+    return slots[slot(idx)];
+}
+
+void GapBuffer::set(const std::size_t idx, std::string text) {
+    edit(idx) = std::move(text);
+}
+
+void GapBuffer::insert(const std::size_t idx, std::string text) {
+    if (idx > size()) { throw std::out_of_range("GapBuffer::insert"); }
+
+    move_gap(idx);
+    if (gap_start == gap_end) { grow(1); }
+    info[gap_start].forget();
+    slots[gap_start++] = std::move(text);
+}
+
+void GapBuffer::erase(const std::size_t idx) {
+    if (idx >= size()) { throw std::out_of_range("GapBuffer::erase"); }
+
+    move_gap(idx);
+    std::string().swap(slots[gap_end++]);
+}
+
+void GapBuffer::append(std::vector<std::string> lines) {
+    move_gap(size());
+    if (gap_end - gap_start < lines.size()) { grow(lines.size()); }
+
+    std::move(lines.begin(), lines.end(), slots.begin() + std::ptrdiff_t(gap_start));
+    std::fill_n(info.begin() + std::ptrdiff_t(gap_start), lines.size(), LineInfo {});
+    gap_start += lines.size();
+}
+
+[[nodiscard]] LineRef GapBuffer::line_ref(const std::size_t idx) const {
+    if (idx >= size()) { throw std::out_of_range("GapBuffer::line_ref"); }
+    return info[slot(idx)].ref(slots[slot(idx)]);
+}
+
+// Where line idx is kept, skipping over the gap
+[[nodiscard]] std::size_t GapBuffer::slot(const std::size_t idx) const {
+    return idx < gap_start ? idx : idx + (gap_end - gap_start);
+}
+
+// Move the lines in [first, last) of `v` to end at `dest`, or start at it
+// when `forward`. Slots and what's known about them always move together
+template <typename T>
+static void shift(
+    std::vector<T>& v,
+    const std::size_t first,
+    const std::size_t last,
+    const std::size_t dest,
+    const bool forward) {
+    const auto begin = v.begin();
+    if (forward) {
+        std::move(
+            begin + std::ptrdiff_t(first), begin + std::ptrdiff_t(last),
+            begin + std::ptrdiff_t(dest));
+    } else {
+        std::move_backward(
+            begin + std::ptrdiff_t(first), begin + std::ptrdiff_t(last),
+            begin + std::ptrdiff_t(dest));
+    }
+}
+
+// Move the gap so it starts at line idx
+void GapBuffer::move_gap(const std::size_t idx) {
+    // Nothing to move past an empty gap
+    if (gap_start == gap_end) {
+        gap_start = gap_end = idx;
+        return;
+    }
+
+    if (idx < gap_start) {
+        shift(slots, idx, gap_start, gap_end, false);
+        shift(info, idx, gap_start, gap_end, false);
+        gap_end -= gap_start - idx;
+        gap_start = idx;
+    } else if (idx > gap_start) {
+        shift(slots, gap_end, gap_end + idx - gap_start, gap_start, true);
+        shift(info, gap_end, gap_end + idx - gap_start, gap_start, true);
+        gap_end += idx - gap_start;
+        gap_start = idx;
+    }
+}
+
+// Make room for at least `count` more lines. The gap grows with the buffer,
+// so a run of inserts is still O(1) each on average
+void GapBuffer::grow(const std::size_t count) {
+    const std::size_t extra = std::max({count, MIN_GAP, size() / 8});
+    const std::size_t end = slots.size();
+
+    slots.resize(end + extra);
+    info.resize(end + extra);
+    shift(slots, gap_end, end, slots.size(), false);
+    shift(info, gap_end, end, info.size(), false);
+    gap_end += extra;
+}
+
+[[nodiscard]] std::size_t LineParts::size() const {
+    return head.size() + tail.size();
+}
+
+[[nodiscard]] char LineParts::at(const std::size_t pos) const {
+    if (pos >= size()) { throw std::out_of_range("LineParts::at"); }
+    return pos < head.size() ? head[pos] : tail[pos - head.size()];
+}
+
+// Append up to `count` chars from `pos` to `out`
+void LineParts::copy(std::string& out, const std::size_t pos, const std::size_t count) const {
+    if (pos < head.size()) { out.append(head.substr(pos, count)); }
+
+    const std::size_t copied = pos < head.size() ? std::min(count, head.size() - pos) : 0;
+    const std::size_t from = pos + copied - head.size();
+    if (copied < count && from < tail.size()) { out.append(tail.substr(from, count - copied)); }
+}
+
+void GapLine::load(std::string_view line) {
+    text.assign(line);
+    text.resize(line.size() + MIN_GAP);
+    gap_start = line.size();
+    gap_end = text.size();
+    tabs = std::size_t(std::count(line.begin(), line.end(), '\t'));
+
+    flat.assign(line);
+    stale = false;
+}
+
+[[nodiscard]] std::size_t GapLine::size() const {
+    return text.size() - (gap_end - gap_start);
+}
+
+[[nodiscard]] char GapLine::at(const std::size_t pos) const {
+    if (pos >= size()) { throw std::out_of_range("GapLine::at"); }
+    return pos < gap_start ? text[pos] : text[pos + gap_end - gap_start];
+}
+
+[[nodiscard]] const std::string& GapLine::str() const {
+    if (stale) {
+        flat.assign(text, 0, gap_start);
+        flat.append(text, gap_end);
+        stale = false;
+    }
+
+    return flat;
+}
+
+[[nodiscard]] LineParts GapLine::parts() const {
+    const std::string_view all = text;
+    return {all.substr(0, gap_start), all.substr(gap_end), tabs != 0};
+}
+
+void GapLine::insert(const std::size_t pos, const char c) {
+    if (pos > size()) { throw std::out_of_range("GapLine::insert"); }
+
+    move_gap(pos);
+    if (gap_start == gap_end) {
+        const std::size_t extra = std::max(MIN_GAP, size() / 2);
+        text.insert(gap_end, extra, '\0');
+        gap_end += extra;
+    }
+
+    text[gap_start++] = c;
+    if (c == '\t') { tabs++; }
+    stale = true;
+}
+
+void GapLine::erase(const std::size_t pos, const std::size_t count) {
+    if (pos + count > size()) { throw std::out_of_range("GapLine::erase"); }
+
+    move_gap(pos);
+    tabs -= std::size_t(std::count(&text[gap_end], &text[gap_end] + count, '\t'));
+    gap_end += count;
+    stale = true;
+}
+
+// Move the gap so it starts at `pos`, only moving the chars between
+void GapLine::move_gap(const std::size_t pos) {
+    if (pos < gap_start) {
+        const std::size_t len = gap_start - pos;
+        std::memmove(&text[gap_end - len], &text[pos], len);
+        gap_start = pos;
+        gap_end -= len;
+    } else if (pos > gap_start) {
+        const std::size_t len = pos - gap_start;
+        std::memmove(&text[gap_start], &text[gap_end], len);
+        gap_start = pos;
+        gap_end += len;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef GAP_BUFFER_H
+#define GAP_BUFFER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_buffer.h"
+
+// Lines in one array with a gap of unused slots where the last line was added
+// or removed. Edits near the last one only move the lines between the two,
+// so typing out new lines in one place is O(1) however big the file is
+struct GapBuffer : TextBuffer {
+    std::vector<std::string> slots;
+    // What's known about the line in each slot, see `LineInfo`
+    mutable std::vector<LineInfo> info;
+    std::size_t gap_start;
+    std::size_t gap_end;
+
+    explicit GapBuffer(std::vector<std::string>);
+    [[nodiscard]] std::size_t size() const override;
+    [[nodiscard]] std::string_view at(const std::size_t) const override;
+    [[nodiscard]] std::string& edit(const std::size_t) override;
+    void set(const std::size_t, std::string) override;
+    void insert(const std::size_t, std::string) override;
+    void erase(const std::size_t) override;
+    void append(std::vector<std::string>) override;
+    [[nodiscard]] LineRef line_ref(const std::size_t) const override;
+
+    [[nodiscard]] std::size_t slot(const std::size_t) const;
+    void move_gap(const std::size_t);
+    void grow(const std::size_t);
+};
+
+// A line as up to two runs of chars, so the line being typed into can be read
+// either side of its gap without putting it back together
+struct LineParts {
+    std::string_view head = "";
+    std::string_view tail = "";
+    bool tabs = false;
+
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] char at(const std::size_t) const;
+    void copy(std::string&, const std::size_t, const std::size_t) const;
+};
+
+// The chars of one line with a gap at the cursor, so typing or deleting there
+// doesn't move the rest of the line. It's only put back together into one
+// string by `str()`, drawing it goes through `parts()` instead
+struct GapLine {
+    std::string text = "";
+    std::size_t gap_start = 0;
+    std::size_t gap_end = 0;
+    std::size_t tabs = 0;
+
+    mutable std::string flat = "";
+    mutable bool stale = false;
+
+    void load(std::string_view);
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] char at(const std::size_t) const;
+    [[nodiscard]] const std::string& str() const;
+    [[nodiscard]] LineParts parts() const;
+    void insert(const std::size_t, const char);
+    void erase(const std::size_t, const std::size_t);
+    void move_gap(const std::size_t);
+};
+
+#endif  // GAP_BUFFER_H
@@ -0,0 +1,312 @@
+#include "journal.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stop_token>
+#include <thread>
+#include <tuple>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "constants.h"
+#include "mapped_file.h"
+
+// Journal layout: the magic, then the size and mtime of the file the edits
+// apply to, then one record per edit:
+//   op (1 byte) | line (u64) | text size (u64) | text    for SetLine/InsertLine
+//   op (1 byte) | line (u64)                            for EraseLine
+// Numbers are written in native byte order, as the journal never leaves the
+// machine it was made on
+static const std::string_view JOURNAL_MAGIC = "IRISJNL2";
+static const std::size_t HEADER_SIZE = 24;
+
+// Every open journal, so they can be synced on the way out of a crash, and
+// the one thread that syncs them all as they go. Started by the first journal
+// opened, and stopped on the way out
+static std::mutex registry_lock;
+static std::vector<Journal*> registry = {};
+static std::condition_variable_any registry_wake;
+static std::jthread syncer;  // Declared last so it's joined before the rest is destroyed
+
+template <typename T>
+static void put(std::string& out, const T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+[[nodiscard]] static T get(std::string_view data, const std::size_t pos) {
+    T value;
+    std::memcpy(&value, data.data() + pos, sizeof(T));
+    return value;
+}
+
+static std::size_t append_record(
+    std::string& out,
+    const JournalOp op,
+    const std::size_t idx,
+    std::string_view text) {
+    const std::size_t before = out.size();
+    out.push_back(static_cast<char>(op));
+    put(out, uint64_t(idx));
+
+    if (op != JournalOp::EraseLine) {
+        put(out, uint64_t(text.size()));
+        out.append(text);
+    }
+
+    return out.size() - before;
+}
+
+// Empty the journal open at `fd`, and start it again for edits to `base`
+[[nodiscard]] static bool reset_journal(const int fd, const FileStamp& base) {
+    std::string header(JOURNAL_MAGIC);
+    put(header, uint64_t(base.size));
+    put(header, int64_t(base.mtime_ns));
+
+    return ftruncate(fd, 0) == 0 && lseek(fd, 0, SEEK_SET) == 0 &&
+           write_fully(fd, header.data(), header.size());
+}
+
+// Create the journal at `path`, ready for records to be appended, and lock it
+// so no other instance writes over it while it's in use. A journal that's
+// already there is only emptied with `replace`, and never while it's locked
+[[nodiscard]] static int open_journal(
+    const std::string& path,
+    const FileStamp& base,
+    const bool replace) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    const bool created = fd != -1;
+    if (!created && errno == EEXIST && replace) { fd = open(path.c_str(), O_RDWR | O_CLOEXEC); }
+    if (fd == -1) { return -1; }
+
+    if (flock(fd, LOCK_EX | LOCK_NB) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    if (!reset_journal(fd, base)) {
+        close(fd);
+        unlink(path.c_str());
+        return -1;
+    }
+
+    return fd;
+}
+
+[[nodiscard]] std::string journal_path(const std::string& filename) {
+    namespace fs = std::filesystem;
+    const fs::path file = filename;
+    return (file.parent_path() / ("." + file.filename().string() + ".iris-swp")).string();
+}
+
+// Sync every open journal every JOURNAL_SYNC_MS, until iris exits
+static void sync_all(std::stop_token stop) {
+    std::unique_lock<std::mutex> guard(registry_lock);
+    while (!stop.stop_requested()) {
+        // NOTE: Nothing notifies `registry_wake`, waiting on it just lets the
+        // timer be cut short on the way out
+        registry_wake.wait_for(
+            guard, stop, std::chrono::milliseconds(JOURNAL_SYNC_MS), [] { return false; });
+
+        for (Journal* journal : registry) {
+            journal->sync();
+        }
+    }
+}
+
+Journal::Journal(const std::string& filename, const FileStamp& stamp, const bool replace)
+    : path(journal_path(filename)), base(stamp), fd(open_journal(path, base, replace)) {
+    const std::lock_guard<std::mutex> guard(registry_lock);
+    registry.push_back(this);
+    if (!syncer.joinable()) { syncer = std::jthread(sync_all); }
+}
+
+Journal::~Journal() {
+    {
+        const std::lock_guard<std::mutex> guard(registry_lock);
+        registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+    }
+
+    // NOTE: A journal that couldn't be opened belongs to someone else
+    if (fd != -1) {
+        unlink(path.c_str());
+        close(fd);
+    }
+}
+
+void Journal::set_line(const std::size_t idx, std::string_view text) {
+    const std::lock_guard<std::mutex> guard(lock);
+    written += append_record(pending, JournalOp::SetLine, idx, text);
+}
+
+void Journal::insert_line(const std::size_t idx, std::string_view text) {
+    const std::lock_guard<std::mutex> guard(lock);
+    written += append_record(pending, JournalOp::InsertLine, idx, text);
+}
+
+void Journal::erase_line(const std::size_t idx) {
+    const std::lock_guard<std::mutex> guard(lock);
+    written += append_record(pending, JournalOp::EraseLine, idx, "");
+}
+
+// Where the next record will go, to be passed to `rebase` later
+[[nodiscard]] std::size_t Journal::mark() {
+    const std::lock_guard<std::mutex> guard(lock);
+    return written;
+}
+
+// `size` bytes of the journal open at `fd`, from `offset`
+[[nodiscard]] static std::optional<std::string> read_back(
+    const int fd,
+    const std::size_t offset,
+    const std::size_t size) {
+    std::string ret(size, '\0');
+    std::size_t done = 0;
+
+    while (done < size) {
+        const ssize_t got = pread(fd, ret.data() + done, size - done, off_t(offset + done));
+        if (got < 0 && errno == EINTR) { continue; }
+        if (got <= 0) { return {}; }
+        done += std::size_t(got);
+    }
+
+    return ret;
+}
+
+// The file was saved as it was at `mark`. Rewrite the journal so only the
+// edits made since then are replayed, on top of the file as it is now. They're
+// read back from the journal where they've been written, so only those not
+// synced yet are ever kept in memory
+void Journal::rebase(const std::string& filename, const FileStamp& stamp, const std::size_t mark) {
+    const std::scoped_lock guard(file_lock, lock);
+
+    std::string kept = "";
+    if (fd != -1 && mark < on_disk) {
+        kept = read_back(fd, HEADER_SIZE + mark, on_disk - mark).value_or("");
+    }
+    kept += pending.substr(std::min(mark - std::min(mark, on_disk), pending.size()));
+    pending.clear();
+    base = stamp;
+
+    // Whatever journal is left where the file was saved no longer applies
+    // to it, so can be written over unless another instance is using it
+    const std::string new_path = journal_path(filename);
+    if (fd != -1 && new_path != path) {
+        unlink(path.c_str());
+        close(fd);
+        fd = -1;
+    }
+
+    path = new_path;
+    if (fd != -1 && !reset_journal(fd, base)) {
+        close(fd);
+        fd = -1;
+    }
+    if (fd == -1) { fd = open_journal(path, base, true); }
+
+    on_disk = 0;
+    written = kept.size();
+    if (fd != -1 && write_fully(fd, kept.data(), kept.size())) {
+        on_disk = kept.size();
+        fdatasync(fd);
+    } else {
+        pending = std::move(kept);
+    }
+}
+
+// Write out anything buffered since the last sync. Edits stay in memory while
+// the journal can't be written, or if writing them fails
+void Journal::sync() {
+    const std::lock_guard<std::mutex> file_guard(file_lock);
+    if (fd == -1) { return; }
+
+    std::string batch = "";
+    {
+        const std::lock_guard<std::mutex> guard(lock);
+        batch.swap(pending);
+    }
+
+    if (batch.empty()) { return; }
+    if (write_fully(fd, batch.data(), batch.size())) {
+        on_disk += batch.size();
+        fdatasync(fd);
+        return;
+    }
+
+    // Cut off whatever part of it did go, to be written again next time
+    std::ignore = ftruncate(fd, off_t(HEADER_SIZE + on_disk));
+    std::ignore = lseek(fd, off_t(HEADER_SIZE + on_disk), SEEK_SET);
+    const std::lock_guard<std::mutex> guard(lock);
+    pending.insert(0, batch);
+}
+
+// The edits left in the journal for `filename`, if there are any and they
+// still apply to the file as it is on disk. A crash can leave the last record
+// half written, so reading stops at the first one that doesn't fit
+[[nodiscard]] std::optional<std::vector<JournalEntry>> read_journal(const std::string& filename) {
+    const MappedFile mapping(journal_path(filename));
+    const std::string_view data = mapping.view();
+    if (data.size() < HEADER_SIZE || data.substr(0, JOURNAL_MAGIC.size()) != JOURNAL_MAGIC) {
+        return {};
+    }
+
+    const FileStamp base = {
+        std::size_t(get<uint64_t>(data, 8)), get<int64_t>(data, 16)};
+    if (!(file_stamp(filename).value_or(FileStamp()) == base)) { return {}; }
+
+    std::vector<JournalEntry> entries = {};
+    std::size_t pos = HEADER_SIZE;
+
+    while (pos + 9 <= data.size()) {
+        const auto op = static_cast<JournalOp>(data[pos]);
+        const std::size_t idx = get<uint64_t>(data, pos + 1);
+        pos += 9;
+
+        if (op == JournalOp::EraseLine) {
+            entries.push_back(JournalEntry {op, idx});
+            continue;
+        }
+
+        if ((op != JournalOp::SetLine && op != JournalOp::InsertLine) || pos + 8 > data.size()) {
+            break;
+        }
+
+        const std::size_t len = get<uint64_t>(data, pos);
+        pos += 8;
+        if (len > data.size() - pos) { break; }
+
+        entries.push_back(JournalEntry {op, idx, std::string(data.substr(pos, len))});
+        pos += len;
+    }
+
+    if (entries.empty()) { return {}; }
+    return entries;
+}
+
+// Whether the journal for `filename` is locked by a buffer that's open, in
+// this instance or another
+[[nodiscard]] bool journal_in_use(const std::string& filename) {
+    const int fd = open(journal_path(filename).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) { return false; }
+
+    const bool locked = flock(fd, LOCK_EX | LOCK_NB) == -1 && errno == EWOULDBLOCK;
+    close(fd);
+    return locked;
+}
+
+// Get every journal onto disk. Called when iris is about to die
+void sync_journals() {
+    const std::lock_guard<std::mutex> guard(registry_lock);
+    for (Journal* journal : registry) {
+        journal->sync();
+    }
+}
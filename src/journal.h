@@ -0,0 +1,62 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "save.h"
+
+enum class JournalOp : char { SetLine = 'S', InsertLine = 'I', EraseLine = 'E' };
+
+struct JournalEntry {
+    JournalOp op;
+    std::size_t idx;
+    std::string text = "";
+};
+
+// Append-only record of the edits made to a buffer since the file it was
+// loaded from (`base`) was last written, so they can be recovered after a
+// crash. Edits are only buffered in memory until one thread shared by every
+// journal writes them out and fsyncs them, every JOURNAL_SYNC_MS. Removed
+// again when destroyed, as that only happens once the edits are saved or
+// thrown away.
+// NOTE: A journal already left for the file is only written over with
+// `replace`, and never while another buffer has it open. Until then `fd` is -1
+// and edits are only kept in memory
+struct Journal {
+    std::string path;
+    FileStamp base;
+    int fd = -1;
+
+    // Guards `pending` and `written`, which are added to on every edit
+    std::mutex lock;
+    std::string pending = "";  // Records that aren't on disk yet
+    std::size_t written = 0;   // Bytes of records since `base`, on disk or not
+
+    // Held while writing to `fd`, so edits never wait on the disk
+    std::mutex file_lock;
+    std::size_t on_disk = 0;  // Bytes of records in the file
+
+    Journal(const std::string&, const FileStamp&, const bool);
+    ~Journal();
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    void set_line(const std::size_t, std::string_view);
+    void insert_line(const std::size_t, std::string_view);
+    void erase_line(const std::size_t);
+    [[nodiscard]] std::size_t mark();
+    void rebase(const std::string&, const FileStamp&, const std::size_t);
+    void sync();
+};
+
+[[nodiscard]] std::string journal_path(const std::string&);
+[[nodiscard]] std::optional<std::vector<JournalEntry>> read_journal(const std::string&);
+[[nodiscard]] bool journal_in_use(const std::string&);
+void sync_journals();
+
+#endif  // JOURNAL_H
@@ -0,0 +1,123 @@
+#include "line_arena.h"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+#include "constants.h"
+
+static_assert(sizeof(LineRef) == 16);
+
+static const uint8_t ASCII = 1;
+static const uint8_t BLANK = 2;
+static const uint8_t TABS = 4;
+static const uint8_t LONG = 8;
+static const uint8_t KNOWN = 16;  // Only set in a LineInfo
+
+[[nodiscard]] static bool is_space(unsigned char c) {
+    return std::isspace(c);
+}
+
+// NOTE: A line of 4GiB or more keeps the top of its size in `leading`, so its
+// indent is counted again each time it's asked for. 48 bits is more than any
+// address space a line could be mapped into
+LineRef::LineRef(std::string_view text) : data(text.data()), size(uint32_t(text.size())) {
+    const std::size_t lead =
+        std::size_t(std::find_if_not(text.begin(), text.end(), is_space) - text.begin());
+
+    if (text.size() > UINT32_MAX) {
+        flags |= LONG;
+        leading = uint16_t(text.size() >> 32);
+    } else {
+        leading = uint16_t(std::min<std::size_t>(lead, UINT16_MAX));
+    }
+
+    if (lead == text.size()) { flags |= BLANK; }
+    if (text.find('\t') != std::string_view::npos) { flags |= TABS; }
+    if (std::none_of(text.begin(), text.end(), [](unsigned char c) { return c & 0x80; })) {
+        flags |= ASCII;
+    }
+}
+
+[[nodiscard]] std::string_view LineRef::text() const {
+    if (flags & LONG) { return {data, std::size_t(leading) << 32 | size}; }
+    return {data, size};
+}
+
+[[nodiscard]] bool LineRef::ascii() const {
+    return flags & ASCII;
+}
+
+// Empty, or nothing but whitespace
+[[nodiscard]] bool LineRef::blank() const {
+    return flags & BLANK;
+}
+
+[[nodiscard]] bool LineRef::has_tabs() const {
+    return flags & TABS;
+}
+
+// How many whitespace chars the line starts with. Only counted again for
+// the rare line that starts with more than fit in `leading`, or is too long to
+// keep it there
+[[nodiscard]] std::size_t LineRef::indent() const {
+    if (leading < UINT16_MAX && !(flags & LONG)) { return leading; }
+
+    const std::string_view line = text();
+    return std::size_t(std::find_if_not(line.begin(), line.end(), is_space) - line.begin());
+}
+
+// `text` as a LineRef, only looked through if it hasn't been since it was last
+// forgotten
+[[nodiscard]] LineRef LineInfo::ref(std::string_view text) {
+    if (!(flags & KNOWN)) {
+        const LineRef ret(text);
+        leading = ret.leading;
+        flags = ret.flags | KNOWN;
+        return ret;
+    }
+
+    LineRef ret;
+    ret.data = text.data();
+    ret.size = uint32_t(text.size());
+    ret.leading = leading;
+    ret.flags = flags & ~KNOWN;
+    return ret;
+}
+
+void LineInfo::forget() {
+    flags = 0;
+}
+
+// Room for `size` bytes in one piece. Anything at least a slab in size gets a
+// slab of its own, so a big load doesn't waste the rest of the current one
+[[nodiscard]] char* LineArena::allocate(const std::size_t size) {
+    if (size >= ARENA_SLAB_SIZE) {
+        slabs.push_back(std::make_unique_for_overwrite<char[]>(size));
+        return slabs.back().get();
+    }
+
+    if (size > left) {
+        slabs.push_back(std::make_unique_for_overwrite<char[]>(ARENA_SLAB_SIZE));
+        next = slabs.back().get();
+        left = ARENA_SLAB_SIZE;
+    }
+
+    char* ret = next;
+    next += size;
+    left -= size;
+    return ret;
+}
+
+[[nodiscard]] std::string_view LineArena::store(std::string_view text) {
+    char* dest = allocate(text.size());
+    std::copy(text.begin(), text.end(), dest);
+    return {dest, text.size()};
+}
+
+// Take over the slabs of `other`, so views into it last as long as this does.
+// NOTE: Moving a slab doesn't move its bytes
+void LineArena::adopt(LineArena other) {
+    slabs.reserve(slabs.size() + other.slabs.size());
+    std::move(other.slabs.begin(), other.slabs.end(), std::back_inserter(slabs));
+}
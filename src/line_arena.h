@@ -0,0 +1,52 @@
+#ifndef LINE_ARENA_H
+#define LINE_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// A line stored somewhere else, and what the editor most often asks about it,
+// worked out once when it's stored. At 16 bytes it's half the size of an
+// empty std::string
+struct LineRef {
+    const char* data = nullptr;
+    uint32_t size = 0;
+    uint16_t leading = 0;  // Whitespace it starts with, up to UINT16_MAX. See the ctor
+    uint8_t flags = 0;
+
+    LineRef() {}
+    explicit LineRef(std::string_view);
+    [[nodiscard]] std::string_view text() const;
+    [[nodiscard]] bool ascii() const;
+    [[nodiscard]] bool blank() const;
+    [[nodiscard]] bool has_tabs() const;
+    [[nodiscard]] std::size_t indent() const;
+};
+
+// What a LineRef knows about a line, for backends that keep their lines as
+// strings to cache next to each one. It's worked out the first time it's asked
+// for, and has to be `forget()`-ed whenever the line changes
+struct LineInfo {
+    uint16_t leading = 0;
+    uint8_t flags = 0;
+
+    [[nodiscard]] LineRef ref(std::string_view);
+    void forget();
+};
+
+// Text of lines that never change once stored, packed into a few big slabs
+// rather than an allocation per line. Nothing is freed until the arena is,
+// and then it's one free per slab however many lines there were
+struct LineArena {
+    std::vector<std::unique_ptr<char[]>> slabs = {};
+    char* next = nullptr;  // Free space left in the newest small slab
+    std::size_t left = 0;
+
+    [[nodiscard]] char* allocate(const std::size_t);
+    [[nodiscard]] std::string_view store(std::string_view);
+    void adopt(LineArena);
+};
+
+#endif  // LINE_ARENA_H
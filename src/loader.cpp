@@ -0,0 +1,259 @@
+#include "loader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <utility>
+
+#include "constants.h"
+#include "paged_buffer.h"
+#include "parallel.h"
+#include "piece_table.h"
+#include "scan.h"
+
+// Split `text` into lines, dropping CRs, and append them to `out`. Tabs are
+// kept as they are and only expanded when drawn
+void append_lines(std::string_view text, std::vector<std::string>& out) {
+    // Find every newline and CR up front so lines can be copied out in whole
+    // runs rather than one char at a time
+    std::vector<std::size_t> special_chars = {};
+    scan_line_chars(text, 0, special_chars);
+
+    const auto newlines = std::count_if(
+        special_chars.begin(), special_chars.end(), [&](std::size_t i) { return text[i] == '\n'; });
+    out.reserve(out.size() + std::size_t(newlines) + 1);
+
+    std::string line = "";
+    std::size_t run_start = 0;
+
+    for (const std::size_t pos : special_chars) {
+        line.append(text.substr(run_start, pos - run_start));
+        run_start = pos + 1;
+
+        if (text[pos] == '\n') {
+            out.push_back(std::move(line));
+            line = "";
+        }
+    }
+
+    line.append(text.substr(run_start));
+
+    // If there's no newlines in the stream at all, it never gets added to
+    // the vector
+    if (line.size()) { out.push_back(std::move(line)); }
+}
+
+// Scan and split each chunk on its own thread, then stitch the results back
+// together in order
+static void append_chunks(
+    std::span<const std::string_view> chunks,
+    std::vector<std::string>& out) {
+    std::vector<std::vector<std::string>> chunk_lines(chunks.size());
+    parallel_for(chunks.size(), [&](std::size_t idx) {
+        append_lines(chunks[idx], chunk_lines.at(idx));
+    });
+
+    std::size_t total = out.size();
+    for (const auto& part : chunk_lines) {
+        total += part.size();
+    }
+
+    out.reserve(total);
+    for (auto& part : chunk_lines) {
+        std::move(part.begin(), part.end(), std::back_inserter(out));
+    }
+}
+
+[[nodiscard]] std::vector<std::string> load_lines(std::string_view text) {
+    std::vector<std::string> ret = {};
+
+    if (text.size() < PARALLEL_LOAD_SIZE) {
+        append_lines(text, ret);
+    } else {
+        append_chunks(split_on_lines(text, worker_count()), ret);
+    }
+
+    return ret;
+}
+
+// As `append_lines`, but the lines are copied one after the other into
+// `dest`, which has room for all of `text`, and `out` gets a LineRef of each
+static void copy_lines(std::string_view text, char* dest, std::vector<LineRef>& out) {
+    std::vector<std::size_t> special_chars = {};
+    scan_line_chars(text, 0, special_chars);
+
+    const auto newlines = std::count_if(
+        special_chars.begin(), special_chars.end(), [&](std::size_t i) { return text[i] == '\n'; });
+    out.reserve(out.size() + std::size_t(newlines) + 1);
+
+    const char* line_start = dest;
+    std::size_t run_start = 0;
+
+    for (const std::size_t pos : special_chars) {
+        dest = std::copy(text.begin() + run_start, text.begin() + pos, dest);
+        run_start = pos + 1;
+
+        if (text[pos] == '\n') {
+            out.emplace_back(std::string_view(line_start, std::size_t(dest - line_start)));
+            line_start = dest;
+        }
+    }
+
+    dest = std::copy(text.begin() + run_start, text.end(), dest);
+    if (dest != line_start) {
+        out.emplace_back(std::string_view(line_start, std::size_t(dest - line_start)));
+    }
+}
+
+// Chunks that follow on from each other, copied to the same place in `dest`
+// as they are in the file. Dropping CRs only ever makes a chunk shorter, so
+// they can all be split at once without overlapping
+static void copy_chunks(
+    std::span<const std::string_view> chunks,
+    char* dest,
+    std::vector<LineRef>& out) {
+    std::vector<std::vector<LineRef>> chunk_lines(chunks.size());
+    parallel_for(chunks.size(), [&](std::size_t idx) {
+        const std::size_t offset = std::size_t(chunks[idx].data() - chunks.front().data());
+        copy_lines(chunks[idx], dest + offset, chunk_lines.at(idx));
+    });
+
+    std::size_t total = out.size();
+    for (const auto& part : chunk_lines) {
+        total += part.size();
+    }
+
+    out.reserve(total);
+    for (const auto& part : chunk_lines) {
+        out.insert(out.end(), part.begin(), part.end());
+    }
+}
+
+// Split `text` into lines kept in `arena` rather than a string each
+void load_lines(std::string_view text, LineArena& arena, std::vector<LineRef>& out) {
+    if (text.empty()) { return; }
+
+    char* dest = arena.allocate(text.size());
+    if (text.size() < PARALLEL_LOAD_SIZE) {
+        copy_lines(text, dest, out);
+    } else {
+        copy_chunks(split_on_lines(text, worker_count()), dest, out);
+    }
+}
+
+FileLoader::FileLoader(MappedFile file, std::size_t offset)
+    : mapping(std::move(file)),
+      start(offset),
+      worker(std::bind_front(&FileLoader::run, this)) {}
+
+void FileLoader::run(std::stop_token stop) {
+    // Work through the file a batch of chunks at a time so progress can be
+    // reported, and so closing the buffer doesn't wait for the whole file
+    const std::string_view text = mapping.view().substr(start);
+    const std::vector<std::string_view> chunks =
+        split_on_lines(text, std::max(worker_count(), text.size() / STREAMING_CHUNK_SIZE));
+    const std::span<const std::string_view> all_chunks = chunks;
+
+    for (std::size_t idx = 0; idx < chunks.size(); idx += worker_count()) {
+        if (stop.stop_requested()) { break; }
+
+        const auto batch = all_chunks.subspan(idx, std::min(worker_count(), chunks.size() - idx));
+        const std::size_t batch_size =
+            std::size_t(batch.back().data() - batch.front().data()) + batch.back().size();
+        LoadedLines split = {};
+        copy_chunks(batch, split.arena.allocate(batch_size), split.lines);
+
+        {
+            const std::lock_guard lock(mutex);
+            loaded.arena.adopt(std::move(split.arena));
+            loaded.lines.insert(loaded.lines.end(), split.lines.begin(), split.lines.end());
+        }
+        bytes_done += batch_size;
+    }
+
+    finished = true;
+    finished.notify_all();
+}
+
+// Every line split since the last call
+[[nodiscard]] LoadedLines FileLoader::take() {
+    const std::lock_guard lock(mutex);
+    return std::exchange(loaded, LoadedLines {});
+}
+
+[[nodiscard]] bool FileLoader::done() const {
+    return finished;
+}
+
+void FileLoader::wait() {
+    finished.wait(false);
+}
+
+[[nodiscard]] unsigned int FileLoader::progress() const {
+    const std::size_t total = mapping.size - start;
+    if (!total) { return 100; }
+    return static_cast<unsigned int>(bytes_done * 100 / total);
+}
+
+// How much of `text` its first `count` lines take up
+[[nodiscard]] static std::size_t head_size(std::string_view text, std::size_t count) {
+    std::size_t ret = 0;
+    for (std::size_t i = 0; i < count && ret < text.size(); i++) {
+        const void* found = std::memchr(text.data() + ret, '\n', text.size() - ret);
+        ret = (found == nullptr) ? text.size()
+                                 : std::size_t(static_cast<const char*>(found) - text.data()) + 1;
+    }
+    return ret;
+}
+
+// Load `file` straight into the arena of a piece table, so none of its lines
+// is ever a string of its own. Only enough of a big file to fill the first
+// screen is read up front, the rest is left to a FileLoader
+[[nodiscard]] static std::optional<OpenedFile> open_piece_table(
+    const std::string& file,
+    std::size_t head_lines) {
+    MappedFile mapping(file);
+    if (!mapping.valid()) { return {}; }
+
+    const std::string_view text = mapping.view();
+    const std::size_t head_end =
+        text.size() < STREAMING_LOAD_SIZE ? text.size() : head_size(text, head_lines);
+
+    LineArena arena = {};
+    std::vector<LineRef> head = {};
+    load_lines(text.substr(0, head_end), arena, head);
+
+    OpenedFile ret = {std::make_unique<PieceTable>(std::move(arena), std::move(head))};
+    if (head_end < text.size()) {
+        ret.rest = std::make_shared<FileLoader>(std::move(mapping), head_end);
+    }
+
+    return ret;
+}
+
+// Open `file` in the backend that suits its size (see `choose_backend`). Only
+// a piece table is ever streamed in, as every file of STREAMING_LOAD_SIZE or
+// more gets one unless it can be paged
+[[nodiscard]] std::optional<OpenedFile> open_text_buffer(
+    const std::string& file,
+    std::size_t head_lines,
+    bool readonly) {
+    std::error_code err;
+    const std::size_t bytes = std::filesystem::file_size(file, err);
+    const Backend backend = choose_backend(err ? 0 : bytes, readonly);
+
+    if (backend == Backend::Paged) {
+        if (auto pages = open_file_paged(file)) { return OpenedFile {std::move(pages)}; }
+    }
+
+    if (backend == Backend::PieceTable || backend == Backend::Paged) {
+        return open_piece_table(file, head_lines);
+    }
+
+    const MappedFile mapping(file);
+    if (!mapping.valid()) { return {}; }
+    return OpenedFile {make_text_buffer(load_lines(mapping.view()), backend)};
+}
@@ -0,0 +1,56 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "mapped_file.h"
+#include "text_buffer.h"
+
+void append_lines(std::string_view, std::vector<std::string>&);
+[[nodiscard]] std::vector<std::string> load_lines(std::string_view);
+void load_lines(std::string_view, LineArena&, std::vector<LineRef>&);
+
+// Lines split out of a file, and the arena their text is kept in
+struct LoadedLines {
+    LineArena arena = {};
+    std::vector<LineRef> lines = {};
+};
+
+// Splits the remainder of a mapped file into lines on a background thread.
+// Each batch is added to `loaded` as soon as it's split, for `take()` to hand
+// over while the rest is still being read
+struct FileLoader {
+    MappedFile mapping;
+    std::size_t start;
+    std::atomic<std::size_t> bytes_done = 0;
+    std::atomic<bool> finished = false;
+    std::mutex mutex;
+    LoadedLines loaded = {};  // Guarded by `mutex`
+    std::jthread worker;  // Declared last so it's joined before the rest is destroyed
+
+    FileLoader(MappedFile, std::size_t);
+    void run(std::stop_token);
+    [[nodiscard]] LoadedLines take();
+    [[nodiscard]] bool done() const;
+    void wait();
+    [[nodiscard]] unsigned int progress() const;
+};
+
+// A file opened in the backend picked for it, see `open_text_buffer`
+struct OpenedFile {
+    std::unique_ptr<TextBuffer> buf;
+    std::shared_ptr<FileLoader> rest = nullptr;
+};
+
+[[nodiscard]] std::optional<OpenedFile> open_text_buffer(const std::string&, std::size_t, bool);
+
+#endif  // LOADER_H
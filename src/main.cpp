@@ -12,6 +12,7 @@
 
 #include "controller.h"
 #include "flags.h"
+#include "journal.h"
 #include "text_io.h"
 #include "version.h"
 
@@ -29,6 +30,9 @@ void exit_app() {
 [[noreturn]] constexpr void handler() noexcept {
     exit_app();
 
+    // Get every unsaved edit onto disk so it can be recovered
+    sync_journals();
+
     std::shared_ptr<spdlog::logger> err_log = spdlog::get("basic_logger");
     auto log_msg = [&](std::string_view sv) {
         std::println("{}", sv);
@@ -66,12 +70,6 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
-    auto filename_error = check_filename(flags.file);
-    if (!(filename_error.empty())) {
-        std::println("{}", filename_error);
-        return 0;
-    }
-
     try {
         auto logger = spdlog::basic_logger_mt("basic_logger", "iris.log");
     } catch (const spdlog::spdlog_ex& ex) { std::println("Log init failed: {}", ex.what()); }
@@ -0,0 +1,69 @@
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& file) {
+    const int fd = open(file.c_str(), O_RDONLY);
+    if (fd == -1) { return; }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size <= 0) {
+        close(fd);
+        return;
+    }
+
+    void* addr = mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping holds its own reference to the file
+    close(fd);
+    if (addr == MAP_FAILED) { return; }
+
+    // We only ever walk the file front to back when loading it
+    madvise(addr, std::size_t(st.st_size), MADV_SEQUENTIAL);
+
+    data = static_cast<const char*>(addr);
+    size = std::size_t(st.st_size);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data(std::exchange(other.data, nullptr)), size(std::exchange(other.size, 0)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        if (data != nullptr) { munmap(const_cast<char*>(data), size); }
+        data = std::exchange(other.data, nullptr);
+        size = std::exchange(other.size, 0);
+    }
+
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    if (data != nullptr) { munmap(const_cast<char*>(data), size); }
+}
+
+[[nodiscard]] bool MappedFile::valid() const {
+    return data != nullptr;
+}
+
+[[nodiscard]] std::string_view MappedFile::view() const {
+    return std::string_view(data, size);
+}
+
+// Pass an madvise() hint for the bytes [offset, offset + len) of the file
+void MappedFile::advise(std::size_t offset, std::size_t len, int advice) const {
+    if (data == nullptr || offset >= size) { return; }
+
+    // madvise wants a page aligned address
+    static const std::size_t page_size = std::size_t(sysconf(_SC_PAGESIZE));
+    const std::size_t aligned = offset - (offset % page_size);
+    len = std::min(len + (offset - aligned), size - aligned);
+
+    madvise(const_cast<char*>(data + aligned), len, advice);
+}
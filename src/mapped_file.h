@@ -0,0 +1,27 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only mmap of a file on disk. The mapping is released when this goes
+// out of scope, so any string_view taken from it must not outlive it
+struct MappedFile {
+    const char* data = nullptr;
+    std::size_t size = 0;
+
+    MappedFile() {}
+    explicit MappedFile(const std::string&);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) noexcept;
+    MappedFile& operator=(MappedFile&&) noexcept;
+    ~MappedFile();
+
+    [[nodiscard]] bool valid() const;
+    [[nodiscard]] std::string_view view() const;
+    void advise(std::size_t, std::size_t, int) const;
+};
+
+#endif  // MAPPED_FILE_H
@@ -1,39 +1,75 @@
 #include "model.h"
 
 #include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <format>
 #include <functional>
+#include <iterator>
 #include <regex>
 #include <span>
+#include <system_error>
 
 #include "action.h"
 #include "constants.h"
 #include "controller.h"
-#include "enumerate.h"
 #include "text_io.h"
 
 Model::Model(const std::size_t view_height, std::string_view file_name)
-    : buf({""}), filename(file_name) {
-    buf.reserve(view_height);
+    : filename(file_name) {
+    auto lines = std::make_unique<VectorBuffer>(std::vector<std::string> {""});
+    lines->lines.reserve(view_height);
+    buf = std::move(lines);
     set_read_only(file_name);
 }
 
-// NOTE: Intentional copy of file_chars
+// NOTE: Takes ownership of file_chars - callers that don't need their copy
+// should std::move it in to avoid duplicating the whole file in memory
 Model::Model(std::vector<std::string> file_chars, std::string_view file_name)
-    : buf(file_chars), filename(file_name) {
+    : Model(make_text_buffer(std::move(file_chars)), file_name) {}
+
+Model::Model(std::unique_ptr<TextBuffer> text, std::string_view file_name)
+    : buf(std::move(text)), filename(file_name) {
     set_read_only(file_name);
+    if (buf->read_only()) { readonly = true; }
 }
 
 [[nodiscard]] Redraw Model::backspace() {
+    if (current_char && typing_line == current_line) {
+        std::size_t count = 1;
+
+        // Same as below, a tab's worth of spaces goes in one
+        if (current_char >= TAB_SIZE) {
+            count = TAB_SIZE;
+            for (std::size_t i = current_char - TAB_SIZE; i < current_char; i++) {
+                if (WHITESPACE.find(typed.at(i)) == std::string::npos) { count = 1; }
+            }
+        }
+
+        before_edit(current_line);
+        current_char -= uint_t(count);
+        typed.erase(current_char, count);
+        mark_typed(current_line);
+        unsaved = true;
+        return Redraw(RedrawType::Line, int(count));
+    }
+
+    flush_typing();
     if (current_char == 0) {
         // Concat two lines
 
         // At top of buffer
         if (current_line == 0) { return Redraw(RedrawType::None); }
 
-        const std::size_t prev_line_len = buf.at(current_line - 1).size();
-        buf.at(current_line - 1) += buf.at(current_line);
-        buf.erase(buf.begin() + current_line);
+        const std::size_t prev_line_len = buf->at(current_line - 1).size();
+        // NOTE: Copied first, as `edit()` can move the line it's appended from
+        const std::string joined(buf->at(current_line));
+        before_edit(current_line - 1);
+        buf->edit(current_line - 1) += joined;
+        before_remove(current_line);
+        buf->erase(current_line);
+        mark_removed(current_line);
+        mark_dirty(current_line - 1);
 
         current_line--;
         current_char = static_cast<unsigned int>(prev_line_len);
@@ -42,29 +78,32 @@ Model::Model(std::vector<std::string> file_chars, std::string_view file_name)
         return Redraw(RedrawType::Screen);
     } else {
         int cursor_move_size = 0;
+        before_edit(current_line);
 
         // If we can move back TAB_SIZE chars, do so, but only if those chars are empty
         if (current_char >= TAB_SIZE &&
-            first_non_whitespace(buf.at(current_line).substr(current_char - TAB_SIZE, TAB_SIZE)) ==
+            first_non_whitespace(buf->at(current_line).substr(current_char - TAB_SIZE, TAB_SIZE)) ==
                 -1) {
-            buf.at(current_line).erase(current_char - TAB_SIZE, TAB_SIZE);
+            buf->edit(current_line).erase(current_char - TAB_SIZE, TAB_SIZE);
             current_char -= TAB_SIZE;
             cursor_move_size = TAB_SIZE;
 
         } else {
             current_char--;
-            buf.at(current_line).erase(current_char, 1);
+            buf->edit(current_line).erase(current_char, 1);
             cursor_move_size = 1;
         }
 
+        mark_dirty(current_line);
         unsaved = true;
         return Redraw(RedrawType::Line, cursor_move_size);
     }
 }
 
 [[nodiscard]] std::size_t Model::newline() {
-    std::string first = buf.at(current_line).substr(0, current_char);
-    std::string second = buf.at(current_line).substr(current_char);
+    flush_typing();
+    std::string first(buf->at(current_line).substr(0, current_char));
+    std::string second(buf->at(current_line).substr(current_char));
 
     // clean up whitespace
     std::size_t start = second.find_first_not_of(WHITESPACE);
@@ -76,7 +115,8 @@ Model::Model(std::vector<std::string> file_chars, std::string_view file_name)
         second.erase(0, 1);
     }
 
-    buf.at(current_line) = first;
+    before_edit(current_line);
+    buf->set(current_line, first);
     current_line++;
 
     if (!second.size()) { second.push_back(' '); }
@@ -90,7 +130,10 @@ Model::Model(std::vector<std::string> file_chars, std::string_view file_name)
         current_char = 0;
     }
 
-    buf.insert(buf.begin() + current_line, second);
+    before_add(current_line);
+    buf->insert(current_line, second);
+    mark_dirty(current_line - 1);
+    mark_added(current_line);
     unsaved = true;
 
     if (preceeding_ws % TAB_SIZE == 0 && preceeding_ws > 0) {
@@ -101,24 +144,39 @@ Model::Model(std::vector<std::string> file_chars, std::string_view file_name)
 }
 
 void Model::insert(const char c) {
-    buf.at(current_line).insert(current_char, 1, c);
+    before_edit(current_line);
+    if (typing) {
+        if (typing_line != current_line) {
+            flush_typing();
+            typed.load(buf->at(current_line));
+            typing_line = current_line;
+        }
+
+        typed.insert(current_char, c);
+        mark_typed(current_line);
+    } else {
+        buf->edit(current_line).insert(current_char, 1, c);
+        mark_dirty(current_line);
+    }
+
     current_char++;
     unsaved = true;
 }
 
 [[nodiscard]] bool Model::lineno_in_scope(const int idx) const {
-    return (idx < static_cast<int>(buf.size()) && idx >= 0);
+    return (idx < static_cast<int>(line_count()) && idx >= 0);
 }
 
 // Word (noun) - a sequence of characters that match regex A-Za-z0-9
 [[nodiscard]] std::optional<int> Model::next_word_pos() {
-    if (current_char == buf.at(current_line).size() - 1) {
+    const std::string_view cur_line = line(current_line);
+    if (current_char == cur_line.size() - 1) {
         return {};
-    } else if (buf.at(current_line).empty()) {
+    } else if (cur_line.empty()) {
         return {};
     }
 
-    std::string_view line_frag = std::string_view(buf.at(current_line)).substr(current_char);
+    std::string_view line_frag = std::string_view(cur_line).substr(current_char);
     uint incrementer = 0;
 
     // go to end of current "word"
@@ -143,11 +201,11 @@ void Model::insert(const char c) {
 [[nodiscard]] std::optional<int> Model::prev_word_pos() {
     if (!(current_char)) {
         return {};
-    } else if (buf.at(current_line).empty()) {
+    } else if (line(current_line).empty()) {
         return {};
     }
 
-    std::string_view line_frag = std::string_view(buf.at(current_line)).substr(0, current_char);
+    std::string_view line_frag = std::string_view(line(current_line)).substr(0, current_char);
     uint incrementer = 1;
 
     while (is_letter(line_frag.at(current_char - incrementer))) {
@@ -168,45 +226,41 @@ void Model::insert(const char c) {
 }
 
 [[nodiscard]] std::optional<unsigned int> Model::next_para_pos() {
-    if (current_line == buf.size() - 1) { return {}; }
-    auto pos = std::find_if(buf.begin() + current_line + 1, buf.end(), [](const std::string& s) {
-        return s.empty() ||
-               std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isspace(c); });
-    });
-
-    unsigned int distance =
-        static_cast<unsigned int>(std::distance(buf.begin() + current_line, pos));
-    if (current_line + distance >= buf.size()) { return buf.size() - current_line - 1; }
+    if (current_line == line_count() - 1) { return {}; }
+
+    std::size_t pos = current_line + 1;
+    while (pos < line_count() && !line_ref(pos).blank()) {
+        pos++;
+    }
+
+    unsigned int distance = static_cast<unsigned int>(pos - current_line);
+    if (current_line + distance >= line_count()) {
+        return static_cast<unsigned int>(line_count() - current_line - 1);
+    }
     return distance;
 }
 
 [[nodiscard]] std::optional<unsigned int> Model::prev_para_pos() {
     if (current_line == 0) { return {}; }
 
-    auto rev_pos = std::find_if(
-        buf.rbegin() + static_cast<long>(buf.size() - current_line + 1), buf.rend(),
-        [](const std::string& s) {
-            return s.empty() ||
-                   std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isspace(c); });
-        });
-    rev_pos++;
-    auto pos = rev_pos.base();
-    unsigned int distance =
-        static_cast<unsigned int>(std::distance(pos, buf.begin() + current_line));
-    if (distance > current_line) { return current_line; }
-    return distance;
+    // Search upward starting two lines above the cursor
+    for (std::size_t pos = current_line - 1; pos > 0; pos--) {
+        if (line_ref(pos - 1).blank()) { return static_cast<unsigned int>(current_line - pos + 1); }
+    }
+
+    return current_line;
 }
 
 [[nodiscard]] std::optional<int> Model::end_of_word_pos() {
-    if (current_char == buf.at(current_line).size() - 1) {
+    const std::string_view cur_line = line(current_line);
+    if (current_char == cur_line.size() - 1) {
         return {};
-    } else if (buf.at(current_line).empty()) {
+    } else if (cur_line.empty()) {
         return {};
     }
 
     uint incrementer = 0;
-    std::string_view line_frag =
-        std::string_view(buf.at(current_line)).substr(current_char, buf.at(current_line).size());
+    std::string_view line_frag = std::string_view(cur_line).substr(current_char, cur_line.size());
 
     // If the _next_ char is a space, we want to go past that
     if (line_frag.at(1) == ' ') { incrementer += 2; };
@@ -222,24 +276,31 @@ void Model::insert(const char c) {
 }
 
 void Model::replace_char(const char c) {
-    if (buf.at(current_line).empty()) {
-        buf.at(current_line).push_back(c);
+    flush_typing();
+    before_edit(current_line);
+    if (buf->at(current_line).empty()) {
+        buf->edit(current_line).push_back(c);
+        mark_dirty(current_line);
         return;
     }
 
-    buf.at(current_line).at(current_char) = c;
+    buf->edit(current_line).at(current_char) = c;
+    mark_dirty(current_line);
     unsaved = true;
 }
 
 void Model::toggle_case() {
-    char c = buf.at(current_line).at(current_char);
+    flush_typing();
+    before_edit(current_line);
+    char c = buf->at(current_line).at(current_char);
 
     if (c >= 'A' && c <= 'Z') {
-        buf.at(current_line).at(current_char) = c + 32;
+        buf->edit(current_line).at(current_char) = c + 32;
     } else if (c >= 'a' && c <= 'z') {
-        buf.at(current_line).at(current_char) = c - 32;
+        buf->edit(current_line).at(current_char) = c - 32;
     }
 
+    mark_dirty(current_line);
     unsaved = true;
 }
 
@@ -247,11 +308,12 @@ void Model::toggle_case() {
     unsigned int cur_line = current_line;
     int cur_char = int32_t(current_char);
 
-    for (; cur_line < buf.size(); cur_line++) {
-        auto iter = std::find(buf.at(cur_line).begin() + cur_char + 1, buf.at(cur_line).end(), c);
+    for (; cur_line < line_count(); cur_line++) {
+        const std::string_view text = line(cur_line);
+        auto iter = std::find(text.begin() + cur_char + 1, text.end(), c);
 
-        if (iter != buf.at(cur_line).end()) {
-            cur_char = int32_t(std::distance(buf.at(cur_line).begin(), iter));
+        if (iter != text.end()) {
+            cur_char = int32_t(std::distance(text.begin(), iter));
 
             // line is a relative value, char is an absolute value
             return rawterm::Pos(
@@ -268,14 +330,14 @@ void Model::toggle_case() {
     while (cur_line) {
         if (cur_line == current_line) {
             const std::string_view search_area =
-                std::string_view(buf.at(current_line)).substr(0, current_char);
+                std::string_view(line(current_line)).substr(0, current_char);
             const auto pos = search_area.find_last_of(c);
             if (pos != std::string::npos) {
                 return rawterm::Pos(static_cast<int>(current_line), static_cast<int>(pos));
             }
 
         } else {
-            const auto pos = buf.at(cur_line).find_last_of(c);
+            const auto pos = line(cur_line).find_last_of(c);
 
             if (pos != std::string::npos) {
                 return rawterm::Pos(static_cast<int>(cur_line), static_cast<int>(pos));
@@ -288,167 +350,266 @@ void Model::toggle_case() {
     return {};
 }
 
+// Put back the lines the last change replaced, a hunk at a time from the
+// last one made.
+// NOTE: The cursor is left where it is, only moved back inside the buffer if
+// it's now past the end of it
 [[nodiscard]] bool Model::undo(const int height) {
-    if (!undo_stack.size()) { return false; }
-
-    Change cur_change = undo_stack.at(undo_stack.size() - 1);
-    undo_stack.pop_back();
-    redo_stack.push(cur_change);
-
-    rawterm::Pos cur_pos = {int32_t(current_line), int32_t(current_char)};
-    current_line = cur_change.line_pos;
-    current_char = cur_change.char_pos;
-
-    // NOTE: Currently we are not moving the cursor alongside an undo update
-    // as we're restoring the model position after the undo. While these are
-    // separate values, keeping them in sync is currently easier this way.
-    // I want to see how using it feels and if I need to update the cursor or
-    // not during usage
-    switch (cur_change.action) {
-        case ActionType::Backspace:
-            current_char--;
-            [[fallthrough]];
-        case ActionType::DelCurrentChar: {
-            insert(cur_change.payload.value());
-        } break;
-
-        case ActionType::Newline: {
-            current_char = 0;
-            current_line++;
-            std::ignore = backspace();
-        } break;
-
-        case ActionType::ToggleCase: {
-            toggle_case();
-        } break;
-
-        case ActionType::InsertChar: {
-            std::ignore = backspace();
-        } break;
-
-        case ActionType::ReplaceChar: {
-            const char cur_char = cur_change.payload.value();
-            redo_stack.top().payload = get_current_char();
-            replace_char(cur_char);
-        } break;
-
-        case ActionType::DelCurrentLine: {
-            if (cur_change.text.has_value()) {
-                buf.insert(buf.begin() + cur_change.line_pos, cur_change.text.value());
-            }
-        } break;
+    restore_history();
+    const std::optional<UndoStep> step = undo_log.undo_step();
+    if (!step.has_value()) { return false; }
 
-        case ActionType::DelCurrentWord: {
-            if (cur_change.text.has_value()) {
-                buf.at(current_line).insert(current_char, cur_change.text.value());
-            }
-        } break;
+    flush_typing();
+    return take_steps({step.value()}) < view_offset + uint_t(height);
+}
 
-        case ActionType::IndentLine: {
-            dedent_curr_line();
-        } break;
+[[nodiscard]] char Model::get_current_char() const {
+    return line(current_line).at(current_char);
+}
 
-        case ActionType::DedentLine: {
-            indent_curr_line();
-        } break;
+[[nodiscard]] bool Model::redo(const int height) {
+    restore_history();
+    const std::optional<UndoStep> step = undo_log.redo_step();
+    if (!step.has_value()) { return false; }
 
-        default:
-            break;
-    };
+    flush_typing();
+    return take_steps({step.value()}) < view_offset + uint_t(height);
+}
 
-    if (!undo_stack.size()) { unsaved = false; }
+// Jump straight to state `target` of the undo tree, however far away it is.
+// If a snapshot is a lot closer to it than the buffer is, the buffer is swapped
+// for that and only the changes from there are made
+[[nodiscard]] bool Model::go_to_state(const std::size_t target, const int height) {
+    restore_history();
+    if (target > undo_log.size() || target == undo_log.current) { return false; }
+    flush_typing();
+
+    std::vector<UndoStep> steps = undo_log.route(undo_log.current, target);
+    std::size_t first = std::string::npos;
+
+    std::optional<std::size_t> from = std::nullopt;
+    for (const auto& snapshot : snapshots) {
+        std::vector<UndoStep> rest = undo_log.route(snapshot.first, target);
+        if (rest.size() + UNDO_SNAPSHOT_INTERVAL < steps.size()) {
+            steps = std::move(rest);
+            from = snapshot.first;
+        }
+    }
 
-    current_line = uint32_t(cur_pos.vertical);
-    current_char = uint32_t(cur_pos.horizontal);
+    if (from.has_value()) {
+        first = restore_snapshot(*snapshots.at(from.value()));
+        undo_log.current = from.value();
+    }
 
-    if (view_offset <= cur_change.line_pos) { return true; }
-    if (cur_change.line_pos <= view_offset + uint32_t(height)) { return true; }
+    first = std::min(first, take_steps(steps));
+    return first < view_offset + uint_t(height);
+}
 
-    return false;
+// As `go_to_state`, to the state `amount` changes or seconds away (see
+// `UndoLog::travel`)
+[[nodiscard]] bool Model::travel(const int64_t amount, const bool seconds, const int height) {
+    restore_history();
+    return go_to_state(undo_log.travel(amount, seconds), height);
 }
 
-[[nodiscard]] char Model::get_current_char() const {
-    return buf.at(current_line).at(current_char);
+// Take the buffer through `steps` of the undo tree, a change at a time.
+// Returns the first line any of them touched
+[[nodiscard]] std::size_t Model::take_steps(const std::vector<UndoStep>& steps) {
+    std::size_t first = std::string::npos;
+
+    for (const UndoStep& step : steps) {
+        const std::string_view record = undo_log.record(step.seq);
+        if (record.empty()) { break; }
+
+        const std::span<const LoggedHunk> hunks = undo_log.hunks(record);
+        if (step.undo) {
+            for (auto hunk = hunks.rbegin(); hunk != hunks.rend(); hunk++) {
+                splice_lines(
+                    hunk->first, hunk->after_count,
+                    undo_log.lines(record, hunk->before, hunk->before_count));
+                first = std::min(first, hunk->first);
+            }
+        } else {
+            for (const LoggedHunk& hunk : hunks) {
+                splice_lines(
+                    hunk.first, hunk.before_count,
+                    undo_log.lines(record, hunk.after, hunk.after_count));
+                first = std::min(first, hunk.first);
+            }
+        }
+
+        undo_log.step(step);
+    }
+
+    unsaved = undo_log.current != undo_log.clean;
+    clamp_cursor();
+    return first;
 }
 
-[[nodiscard]] bool Model::redo(const int height) {
-    if (!redo_stack.size()) { return false; }
+// Swap the buffer for an earlier snapshot of it. Only the lines that differ
+// between the two are reported as changed, and returns the first of them
+[[nodiscard]] std::size_t Model::restore_snapshot(const BufferState& snapshot) {
+    const std::vector<LineSpan> spans = buf->restore_state(snapshot);
 
-    const Change cur_change = redo_stack.top();
-    redo_stack.pop();
-    undo_stack.push_back(cur_change);
-    if (undo_stack.size()) { unsaved = true; }
+    for (const LineSpan& span : spans) {
+        mark_spliced(span.first, span.removed, span.added);
+    }
 
-    rawterm::Pos cur_pos = {int32_t(current_line), int32_t(current_char)};
-    current_line = cur_change.line_pos;
-    current_char = cur_change.char_pos;
+    return spans.empty() ? std::string::npos : spans.front().first;
+}
 
-    switch (cur_change.action) {
-        case ActionType::Backspace: {
-            std::ignore = backspace();
-        } break;
+// Every edit made until the matching `end_undo_group` is undone in one go.
+// Groups can be nested, only the outermost one makes a change
+void Model::begin_undo_group() {
+    if (undo_group.depth++) { return; }
 
-        case ActionType::DelCurrentChar: {
-            current_char++;
-            std::ignore = backspace();
-        } break;
+    undo_group.change = {{}, current_line, current_char};
+    undo_group.end = 0;
+}
 
-        case ActionType::Newline: {
-            std::ignore = newline();
-        } break;
+void Model::end_undo_group() {
+    if (!undo_group.depth || --undo_group.depth) { return; }
+
+    close_hunk();
+    Change change = std::move(undo_group.change);
+    undo_group.change = {};
+
+    // Typing a word and then deleting it is nothing to undo
+    std::erase_if(change.hunks, [](const Hunk& hunk) { return hunk.before == hunk.after; });
+    if (change.hunks.empty()) { return; }
+
+    restore_history();
+    const int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count();
+    const std::size_t seq = undo_log.append(change, now);
+
+    // Every so often a copy of the buffer is kept for `go_to_state` to start
+    // from, by the backends that can keep one without copying every line.
+    // NOTE: Not while the file is loading, as going back to it would drop
+    // every line read since
+    if (seq % UNDO_SNAPSHOT_INTERVAL == 0 && typing_line == std::string::npos && !loading()) {
+        if (auto snapshot = buf->keep_state()) { snapshots[seq] = std::move(snapshot); }
+        if (snapshots.size() > UNDO_SNAPSHOTS) { snapshots.erase(snapshots.begin()); }
+    }
+}
 
-        case ActionType::ToggleCase: {
-            toggle_case();
-        } break;
+// An edit has to say what it's about to change, while the lines are still as
+// they were, so an open undo group can keep the old lines. As with
+// `mark_dirty`, each of these is for a single line
+void Model::before_edit(const std::size_t idx) {
+    cover_lines(idx, idx + 1);
+}
 
-        case ActionType::InsertChar: {
-            current_char--;
-            insert(cur_change.payload.value());
-        } break;
+void Model::before_add(const std::size_t idx) {
+    if (!undo_group.depth) { return; }
+    cover_lines(idx, idx);
+    undo_group.end++;
+}
 
-        case ActionType::ReplaceChar: {
-            replace_char(cur_change.payload.value());
-        } break;
+void Model::before_remove(const std::size_t idx) {
+    if (!undo_group.depth) { return; }
+    cover_lines(idx, idx + 1);
+    undo_group.end--;
+}
 
-        case ActionType::DelCurrentLine: {
-            delete_current_line();
-        } break;
+// Grow the last hunk of the open undo group to take in lines [from, to). Lines
+// that aren't next to it start a hunk of their own instead
+void Model::cover_lines(const std::size_t from, const std::size_t to) {
+    if (!undo_group.depth) { return; }
 
-        case ActionType::DelCurrentWord: {
-            delete_current_word({cur_change.text.value(), current_char, current_line});
-        } break;
+    std::vector<Hunk>& hunks = undo_group.change.hunks;
+    if (hunks.empty() || to < hunks.back().first || from > undo_group.end) {
+        close_hunk();
+        hunks.push_back({from, {}, {}});
+        undo_group.end = from;
+    }
 
-        case ActionType::IndentLine: {
-            indent_curr_line();
-        } break;
+    Hunk& hunk = hunks.back();
+    if (from < hunk.first) {
+        std::vector<std::string> above = {};
+        for (std::size_t idx = from; idx < hunk.first; idx++) {
+            above.emplace_back(line(idx));
+        }
+        hunk.before.insert(
+            hunk.before.begin(), std::make_move_iterator(above.begin()),
+            std::make_move_iterator(above.end()));
+        hunk.first = from;
+    }
 
-        case ActionType::DedentLine: {
-            dedent_curr_line();
-        } break;
+    for (; undo_group.end < to; undo_group.end++) {
+        hunk.before.emplace_back(line(undo_group.end));
+    }
+}
 
-        default:
-            break;
-    };
+// Fill in what the last hunk of the open group holds now. It won't grow again
+void Model::close_hunk() {
+    std::vector<Hunk>& hunks = undo_group.change.hunks;
+    if (hunks.empty()) { return; }
 
-    current_line = uint32_t(cur_pos.vertical);
-    current_char = uint32_t(cur_pos.horizontal);
-    if ((view_offset <= cur_change.line_pos) ||
-        (cur_change.line_pos <= view_offset + uint32_t(height))) {
-        return true;
+    Hunk& hunk = hunks.back();
+    for (std::size_t idx = hunk.first; idx < undo_group.end; idx++) {
+        hunk.after.emplace_back(line(idx));
     }
+}
 
-    return false;
+// Swap `count` lines from `first` for `lines` in a single splice, and report
+// each line that changed
+void Model::splice_lines(
+    const std::size_t first,
+    const std::size_t count,
+    const std::vector<std::string>& lines) {
+    buf->splice(first, count, lines);
+    mark_spliced(first, count, lines.size());
+}
+
+// Report `count` lines from `first` as having been swapped for `added` others
+void Model::mark_spliced(
+    const std::size_t first,
+    const std::size_t count,
+    const std::size_t added) {
+    const std::size_t common = std::min(count, added);
+    for (std::size_t i = 0; i < common; i++) {
+        mark_dirty(first + i);
+    }
+    for (std::size_t i = common; i < added; i++) {
+        mark_added(first + i);
+    }
+    for (std::size_t i = common; i < count; i++) {
+        mark_removed(first + common);
+    }
+}
+
+// Keep the cursor inside the buffer after lines were taken out from under it
+void Model::clamp_cursor() {
+    current_line = std::min(current_line, uint_t(buf->size() - 1));
+    current_char = std::min(current_char, uint_t(buf->at(current_line).size()));
+    view_offset = std::min(view_offset, current_line);
 }
 
 [[nodiscard]] bool Model::move_line_down() {
-    if (current_line == buf.size() - 1) { return false; }
-    std::iter_swap(buf.begin() + current_line, buf.begin() + current_line + 1);
+    flush_typing();
+    if (current_line == buf->size() - 1) { return false; }
+    std::string below(buf->at(current_line + 1));
+    before_edit(current_line);
+    before_edit(current_line + 1);
+    buf->set(current_line + 1, std::string(buf->at(current_line)));
+    buf->set(current_line, std::move(below));
+    mark_dirty(current_line);
+    mark_dirty(current_line + 1);
     return true;
 }
 
 [[nodiscard]] bool Model::move_line_up() {
+    flush_typing();
     if (!current_line) { return false; }
-    std::iter_swap(buf.begin() + current_line, buf.begin() + current_line - 1);
+    std::string above(buf->at(current_line - 1));
+    before_edit(current_line - 1);
+    before_edit(current_line);
+    buf->set(current_line - 1, std::string(buf->at(current_line)));
+    buf->set(current_line, std::move(above));
+    mark_dirty(current_line - 1);
+    mark_dirty(current_line);
     return true;
 }
 
@@ -459,23 +620,26 @@ void Model::set_read_only(std::string_view file) {
 }
 
 void Model::delete_current_line() {
-    buf.erase(buf.begin() + current_line);
-    current_line = (current_line < buf.size() - 1) ? current_line : uint_t(buf.size() - 1);
+    flush_typing();
+    before_remove(current_line);
+    buf->erase(current_line);
+    mark_removed(current_line);
+    current_line = (current_line < buf->size() - 1) ? current_line : uint_t(buf->size() - 1);
     unsaved = true;
-    if (buf.at(current_line).size() < current_char) {
-        current_char = uint_t(buf.at(current_line).size());
+    if (buf->at(current_line).size() < current_char) {
+        current_char = uint_t(buf->at(current_line).size());
     }
 }
 
 [[nodiscard]] const std::optional<WordPos> Model::current_word() const {
     WordPos ret = {"", 0, 0};
-    const std::string* cur_line = &buf.at(current_line);
+    const std::string_view cur_line = line(current_line);
     uint_t start = current_char;
 
     // "Start" is already at the end of the line
-    if (start == cur_line->size()) { return {}; }
+    if (start == cur_line.size()) { return {}; }
 
-    while (start && is_letter(cur_line->at(start))) {
+    while (start && is_letter(cur_line.at(start))) {
         start--;
     }
 
@@ -484,18 +648,21 @@ void Model::delete_current_line() {
 
     uint_t len = uint_t(
         std::distance(
-            cur_line->begin() + start,
-            std::find_if(cur_line->begin() + start, cur_line->end(), std::not_fn(is_letter))));
+            cur_line.begin() + start,
+            std::find_if(cur_line.begin() + start, cur_line.end(), std::not_fn(is_letter))));
 
     ret.start_pos = start;
-    ret.text = cur_line->substr(start, len);
+    ret.text = cur_line.substr(start, len);
     ret.lineno = current_line;
     return ret;
 }
 
 void Model::delete_current_word(const WordPos pos) {
+    flush_typing();
     unsaved = true;
-    buf.at(pos.lineno).erase(pos.start_pos, pos.text.size());
+    before_edit(pos.lineno);
+    buf->edit(pos.lineno).erase(pos.start_pos, pos.text.size());
+    mark_dirty(pos.lineno);
 }
 
 [[nodiscard]] std::vector<std::string> Model::search_text(const std::string& input) const {
@@ -503,10 +670,12 @@ void Model::delete_current_word(const WordPos pos) {
     ret.reserve(7);
 
     auto re = std::regex(input);
-    for (const auto&& [idx, line] : enumerate<const std::string>(buf)) {
-        if (std::regex_search(line, re)) {
+    for (std::size_t idx = 0; idx < line_count(); idx++) {
+        const std::string_view text = line(idx);
+        if (std::regex_search(text.begin(), text.end(), re)) {
             // TODO: Truncate line?
-            const std::string highlighted_line = std::regex_replace(line, re, "\x1b[7m$&\x1b[0m");
+            const std::string highlighted_line =
+                std::regex_replace(std::string(text), re, "\x1b[7m$&\x1b[0m");
             ret.push_back(std::format("|{}| {}", idx + 1, highlighted_line));
         }
 
@@ -528,14 +697,29 @@ void Model::search_and_replace(const std::string& input) {
         logger->info("Find: '" + parts.at(0) + "' Replace: '" + parts.at(1) + "'");
     }
     auto find = std::regex(parts.at(0));
+    flush_typing();
+
+    // Every line replaced is undone in one go. Only those lines go into the
+    // undo group, with runs of them next to each other kept as one hunk
+    auto replace_line = [&](const std::size_t idx) {
+        std::string replaced = std::regex_replace(std::string(buf->at(idx)), find, parts.at(1));
+        if (replaced == buf->at(idx)) { return; }
 
+        before_edit(idx);
+        buf->set(idx, std::move(replaced));
+        mark_dirty(idx);
+        unsaved = true;
+    };
+
+    begin_undo_group();
     if (parts.size() == 3 && parts.at(2).find('m') <= parts.at(2).size()) {
-        for (auto& line : buf) {
-            line = std::regex_replace(line, find, parts.at(1));
+        for (std::size_t idx = 0; idx < buf->size(); idx++) {
+            replace_line(idx);
         }
     } else {
-        buf.at(current_line) = std::regex_replace(buf.at(current_line), find, parts.at(1));
+        replace_line(current_line);
     }
+    end_undo_group();
 }
 
 // NOTE: This is the "find next" used for finding from the command line
@@ -547,28 +731,33 @@ std::optional<rawterm::Pos> Model::find_next_str(std::string_view sv) {
     // position in the line. This is faster than two complete iterations
     // over the buffer using std::find
     // NOTE: + 1 to avoid searching the current line (cursor may go backward in current line)
-    std::span forward_buf = std::span {buf.begin() + current_line + 1, buf.end()};
-    for (const auto&& [idx, line] : enumerate<std::string>(forward_buf, 1)) {
-        if (!line.contains(search_str)) { continue; }
-        const std::size_t str_pos = line.find(search_str);
-        return rawterm::Pos {int32_t(current_line + idx), int32_t(str_pos)};
+    for (std::size_t idx = current_line + 1; idx < line_count(); idx++) {
+        const std::size_t str_pos = line(idx).find(search_str);
+        if (str_pos == std::string::npos) { continue; }
+        return rawterm::Pos {int32_t(idx), int32_t(str_pos)};
     }
 
     return std::nullopt;
 }
 
 void Model::indent_curr_line() {
-    if (buf.at(current_line).size()) { buf.at(current_line).insert(0, TAB_SIZE, ' '); }
+    flush_typing();
+    if (!buf->at(current_line).size()) { return; }
+    before_edit(current_line);
+    buf->edit(current_line).insert(0, TAB_SIZE, ' ');
+    mark_dirty(current_line);
 }
 
 void Model::dedent_curr_line() {
-    auto offset = buf.at(current_line).find_first_not_of(' ');
+    flush_typing();
+    auto offset = buf->at(current_line).find_first_not_of(' ');
     if (offset == 0) { return; }
     unsaved = true;
 
     const std::size_t to_delete = std::min(4ul, offset);
-    const std::size_t line_size = buf.at(current_line).size();
-    buf.at(current_line) = buf.at(current_line).substr(to_delete, line_size);
+    before_edit(current_line);
+    buf->edit(current_line).erase(0, to_delete);
+    mark_dirty(current_line);
 }
 
 void Model::add_mark(const char c) {
@@ -590,3 +779,286 @@ void Model::add_mark(const char c) {
         return true;
     } catch (const std::out_of_range& e) { return false; }
 }
+
+// Write mode types into a gap buffer of the current line, so a keystroke
+// doesn't move the rest of the line (see `insert`). It goes back into `buf`
+// when the cursor leaves the line, Write mode ends, or anything else edits
+// the buffer. Everything typed in one visit to Write mode is a single undo
+void Model::start_typing() {
+    if (!typing) { begin_undo_group(); }
+    typing = true;
+}
+
+void Model::stop_typing() {
+    flush_typing();
+    if (typing) { end_undo_group(); }
+    typing = false;
+}
+
+void Model::flush_typing() {
+    if (typing_line == std::string::npos) { return; }
+
+    const std::size_t idx = typing_line;
+    typing_line = std::string::npos;
+    buf->set(idx, typed.str());
+    mark_dirty(idx);
+}
+
+// Saving only rewrites the file from the lowest line changed since the
+// last save, only tidies up the lines that were changed, and the journal
+// needs every edit to be able to replay them. So every edit to `buf` has to
+// report where it happened, once it's been made
+void Model::mark_dirty(const std::size_t idx) {
+    dirty_from = std::min(dirty_from, idx);
+    dirty_lines.set(idx);
+    version++;
+
+    if (offsets.has_value()) { offsets->set(idx, buf->at(idx).size()); }
+    if (Journal* j = edit_journal()) { j->set_line(idx, buf->at(idx)); }
+}
+
+// As `mark_dirty`, for a keystroke into the typing line. The journal only
+// gets the line once it's flushed
+void Model::mark_typed(const std::size_t idx) {
+    dirty_from = std::min(dirty_from, idx);
+    dirty_lines.set(idx);
+    version++;
+
+    if (offsets.has_value()) { offsets->set(idx, typed.size()); }
+}
+
+void Model::mark_added(const std::size_t idx) {
+    dirty_from = std::min(dirty_from, idx);
+    dirty_lines.insert(idx);
+    version++;
+
+    if (offsets.has_value()) { offsets->insert(idx, buf->at(idx).size()); }
+    if (Journal* j = edit_journal()) { j->insert_line(idx, buf->at(idx)); }
+}
+
+void Model::mark_removed(const std::size_t idx) {
+    dirty_from = std::min(dirty_from, idx);
+    dirty_lines.erase(idx);
+    version++;
+
+    if (offsets.has_value()) { offsets->erase(idx); }
+    if (Journal* j = edit_journal()) { j->erase_line(idx); }
+}
+
+// The journal to record an edit in, opened on the first edit since the file
+// was last saved. Only files on disk get one.
+// NOTE: Edits left behind by a crash are kept until they're recovered or
+// discarded, this buffer's edits are only journaled once they're gone
+[[nodiscard]] Journal* Model::edit_journal() {
+    if (journal != nullptr) { return journal.get(); }
+    if (type != ModelType::BUF || filename == "" || filename == "NO NAME") { return nullptr; }
+
+    const FileStamp base =
+        disk_synced ? disk_stamp : file_stamp(filename).value_or(FileStamp());
+    const bool replace = journal_spent || !read_journal(filename).has_value();
+    journal = std::make_shared<Journal>(filename, base, replace);
+    return journal.get();
+}
+
+// Apply edits read back from the journal, as if they'd just been made
+[[nodiscard]] bool Model::replay(const std::vector<JournalEntry>& entries) {
+    if (buf->read_only()) { return false; }
+    flush_typing();
+
+    // The buffer won't match the file any history was kept for
+    history_checked = true;
+    journal_spent = true;
+
+    // Everything recovered is one change, so it can be undone in one step and
+    // is part of the history `go_to_state` moves through
+    bool applied = true;
+    begin_undo_group();
+    for (const auto& entry : entries) {
+        switch (entry.op) {
+            case JournalOp::SetLine:
+                applied = entry.idx < buf->size();
+                if (!applied) { break; }
+                before_edit(entry.idx);
+                buf->set(entry.idx, entry.text);
+                mark_dirty(entry.idx);
+                break;
+            case JournalOp::InsertLine:
+                applied = entry.idx <= buf->size();
+                if (!applied) { break; }
+                before_add(entry.idx);
+                buf->insert(entry.idx, entry.text);
+                mark_added(entry.idx);
+                break;
+            case JournalOp::EraseLine:
+                applied = entry.idx < buf->size();
+                if (!applied) { break; }
+                before_remove(entry.idx);
+                buf->erase(entry.idx);
+                mark_removed(entry.idx);
+                break;
+        };
+
+        if (!applied) { break; }
+    }
+    end_undo_group();
+
+    unsaved = undo_log.current != undo_log.clean;
+    return applied;
+}
+
+// Throw away the edits a crash left behind. If this buffer has been edited
+// since, its own journal takes their place
+void Model::discard_journal() {
+    journal_spent = true;
+    if (journal == nullptr) {
+        std::error_code ec;
+        std::filesystem::remove(journal_path(filename), ec);
+    } else if (journal->fd == -1) {
+        journal->rebase(filename, journal->base, 0);
+    }
+}
+
+// Pick up the undo history an earlier session kept for the file, the first
+// time the history is needed. Only files on disk have one
+void Model::restore_history() {
+    if (history_checked) { return; }
+    history_checked = true;
+    if (type != ModelType::BUF || readonly || filename == "" || filename == "NO NAME") { return; }
+
+    undo_log.path = undo_path(filename);
+    if (undo_log.path.empty() || !file_exists(undo_log.path)) { return; }
+    std::ignore = undo_log.restore(undo_log.path, file_hash(filename).value_or(0));
+}
+
+// Hand `job` a copy of the undo history to keep with the file it writes, for
+// the next time it's opened. Nothing is spilled out of the log until the job
+// is finished with, as the copy may be writing to the same file
+void Model::keep_history(SaveJob& job) {
+    if (!undo_log.can_undo() && !undo_log.can_redo()) { return; }
+
+    job.history = std::make_shared<UndoLog>(undo_log);
+    job.history_path = undo_path(job.filename);
+    undo_log.held = true;
+}
+
+// `job` is done with, and the copy of the history it had is now where the
+// log is kept if `kept`
+void Model::save_history(const SaveJob& job, const bool kept) {
+    undo_log.held = false;
+    if (!kept) { return; }
+
+    undo_log.path = job.history->path;
+    undo_log.kept = job.history->kept;
+}
+
+[[nodiscard]] std::string_view Model::line(const std::size_t idx) const {
+    if (idx == typing_line) { return typed.str(); }
+    return buf->at(idx);
+}
+
+[[nodiscard]] LineRef Model::line_ref(const std::size_t idx) const {
+    if (idx == typing_line) { return LineRef(typed.str()); }
+    return buf->line_ref(idx);
+}
+
+// As `line`, but the line being typed into is read where it is rather than
+// put back together, so reading it doesn't copy the whole line
+[[nodiscard]] LineParts Model::line_parts(const std::size_t idx) const {
+    if (idx == typing_line) { return typed.parts(); }
+    return {buf->at(idx), "", buf->line_ref(idx).has_tabs()};
+}
+
+[[nodiscard]] std::size_t Model::line_size(const std::size_t idx) const {
+    if (idx == typing_line) { return typed.size(); }
+    return buf->at(idx).size();
+}
+
+[[nodiscard]] std::size_t Model::line_count() const {
+    return buf->size();
+}
+
+// Every line has to be there to count from, so this waits for the file to
+// finish loading the first time
+[[nodiscard]] const OffsetIndex& Model::offset_index() {
+    if (offsets.has_value()) { return offsets.value(); }
+    wait_for_load();
+
+    std::vector<std::size_t> lengths = {};
+    lengths.reserve(line_count());
+    for (std::size_t i = 0; i < line_count(); i++) {
+        lengths.push_back(line(i).size());
+    }
+
+    return offsets.emplace(std::move(lengths));
+}
+
+// Where line idx starts, counting from the start of the file
+[[nodiscard]] std::size_t Model::offset_of(const std::size_t idx) {
+    return offset_index().offset_of(idx);
+}
+
+// The line the byte at `offset` is in
+[[nodiscard]] std::size_t Model::line_at(const std::size_t offset) {
+    return offset_index().line_at(offset);
+}
+
+// Move the buffer into another kind of storage
+void Model::set_backend(const Backend backend) {
+    flush_typing();
+    buf = make_text_buffer(buf->to_vector(), backend);
+    snapshots.clear();
+}
+
+// Tabs are kept in the buffer and only expanded when drawn, so a char's index
+// in the line isn't always the column it's drawn at
+[[nodiscard]] std::size_t Model::display_col(const std::size_t idx, const std::size_t pos) const {
+    // NOTE: The line being typed into changes on every key, so there's no
+    // point keeping its columns
+    if (idx == typing_line) { return column_of(typed.parts(), pos); }
+    if (!line_ref(idx).has_tabs()) { return pos; }
+
+    if (idx != columns.line || version != columns.version) {
+        columns.line = idx;
+        columns.version = version;
+        columns.cols = tab_columns(line(idx));
+    }
+
+    if (columns.cols.empty()) { return pos; }
+    if (pos < columns.cols.size()) { return columns.cols.at(pos); }
+
+    // Past the end of the line
+    return columns.cols.back() + pos - (columns.cols.size() - 1);
+}
+
+[[nodiscard]] bool Model::loading() const {
+    return loader != nullptr;
+}
+
+// Append whatever more of the file the background loader has read, so what
+// can be moved around in grows as it goes. Returns true if the buffer changed
+// or the load finished.
+// NOTE: Lines past the last one read are never edited until it's all been
+// read (see `Controller::is_readonly_model`), so the rest always belongs at
+// the very end of the buffer
+[[nodiscard]] bool Model::poll_load() {
+    if (loader == nullptr) { return false; }
+
+    // Checked before taking the lines, so none read after can be left behind
+    const bool finished = loader->done();
+    LoadedLines loaded = loader->take();
+    if (finished) { loader = nullptr; }
+    if (loaded.lines.empty()) { return finished; }
+
+    buf->adopt(std::move(loaded.arena), std::move(loaded.lines));
+    return true;
+}
+
+void Model::wait_for_load() {
+    if (loader == nullptr) { return; }
+    loader->wait();
+    std::ignore = poll_load();
+}
+
+[[nodiscard]] unsigned int Model::load_progress() const {
+    return loader == nullptr ? 100 : loader->progress();
+}
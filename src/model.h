@@ -1,8 +1,10 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include <cstdint>
+#include <map>
+#include <memory>
 #include <optional>
-#include <stack>
 #include <string>
 #include <string_view>
 #include <unordered_map>
@@ -11,6 +13,15 @@
 #include <rawterm/screen.h>
 
 #include "change.h"
+#include "dirty_lines.h"
+#include "gap_buffer.h"
+#include "journal.h"
+#include "loader.h"
+#include "offset_index.h"
+#include "rope.h"
+#include "save.h"
+#include "text_buffer.h"
+#include "undo_log.h"
 
 // Forward declare from controller.h
 struct Redraw;
@@ -38,9 +49,17 @@ struct Mark {
     }
 };
 
+// Column each char of a line is drawn at (see `tab_columns`), kept for the
+// last line asked about until the buffer's next edit (see `Model::version`)
+struct ColumnMap {
+    std::size_t line = std::string::npos;
+    std::size_t version = 0;
+    std::vector<std::size_t> cols = {};
+};
+
 struct Model {
     ModelType type = ModelType::BUF;
-    std::vector<std::string> buf;
+    std::unique_ptr<TextBuffer> buf;
     std::string filename;
     unsigned int current_line = 0;  // 0-indexed
     unsigned int current_char = 0;  // 0-indexed
@@ -54,11 +73,53 @@ struct Model {
     bool readonly = false;
     bool unsaved = false;
 
-    std::vector<Change> undo_stack = {};
-    std::stack<Change> redo_stack = {};
+    // Lowest line changed since the file was last written, and whether the
+    // lines before it are known to match the file on disk byte for byte
+    std::size_t dirty_from = std::string::npos;
+    DirtyLines dirty_lines = {};
+    bool disk_synced = false;
+    FileStamp disk_stamp = {};
+
+    // Bumped on every edit, so a background save can tell if the buffer
+    // changed while it was writing
+    std::size_t version = 0;
+
+    UndoLog undo_log = {};
+    UndoGroup undo_group = {};
+    // A copy of the buffer every UNDO_SNAPSHOT_INTERVAL states, by state, for
+    // backends that can keep one (see `TextBuffer::keep_state`)
+    std::map<std::size_t, std::shared_ptr<const BufferState>> snapshots = {};
+
+    // Byte offset of every line, built the first time one is asked for and
+    // kept up to date by every edit after that
+    std::optional<OffsetIndex> offsets = {};
+
+    // Set while the rest of a large file is still being read in the background
+    std::shared_ptr<FileLoader> loader = nullptr;
+
+    // Set while a snapshot of the buffer is being written out
+    std::shared_ptr<BackgroundSave> saving = nullptr;
+
+    // Crash recovery record of the edits made since the last save, whether
+    // we've looked for one left behind by a previous crash, whether it's still
+    // waiting on `;recover` or `;discard`, and whether that's since been done
+    std::shared_ptr<Journal> journal = nullptr;
+    bool journal_checked = false;
+    bool journal_pending = false;
+    bool journal_spent = false;
+    bool history_checked = false;
+
+    // In Write mode the line being typed into is kept here rather than in
+    // `buf` (see `start_typing`)
+    bool typing = false;
+    std::size_t typing_line = std::string::npos;
+    GapLine typed = {};
+
+    mutable ColumnMap columns = {};
 
     Model(std::size_t, std::string_view);
     Model(std::vector<std::string>, std::string_view);
+    Model(std::unique_ptr<TextBuffer>, std::string_view);
     [[nodiscard]] Redraw backspace();
     [[nodiscard]] std::size_t newline();
     void insert(const char);
@@ -75,6 +136,20 @@ struct Model {
     [[nodiscard]] bool undo(const int);
     [[nodiscard]] char get_current_char() const;
     [[nodiscard]] bool redo(const int);
+    [[nodiscard]] bool go_to_state(const std::size_t, const int);
+    [[nodiscard]] bool travel(const int64_t, const bool, const int);
+    [[nodiscard]] std::size_t take_steps(const std::vector<UndoStep>&);
+    [[nodiscard]] std::size_t restore_snapshot(const BufferState&);
+    void begin_undo_group();
+    void end_undo_group();
+    void before_edit(const std::size_t);
+    void before_add(const std::size_t);
+    void before_remove(const std::size_t);
+    void cover_lines(const std::size_t, const std::size_t);
+    void close_hunk();
+    void splice_lines(const std::size_t, const std::size_t, const std::vector<std::string>&);
+    void mark_spliced(const std::size_t, const std::size_t, const std::size_t);
+    void clamp_cursor();
     [[nodiscard]] bool move_line_down();
     [[nodiscard]] bool move_line_up();
     void set_read_only(std::string_view);
@@ -89,6 +164,33 @@ struct Model {
     void add_mark(const char);
     [[nodiscard]] bool is_marked(const std::size_t) const;
     [[nodiscard]] bool go_to_mark(const char);
+    void start_typing();
+    void stop_typing();
+    void flush_typing();
+    void mark_dirty(const std::size_t);
+    void mark_typed(const std::size_t);
+    void mark_added(const std::size_t);
+    void mark_removed(const std::size_t);
+    [[nodiscard]] Journal* edit_journal();
+    [[nodiscard]] bool replay(const std::vector<JournalEntry>&);
+    void discard_journal();
+    void restore_history();
+    void keep_history(SaveJob&);
+    void save_history(const SaveJob&, const bool);
+    [[nodiscard]] std::string_view line(const std::size_t) const;
+    [[nodiscard]] LineRef line_ref(const std::size_t) const;
+    [[nodiscard]] LineParts line_parts(const std::size_t) const;
+    [[nodiscard]] std::size_t line_size(const std::size_t) const;
+    [[nodiscard]] std::size_t line_count() const;
+    [[nodiscard]] const OffsetIndex& offset_index();
+    [[nodiscard]] std::size_t offset_of(const std::size_t);
+    [[nodiscard]] std::size_t line_at(const std::size_t);
+    void set_backend(const Backend);
+    [[nodiscard]] std::size_t display_col(const std::size_t, const std::size_t) const;
+    [[nodiscard]] bool loading() const;
+    [[nodiscard]] bool poll_load();
+    void wait_for_load();
+    [[nodiscard]] unsigned int load_progress() const;
 };
 
 #endif  // MODEL_H
@@ -0,0 +1,204 @@
+#include "offset_index.h"
+
+#include <stdexcept>
+
+static const std::size_t NIL = SIZE_MAX;
+
+OffsetIndex::OffsetIndex() : root(NIL) {}
+
+// Takes the length of each line, without its newline. The tree is built in
+// one pass: each node goes down the right edge of the tree so far, below every
+// node there with a higher priority, and takes the ones it passes as its left
+// NOTE: A node that's been passed is never touched again, so it's counted then
+OffsetIndex::OffsetIndex(const std::vector<std::size_t>& lengths) : root(NIL) {
+    nodes.reserve(lengths.size());
+    std::vector<std::size_t> edge = {};
+
+    for (const std::size_t length : lengths) {
+        const std::size_t node = new_node(length + 1);
+        std::size_t passed = NIL;
+
+        while (!edge.empty() && nodes[edge.back()].priority < nodes[node].priority) {
+            passed = edge.back();
+            edge.pop_back();
+            update(passed);
+        }
+
+        nodes[node].left = passed;
+        if (!edge.empty()) { nodes[edge.back()].right = node; }
+        edge.push_back(node);
+    }
+
+    for (auto it = edge.rbegin(); it != edge.rend(); it++) {
+        update(*it);
+    }
+    if (!edge.empty()) { root = edge.front(); }
+}
+
+void OffsetIndex::set(const std::size_t idx, const std::size_t length) {
+    if (idx >= size()) { throw std::out_of_range("OffsetIndex::set"); }
+
+    // Every node above the line counts it, so they're all recounted on the
+    // way back up
+    std::vector<std::size_t> path = {};
+    std::size_t node = root;
+    std::size_t pos = idx;
+
+    while (true) {
+        path.push_back(node);
+        const std::size_t left_lines = lines_under(nodes[node].left);
+
+        if (pos < left_lines) {
+            node = nodes[node].left;
+        } else if (pos == left_lines) {
+            break;
+        } else {
+            pos -= left_lines + 1;
+            node = nodes[node].right;
+        }
+    }
+
+    nodes[node].size = length + 1;
+    for (auto it = path.rbegin(); it != path.rend(); it++) {
+        update(*it);
+    }
+}
+
+void OffsetIndex::insert(const std::size_t idx, const std::size_t length) {
+    if (idx > size()) { throw std::out_of_range("OffsetIndex::insert"); }
+
+    const std::size_t node = new_node(length + 1);
+    const auto [before, after] = split(root, idx);
+    root = merge(merge(before, node), after);
+}
+
+void OffsetIndex::erase(const std::size_t idx) {
+    if (idx >= size()) { throw std::out_of_range("OffsetIndex::erase"); }
+
+    const auto [before, rest] = split(root, idx);
+    const auto [node, after] = split(rest, 1);
+    free_nodes.push_back(node);
+    root = merge(before, after);
+}
+
+[[nodiscard]] std::size_t OffsetIndex::size() const {
+    return lines_under(root);
+}
+
+[[nodiscard]] std::size_t OffsetIndex::bytes() const {
+    return bytes_under(root);
+}
+
+// Where line idx starts. Asking for the line after the last gives the size
+// of the whole buffer
+[[nodiscard]] std::size_t OffsetIndex::offset_of(std::size_t idx) const {
+    if (idx > size()) { throw std::out_of_range("OffsetIndex::offset_of"); }
+
+    std::size_t ret = 0;
+    std::size_t node = root;
+
+    while (node != NIL) {
+        const OffsetNode& n = nodes[node];
+        const std::size_t left_lines = lines_under(n.left);
+
+        if (idx <= left_lines) {
+            node = n.left;
+        } else {
+            ret += bytes_under(n.left) + n.size;
+            idx -= left_lines + 1;
+            node = n.right;
+        }
+    }
+
+    return ret;
+}
+
+// The line the byte at `offset` is in. A line's newline is part of it
+[[nodiscard]] std::size_t OffsetIndex::line_at(std::size_t offset) const {
+    if (offset >= bytes()) { throw std::out_of_range("OffsetIndex::line_at"); }
+
+    std::size_t ret = 0;
+    std::size_t node = root;
+
+    while (true) {
+        const OffsetNode& n = nodes[node];
+        const std::size_t left_bytes = bytes_under(n.left);
+
+        if (offset < left_bytes) {
+            node = n.left;
+        } else if (offset < left_bytes + n.size) {
+            return ret + lines_under(n.left);
+        } else {
+            ret += lines_under(n.left) + 1;
+            offset -= left_bytes + n.size;
+            node = n.right;
+        }
+    }
+}
+
+[[nodiscard]] std::size_t OffsetIndex::lines_under(const std::size_t node) const {
+    return node == NIL ? 0 : nodes[node].lines;
+}
+
+[[nodiscard]] std::size_t OffsetIndex::bytes_under(const std::size_t node) const {
+    return node == NIL ? 0 : nodes[node].bytes;
+}
+
+[[nodiscard]] std::size_t OffsetIndex::new_node(const std::size_t size) {
+    const OffsetNode n = {size, 1, size, uint32_t(rng()), NIL, NIL};
+
+    if (free_nodes.empty()) {
+        nodes.push_back(n);
+        return nodes.size() - 1;
+    }
+
+    const std::size_t node = free_nodes.back();
+    free_nodes.pop_back();
+    nodes[node] = n;
+    return node;
+}
+
+void OffsetIndex::update(const std::size_t node) {
+    OffsetNode& n = nodes[node];
+    n.lines = lines_under(n.left) + 1 + lines_under(n.right);
+    n.bytes = bytes_under(n.left) + n.size + bytes_under(n.right);
+}
+
+// Cut the tree under `node` into its first `count` lines and the rest
+[[nodiscard]] std::pair<std::size_t, std::size_t> OffsetIndex::split(
+    const std::size_t node,
+    const std::size_t count) {
+    if (node == NIL) { return {NIL, NIL}; }
+
+    if (count <= lines_under(nodes[node].left)) {
+        const auto [first, second] = split(nodes[node].left, count);
+        nodes[node].left = second;
+        update(node);
+        return {first, node};
+    }
+
+    const auto [first, second] =
+        split(nodes[node].right, count - lines_under(nodes[node].left) - 1);
+    nodes[node].right = first;
+    update(node);
+    return {node, second};
+}
+
+// Join two trees, every line of `first` ending up before every line of
+// `second`
+[[nodiscard]] std::size_t OffsetIndex::merge(const std::size_t first, const std::size_t second) {
+    if (first == NIL) { return second; }
+    if (second == NIL) { return first; }
+
+    if (nodes[first].priority >= nodes[second].priority) {
+        const std::size_t right = merge(nodes[first].right, second);
+        nodes[first].right = right;
+        update(first);
+        return first;
+    }
+
+    const std::size_t left = merge(first, nodes[second].left);
+    nodes[second].left = left;
+    update(second);
+    return second;
+}
@@ -0,0 +1,49 @@
+#ifndef OFFSET_INDEX_H
+#define OFFSET_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <utility>
+#include <vector>
+
+// A line's size in the index, and a node in the tree that orders them. `lines`
+// and `bytes` count everything under this node
+struct OffsetNode {
+    std::size_t size;
+    std::size_t lines;
+    std::size_t bytes;
+    uint32_t priority;
+    std::size_t left;
+    std::size_t right;
+};
+
+// Bytes each line of a buffer takes up, its newline included, kept in a treap
+// (see PieceTable) with each node counting the bytes under it. Finding the
+// offset a line starts at or the line at an offset, changing a line's length
+// and adding or removing a line are all O(log n)
+struct OffsetIndex {
+    std::vector<OffsetNode> nodes = {};
+    std::vector<std::size_t> free_nodes = {};
+    std::size_t root;
+    std::minstd_rand rng;
+
+    OffsetIndex();
+    explicit OffsetIndex(const std::vector<std::size_t>&);
+    void set(const std::size_t, const std::size_t);
+    void insert(const std::size_t, const std::size_t);
+    void erase(const std::size_t);
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] std::size_t bytes() const;
+    [[nodiscard]] std::size_t offset_of(std::size_t) const;
+    [[nodiscard]] std::size_t line_at(std::size_t) const;
+
+    [[nodiscard]] std::size_t lines_under(const std::size_t) const;
+    [[nodiscard]] std::size_t bytes_under(const std::size_t) const;
+    [[nodiscard]] std::size_t new_node(const std::size_t);
+    void update(const std::size_t);
+    [[nodiscard]] std::pair<std::size_t, std::size_t> split(const std::size_t, const std::size_t);
+    [[nodiscard]] std::size_t merge(const std::size_t, const std::size_t);
+};
+
+#endif  // OFFSET_INDEX_H
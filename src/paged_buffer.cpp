@@ -0,0 +1,119 @@
+#include "paged_buffer.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+#include <sys/mman.h>
+
+#include "loader.h"
+#include "parallel.h"
+#include "scan.h"
+
+PagedBuffer::PagedBuffer(MappedFile file, std::size_t page_bytes) : mapping(std::move(file)) {
+    // Build the index by cutting the file into line aligned pages and
+    // counting the newlines in each one
+    const std::string_view text = mapping.view();
+    const std::vector<std::string_view> chunks =
+        split_on_lines(text, std::max(std::size_t(1), text.size() / page_bytes));
+
+    std::vector<std::size_t> counts(chunks.size());
+    parallel_for(chunks.size(), [&](std::size_t idx) {
+        counts.at(idx) = std::size_t(std::count(chunks[idx].begin(), chunks[idx].end(), '\n'));
+    });
+
+    pages.reserve(chunks.size());
+    for (std::size_t i = 0; i < chunks.size(); i++) {
+        pages.push_back(
+            {std::size_t(chunks[i].data() - text.data()), chunks[i].size(), line_count});
+        line_count += counts.at(i);
+    }
+
+    // A final line with no newline still counts
+    if (!text.empty() && text.back() != '\n') { line_count++; }
+
+    // From here on we only read the pages around the viewport
+    mapping.advise(0, mapping.size, MADV_RANDOM);
+}
+
+[[nodiscard]] std::size_t PagedBuffer::size() const {
+    return line_count;
+}
+
+[[nodiscard]] std::string_view PagedBuffer::at(const std::size_t idx) const {
+    if (idx >= line_count) { throw std::out_of_range("PagedBuffer::at"); }
+
+    const std::size_t page = page_of(idx);
+    return load_page(page).at(idx - pages.at(page).first_line);
+}
+
+[[nodiscard]] std::string& PagedBuffer::edit(const std::size_t) {
+    throw std::logic_error("PagedBuffer is read-only");
+}
+
+void PagedBuffer::set(const std::size_t, std::string) {
+    throw std::logic_error("PagedBuffer is read-only");
+}
+
+void PagedBuffer::insert(const std::size_t, std::string) {
+    throw std::logic_error("PagedBuffer is read-only");
+}
+
+void PagedBuffer::erase(const std::size_t) {
+    throw std::logic_error("PagedBuffer is read-only");
+}
+
+void PagedBuffer::append(std::vector<std::string>) {
+    throw std::logic_error("PagedBuffer is read-only");
+}
+
+[[nodiscard]] bool PagedBuffer::read_only() const {
+    return true;
+}
+
+[[nodiscard]] std::size_t PagedBuffer::page_of(std::size_t idx) const {
+    const auto it = std::upper_bound(
+        pages.begin(), pages.end(), idx,
+        [](std::size_t line, const Page& p) { return line < p.first_line; });
+    return std::size_t(std::distance(pages.begin(), it)) - 1;
+}
+
+[[nodiscard]] const std::vector<std::string>& PagedBuffer::load_page(std::size_t page) const {
+    const auto hit = std::find_if(
+        cache.begin(), cache.end(), [page](const auto& entry) { return entry.first == page; });
+
+    if (hit != cache.end()) {
+        cache.splice(cache.begin(), cache, hit);
+    } else {
+        const Page& p = pages.at(page);
+        std::vector<std::string> lines = {};
+        append_lines(mapping.view().substr(p.offset, p.size), lines);
+        cache.emplace_front(page, std::move(lines));
+
+        if (cache.size() > PAGE_CACHE_SIZE) {
+            // Let the kernel drop the bytes behind the evicted page too
+            const Page& evicted = pages.at(cache.back().first);
+            mapping.advise(evicted.offset, evicted.size, MADV_DONTNEED);
+            cache.pop_back();
+        }
+    }
+
+    // Read ahead in whichever direction we're scrolling
+    if (page > last_page && page + 1 < pages.size()) {
+        mapping.advise(pages.at(page + 1).offset, pages.at(page + 1).size, MADV_WILLNEED);
+    } else if (page < last_page && page > 0) {
+        mapping.advise(pages.at(page - 1).offset, pages.at(page - 1).size, MADV_WILLNEED);
+    }
+
+    last_page = page;
+    return cache.front().second;
+}
+
+// Returns nullptr if the file can't be read, or is small enough to be
+// loaded into memory as normal
+[[nodiscard]] std::unique_ptr<PagedBuffer> open_file_paged(const std::string& file) {
+    MappedFile mapping(file);
+    if (!mapping.valid() || mapping.size < PAGED_LOAD_SIZE) { return nullptr; }
+
+    return std::make_unique<PagedBuffer>(std::move(mapping));
+}
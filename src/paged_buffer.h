@@ -0,0 +1,52 @@
+#ifndef PAGED_BUFFER_H
+#define PAGED_BUFFER_H
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "constants.h"
+#include "mapped_file.h"
+#include "text_buffer.h"
+
+// A run of whole lines in the file, roughly PAGE_BYTES long
+struct Page {
+    std::size_t offset;
+    std::size_t size;
+    std::size_t first_line;
+};
+
+// Read-only buffer for files too big to hold in memory as lines. Only a
+// sparse index of where each page starts is kept for the whole file, lines
+// are split out a page at a time and the least recently used pages dropped.
+// NOTE: A line returned by `at()` stays valid until PAGE_CACHE_SIZE - 1
+// other pages have been read
+struct PagedBuffer : TextBuffer {
+    MappedFile mapping;
+    std::vector<Page> pages = {};
+    std::size_t line_count = 0;
+
+    // Most recently used first
+    mutable std::list<std::pair<std::size_t, std::vector<std::string>>> cache = {};
+    mutable std::size_t last_page = 0;
+
+    explicit PagedBuffer(MappedFile, std::size_t page_bytes = PAGE_BYTES);
+    [[nodiscard]] std::size_t size() const override;
+    [[nodiscard]] std::string_view at(const std::size_t) const override;
+    [[nodiscard]] std::string& edit(const std::size_t) override;
+    void set(const std::size_t, std::string) override;
+    void insert(const std::size_t, std::string) override;
+    void erase(const std::size_t) override;
+    void append(std::vector<std::string>) override;
+    [[nodiscard]] bool read_only() const override;
+    [[nodiscard]] std::size_t page_of(std::size_t) const;
+    [[nodiscard]] const std::vector<std::string>& load_page(std::size_t) const;
+};
+
+[[nodiscard]] std::unique_ptr<PagedBuffer> open_file_paged(const std::string&);
+
+#endif  // PAGED_BUFFER_H
@@ -0,0 +1,43 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+[[nodiscard]] inline std::size_t worker_count() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Run `func(idx)` for every idx in [0, count) across a small pool of
+// threads. Blocks until every call has returned
+template <typename F>
+void parallel_for(const std::size_t count, F&& func) {
+    const std::size_t threads = std::min(count, worker_count());
+    if (threads <= 1) {
+        for (std::size_t idx = 0; idx < count; idx++) {
+            func(idx);
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> next = 0;
+    auto worker = [&]() {
+        for (std::size_t idx = next++; idx < count; idx = next++) {
+            func(idx);
+        }
+    };
+
+    std::vector<std::jthread> pool;
+    pool.reserve(threads - 1);
+    for (std::size_t i = 0; i < threads - 1; i++) {
+        pool.emplace_back(worker);
+    }
+
+    // The calling thread does its share of the work too
+    worker();
+}
+
+#endif  // PARALLEL_H
@@ -0,0 +1,404 @@
+#include "piece_table.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+static const std::size_t NIL = SIZE_MAX;
+// The block of a piece of edited lines
+static const std::size_t EDITED = SIZE_MAX;
+
+PieceTable::PieceTable(std::vector<std::string> lines) : root(NIL) {
+    append(std::move(lines));
+}
+
+PieceTable::PieceTable(LineArena text, std::vector<LineRef> lines) : root(NIL) {
+    adopt(std::move(text), std::move(lines));
+}
+
+[[nodiscard]] std::size_t PieceTable::size() const {
+    return lines_under(root);
+}
+
+[[nodiscard]] std::string_view PieceTable::at(const std::size_t idx) const {
+    if (idx >= size()) { throw std::out_of_range("PieceTable::at"); }
+
+    const auto [node, offset] = find(idx);
+    return line_in(pieces[node], offset);
+}
+
+[[nodiscard]] std::string& PieceTable::edit(const std::size_t idx) {
+    if (idx >= size()) { throw std::out_of_range("PieceTable::edit"); }
+
+    const auto [node, offset] = find(idx);
+    const Piece& p = pieces[node];
+    if (p.block == EDITED && p.start + offset >= frozen) { return edited[p.start + offset]; }
+
+    return replace(idx, std::string(line_in(p, offset)));
+}
+
+void PieceTable::set(const std::size_t idx, std::string text) {
+    if (idx >= size()) { throw std::out_of_range("PieceTable::set"); }
+
+    const auto [node, offset] = find(idx);
+    const Piece& p = pieces[node];
+    if (p.block == EDITED && p.start + offset >= frozen) {
+        edited[p.start + offset] = std::move(text);
+        return;
+    }
+
+    std::ignore = replace(idx, std::move(text));
+}
+
+void PieceTable::insert(const std::size_t idx, std::string text) {
+    if (idx > size()) { throw std::out_of_range("PieceTable::insert"); }
+
+    edited.push_back(std::move(text));
+    const std::size_t node = new_piece(EDITED, edited.size() - 1, 1);
+
+    const auto [before, after] = split(root, idx);
+    root = merge(merge(before, node), after);
+}
+
+// NOTE: Only the piece is dropped, the line itself stays in its block
+void PieceTable::erase(const std::size_t idx) {
+    if (idx >= size()) { throw std::out_of_range("PieceTable::erase"); }
+
+    const auto [before, rest] = split(root, idx);
+    const auto [node, after] = split(rest, 1);
+    free_pieces.push_back(node);
+    root = merge(before, after);
+}
+
+// The text of the lines is copied into the arena, so no line keeps a string
+// of its own
+void PieceTable::append(std::vector<std::string> lines) {
+    std::size_t bytes = 0;
+    for (const auto& line : lines) {
+        bytes += line.size();
+    }
+
+    char* dest = arena.allocate(bytes);
+    std::vector<LineRef> refs = {};
+    refs.reserve(lines.size());
+
+    for (const auto& line : lines) {
+        std::copy(line.begin(), line.end(), dest);
+        refs.emplace_back(std::string_view(dest, line.size()));
+        dest += line.size();
+    }
+
+    add_block(std::move(refs));
+}
+
+void PieceTable::adopt(LineArena text, std::vector<LineRef> lines) {
+    arena.adopt(std::move(text));
+    add_block(std::move(lines));
+}
+
+// Only edited lines have to be looked at, the rest were when they were stored
+[[nodiscard]] LineRef PieceTable::line_ref(const std::size_t idx) const {
+    if (idx >= size()) { throw std::out_of_range("PieceTable::line_ref"); }
+
+    const auto [node, offset] = find(idx);
+    const Piece& p = pieces[node];
+    if (p.block == EDITED) { return LineRef(edited[p.start + offset]); }
+    return blocks[p.block][p.start + offset];
+}
+
+[[nodiscard]] std::size_t PieceTable::piece_count() const {
+    return pieces.size() - free_pieces.size();
+}
+
+[[nodiscard]] std::string_view PieceTable::line_in(
+    const Piece& p,
+    const std::size_t offset) const {
+    if (p.block == EDITED) { return edited[p.start + offset]; }
+    return blocks[p.block][p.start + offset].text();
+}
+
+// Lines that stay as they are until the table is freed, added to the end
+void PieceTable::add_block(std::vector<LineRef> lines) {
+    if (lines.empty()) { return; }
+
+    const std::size_t count = lines.size();
+    blocks.push_back(std::move(lines));
+    root = merge(root, new_piece(blocks.size() - 1, 0, count));
+}
+
+[[nodiscard]] std::size_t PieceTable::lines_under(const std::size_t node) const {
+    return node == NIL ? 0 : pieces[node].lines;
+}
+
+[[nodiscard]] std::size_t PieceTable::new_piece(
+    const std::size_t block,
+    const std::size_t start,
+    const std::size_t count) {
+    const Piece p = {block, start, count, count, uint32_t(rng()), NIL, NIL};
+
+    if (free_pieces.empty()) {
+        pieces.push_back(p);
+        return pieces.size() - 1;
+    }
+
+    const std::size_t node = free_pieces.back();
+    free_pieces.pop_back();
+    pieces[node] = p;
+    return node;
+}
+
+void PieceTable::update(const std::size_t node) {
+    Piece& p = pieces[node];
+    p.lines = lines_under(p.left) + p.count + lines_under(p.right);
+}
+
+// Cut the tree under `node` into its first `count` lines and the rest. A piece
+// straddling the cut is cut in two, the back half keeping its priority so
+// both halves still sit correctly in the tree
+[[nodiscard]] std::pair<std::size_t, std::size_t> PieceTable::split(
+    const std::size_t node,
+    const std::size_t count) {
+    if (node == NIL) { return {NIL, NIL}; }
+
+    const std::size_t left_lines = lines_under(pieces[node].left);
+
+    if (count <= left_lines) {
+        const auto [first, second] = split(pieces[node].left, count);
+        pieces[node].left = second;
+        update(node);
+        return {first, node};
+    }
+
+    if (count >= left_lines + pieces[node].count) {
+        const auto [first, second] =
+            split(pieces[node].right, count - left_lines - pieces[node].count);
+        pieces[node].right = first;
+        update(node);
+        return {node, second};
+    }
+
+    const std::size_t offset = count - left_lines;
+    const std::size_t tail = new_piece(
+        pieces[node].block, pieces[node].start + offset, pieces[node].count - offset);
+    pieces[tail].priority = pieces[node].priority;
+    pieces[tail].right = pieces[node].right;
+    update(tail);
+
+    pieces[node].count = offset;
+    pieces[node].right = NIL;
+    update(node);
+    return {node, tail};
+}
+
+// Join two trees, every line of `first` ending up before every line of
+// `second`
+[[nodiscard]] std::size_t PieceTable::merge(const std::size_t first, const std::size_t second) {
+    if (first == NIL) { return second; }
+    if (second == NIL) { return first; }
+
+    if (pieces[first].priority >= pieces[second].priority) {
+        const std::size_t right = merge(pieces[first].right, second);
+        pieces[first].right = right;
+        update(first);
+        return first;
+    }
+
+    const std::size_t left = merge(first, pieces[second].left);
+    pieces[second].left = left;
+    update(second);
+    return second;
+}
+
+// The piece holding line idx, and how far into it the line is
+[[nodiscard]] std::pair<std::size_t, std::size_t> PieceTable::find(std::size_t idx) const {
+    std::size_t node = root;
+
+    while (true) {
+        const Piece& p = pieces[node];
+        const std::size_t left_lines = lines_under(p.left);
+
+        if (idx < left_lines) {
+            node = p.left;
+        } else if (idx < left_lines + p.count) {
+            return {node, idx - left_lines};
+        } else {
+            idx -= left_lines + p.count;
+            node = p.right;
+        }
+    }
+}
+
+// Point line idx at `text`, added to the end of the edited lines
+[[nodiscard]] std::string& PieceTable::replace(const std::size_t idx, std::string text) {
+    edited.push_back(std::move(text));
+
+    const auto [before, rest] = split(root, idx);
+    const auto [node, after] = split(rest, 1);
+    pieces[node].block = EDITED;
+    pieces[node].start = edited.size() - 1;
+
+    root = merge(merge(before, node), after);
+    return edited.back();
+}
+
+// Every piece in order, with pieces that follow on from each other in their
+// block joined into one run
+[[nodiscard]] std::vector<PieceRun> PieceTable::runs() const {
+    std::vector<PieceRun> ret = {};
+    std::vector<std::size_t> above = {};
+    std::size_t node = root;
+
+    while (node != NIL || !above.empty()) {
+        for (; node != NIL; node = pieces[node].left) {
+            above.push_back(node);
+        }
+
+        const Piece& p = pieces[above.back()];
+        above.pop_back();
+        if (!ret.empty() && ret.back().block == p.block &&
+            ret.back().start + ret.back().count == p.start) {
+            ret.back().count += p.count;
+        } else {
+            ret.push_back({p.block, p.start, p.count});
+        }
+        node = p.right;
+    }
+
+    return ret;
+}
+
+// A state is the runs the pieces point at, so keeping one copies them but no
+// line. The edited lines they include are never changed after this
+[[nodiscard]] std::shared_ptr<const BufferState> PieceTable::keep_state() {
+    auto ret = std::make_shared<PieceState>();
+    ret->runs = runs();
+    frozen = edited.size();
+    return ret;
+}
+
+// The pieces are built again from the runs. Edited lines that only the state
+// being left pointed at stay in `edited`, unused
+[[nodiscard]] std::vector<LineSpan> PieceTable::restore_state(const BufferState& state) {
+    const std::vector<PieceRun>& kept = dynamic_cast<const PieceState&>(state).runs;
+    std::vector<LineSpan> ret = piece_diff(runs(), kept);
+
+    pieces.clear();
+    free_pieces.clear();
+    root = NIL;
+    for (const PieceRun& run : kept) {
+        root = merge(root, new_piece(run.block, run.start, run.count));
+    }
+
+    return ret;
+}
+
+// Where the runs of each block are in it, as [start, end) in order
+using RunIndex = std::unordered_map<std::size_t, std::vector<std::pair<std::size_t, std::size_t>>>;
+
+[[nodiscard]] static RunIndex index_runs(const std::vector<PieceRun>& runs) {
+    RunIndex ret = {};
+    for (const PieceRun& run : runs) {
+        ret[run.block].emplace_back(run.start, run.start + run.count);
+    }
+    for (auto& [block, ranges] : ret) {
+        std::sort(ranges.begin(), ranges.end());
+    }
+    return ret;
+}
+
+// How many of the `limit` lines of `block` from `start` on aren't in `index`,
+// stopping at the first that is
+[[nodiscard]] static std::size_t missing(
+    const RunIndex& index,
+    const std::size_t block,
+    const std::size_t start,
+    const std::size_t limit) {
+    const auto found = index.find(block);
+    if (found == index.end()) { return limit; }
+
+    const auto& ranges = found->second;
+    const auto next = std::upper_bound(
+        ranges.begin(), ranges.end(), start,
+        [](const std::size_t line, const auto& range) { return line < range.second; });
+
+    if (next == ranges.end()) { return limit; }
+    if (next->first <= start) { return 0; }
+    return std::min(limit, next->first - start);
+}
+
+// Walks a list of runs a line at a time, or as many as are asked for
+struct RunCursor {
+    const std::vector<PieceRun>& runs;
+    std::size_t idx = 0;
+    std::size_t offset = 0;
+
+    [[nodiscard]] bool done() const { return idx == runs.size(); }
+    [[nodiscard]] std::size_t block() const { return runs[idx].block; }
+    [[nodiscard]] std::size_t line() const { return runs[idx].start + offset; }
+    [[nodiscard]] std::size_t left() const { return runs[idx].count - offset; }
+
+    void skip(const std::size_t count) {
+        offset += count;
+        if (offset == runs[idx].count) {
+            idx++;
+            offset = 0;
+        }
+    }
+};
+
+// The spans of lines that differ between two states of a piece table. A line
+// is the same line in both if it's the same line of the same block, as lines
+// are never changed once a state points at them (see `keep_state`)
+[[nodiscard]] std::vector<LineSpan> piece_diff(
+    const std::vector<PieceRun>& from,
+    const std::vector<PieceRun>& to) {
+    const RunIndex in_from = index_runs(from);
+    const RunIndex in_to = index_runs(to);
+
+    std::vector<LineSpan> ret = {};
+    RunCursor before = {from};
+    RunCursor after = {to};
+    std::size_t line = 0;
+
+    while (!before.done() || !after.done()) {
+        if (!before.done() && !after.done() && before.block() == after.block() &&
+            before.line() == after.line()) {
+            const std::size_t same = std::min(before.left(), after.left());
+            before.skip(same);
+            after.skip(same);
+            line += same;
+            continue;
+        }
+
+        LineSpan span = {line, 0, 0};
+        while (!before.done()) {
+            const std::size_t gone = missing(in_to, before.block(), before.line(), before.left());
+            if (!gone) { break; }
+            span.removed += gone;
+            before.skip(gone);
+        }
+        while (!after.done()) {
+            const std::size_t added = missing(in_from, after.block(), after.line(), after.left());
+            if (!added) { break; }
+            span.added += added;
+            after.skip(added);
+        }
+
+        // NOTE: Edits never reorder lines, but if they ever did the rest of
+        // the states would be one span
+        if (!span.removed && !span.added) {
+            for (; !before.done(); before.skip(before.left())) {
+                span.removed += before.left();
+            }
+            for (; !after.done(); after.skip(after.left())) {
+                span.added += after.left();
+            }
+        }
+
+        line += span.added;
+        ret.push_back(span);
+    }
+
+    return ret;
+}
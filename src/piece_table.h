@@ -0,0 +1,88 @@
+#ifndef PIECE_TABLE_H
+#define PIECE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "text_buffer.h"
+
+// A run of lines from one of the piece table's blocks (or its edited lines),
+// and a node in the tree that orders them. `lines` counts every line under
+// this node
+struct Piece {
+    std::size_t block;
+    std::size_t start;
+    std::size_t count;
+    std::size_t lines;
+    uint32_t priority;
+    std::size_t left;
+    std::size_t right;
+};
+
+// Lines [start, start + count) of a block, in a state kept of a piece table
+struct PieceRun {
+    std::size_t block;
+    std::size_t start;
+    std::size_t count;
+};
+
+struct PieceState : BufferState {
+    std::vector<PieceRun> runs = {};
+};
+
+// Lines are never moved once stored. Each file load adds a block of lines that
+// is never changed again, their text packed into `arena`, and edited or new
+// lines go on the end of `edited`. The buffer is the list of pieces of those,
+// kept in a treap (a tree balanced by random priorities) so finding, adding or
+// removing a line anywhere is O(log n) and doesn't copy any other line.
+// NOTE: Lines are the smallest unit here, changing a char copies its line
+// into `edited` the first time, and after that edits it in place. Once a state
+// has been kept, the edited lines it points at are copied again instead
+struct PieceTable : TextBuffer {
+    LineArena arena = {};
+    std::vector<std::vector<LineRef>> blocks = {};
+    std::vector<std::string> edited = {};
+    std::size_t frozen = 0;  // Edited lines before this are in a kept state
+    std::vector<Piece> pieces = {};
+    std::vector<std::size_t> free_pieces = {};
+    std::size_t root;
+    std::minstd_rand rng;
+
+    explicit PieceTable(std::vector<std::string>);
+    PieceTable(LineArena, std::vector<LineRef>);
+    [[nodiscard]] std::size_t size() const override;
+    [[nodiscard]] std::string_view at(const std::size_t) const override;
+    [[nodiscard]] std::string& edit(const std::size_t) override;
+    void set(const std::size_t, std::string) override;
+    void insert(const std::size_t, std::string) override;
+    void erase(const std::size_t) override;
+    void append(std::vector<std::string>) override;
+    void adopt(LineArena, std::vector<LineRef>) override;
+    [[nodiscard]] LineRef line_ref(const std::size_t) const override;
+    [[nodiscard]] std::shared_ptr<const BufferState> keep_state() override;
+    [[nodiscard]] std::vector<LineSpan> restore_state(const BufferState&) override;
+
+    [[nodiscard]] std::size_t piece_count() const;
+    [[nodiscard]] std::string_view line_in(const Piece&, const std::size_t) const;
+    void add_block(std::vector<LineRef>);
+    [[nodiscard]] std::size_t lines_under(const std::size_t) const;
+    [[nodiscard]] std::size_t new_piece(const std::size_t, const std::size_t, const std::size_t);
+    void update(const std::size_t);
+    [[nodiscard]] std::pair<std::size_t, std::size_t> split(const std::size_t, const std::size_t);
+    [[nodiscard]] std::size_t merge(const std::size_t, const std::size_t);
+    [[nodiscard]] std::pair<std::size_t, std::size_t> find(std::size_t) const;
+    [[nodiscard]] std::string& replace(const std::size_t, std::string);
+    [[nodiscard]] std::vector<PieceRun> runs() const;
+};
+
+[[nodiscard]] std::vector<LineSpan> piece_diff(
+    const std::vector<PieceRun>&,
+    const std::vector<PieceRun>&);
+
+#endif  // PIECE_TABLE_H
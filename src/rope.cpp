@@ -0,0 +1,386 @@
+#include "rope.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+
+// Most lines a leaf holds, and most children an internal node has
+static const std::size_t LEAF_LINES = 64;
+static const std::size_t BRANCHING = 16;
+
+[[nodiscard]] bool RopeNode::leaf() const {
+    return children.empty();
+}
+
+[[nodiscard]] static RopeStats line_stats(const std::string& line) {
+    // Count every byte that doesn't continue a UTF-8 sequence
+    const std::size_t continuations = std::size_t(std::count_if(
+        line.begin(), line.end(), [](unsigned char c) { return (c & 0xC0) == 0x80; }));
+    return {1, line.size() + 1, line.size() - continuations + 1};
+}
+
+static void add(RopeStats& total, const RopeStats& more) {
+    total.lines += more.lines;
+    total.bytes += more.bytes;
+    total.codepoints += more.codepoints;
+}
+
+[[nodiscard]] static RopeRef make_leaf(std::vector<std::string> text) {
+    auto node = std::make_shared<RopeNode>();
+    for (const auto& line : text) {
+        add(node->stats, line_stats(line));
+    }
+    node->text = std::move(text);
+    return node;
+}
+
+[[nodiscard]] static RopeRef make_node(std::vector<RopeRef> children) {
+    auto node = std::make_shared<RopeNode>();
+    for (const auto& child : children) {
+        add(node->stats, child->stats);
+    }
+    node->children = std::move(children);
+    return node;
+}
+
+// Cut lines into as few leaves as fit them, all about the same size
+[[nodiscard]] static std::vector<RopeRef> make_leaves(std::vector<std::string> text) {
+    if (text.empty()) { return {}; }
+    if (text.size() <= LEAF_LINES) { return {make_leaf(std::move(text))}; }
+
+    const std::size_t leaves = (text.size() + LEAF_LINES - 1) / LEAF_LINES;
+    std::vector<RopeRef> ret = {};
+    ret.reserve(leaves);
+
+    for (std::size_t i = 0; i < leaves; i++) {
+        const auto begin = text.begin() + std::ptrdiff_t(i * text.size() / leaves);
+        const auto end = text.begin() + std::ptrdiff_t((i + 1) * text.size() / leaves);
+        ret.push_back(make_leaf({std::make_move_iterator(begin), std::make_move_iterator(end)}));
+    }
+
+    return ret;
+}
+
+// The same, one level up
+[[nodiscard]] static std::vector<RopeRef> make_nodes(std::vector<RopeRef> nodes) {
+    if (nodes.size() <= BRANCHING) { return {make_node(std::move(nodes))}; }
+
+    const std::size_t parents = (nodes.size() + BRANCHING - 1) / BRANCHING;
+    std::vector<RopeRef> ret = {};
+    ret.reserve(parents);
+
+    for (std::size_t i = 0; i < parents; i++) {
+        const auto begin = nodes.begin() + std::ptrdiff_t(i * nodes.size() / parents);
+        const auto end = nodes.begin() + std::ptrdiff_t((i + 1) * nodes.size() / parents);
+        ret.push_back(make_node({begin, end}));
+    }
+
+    return ret;
+}
+
+// Stack the nodes of one level into a single tree
+[[nodiscard]] static RopeRef make_root(std::vector<RopeRef> nodes) {
+    if (nodes.empty()) { return make_leaf({}); }
+
+    while (nodes.size() > 1) {
+        nodes = make_nodes(std::move(nodes));
+    }
+
+    // Erasing can leave a chain of single children at the top
+    while (!nodes.front()->leaf() && nodes.front()->children.size() == 1) {
+        nodes.front() = nodes.front()->children.front();
+    }
+
+    return nodes.front();
+}
+
+// Swap `count` lines from `idx` under `node` for `text`, or leave `text` alone
+// if it's null. Returns the nodes to put in place of `node`, which is more
+// than one if it overflowed and none if it was emptied
+[[nodiscard]] static std::vector<RopeRef> splice_node(
+    const RopeRef& node,
+    const std::size_t idx,
+    const std::size_t count,
+    std::vector<std::string>* text) {
+    if (node->leaf()) {
+        std::vector<std::string> lines = {};
+        lines.reserve(node->text.size() - count + (text ? text->size() : 0));
+
+        const auto start = node->text.begin() + std::ptrdiff_t(idx);
+        lines.insert(lines.end(), node->text.begin(), start);
+        if (text) {
+            lines.insert(
+                lines.end(), std::make_move_iterator(text->begin()),
+                std::make_move_iterator(text->end()));
+        }
+        lines.insert(lines.end(), start + std::ptrdiff_t(count), node->text.end());
+
+        return make_leaves(std::move(lines));
+    }
+
+    std::vector<RopeRef> children = {};
+    std::size_t offset = 0;
+
+    for (std::size_t i = 0; i < node->children.size(); i++) {
+        const RopeRef& child = node->children.at(i);
+        const std::size_t child_lines = child->stats.lines;
+        const std::size_t child_end = offset + child_lines;
+
+        // New lines go in the first child that `idx` is inside, or the end of
+        // the last one
+        const bool target = text && idx >= offset &&
+                            (idx < child_end || i + 1 == node->children.size());
+        const std::size_t from = std::max(idx, offset);
+        const std::size_t to = std::min(idx + count, child_end);
+
+        if (target) {
+            auto replaced = splice_node(child, idx - offset, to > from ? to - from : 0, text);
+            children.insert(children.end(), replaced.begin(), replaced.end());
+            text = nullptr;
+        } else if (to <= from) {
+            children.push_back(child);
+        } else if (to - from < child_lines) {
+            auto replaced = splice_node(child, from - offset, to - from, nullptr);
+            children.insert(children.end(), replaced.begin(), replaced.end());
+        }
+
+        offset = child_end;
+    }
+
+    if (children.empty()) { return {}; }
+    return make_nodes(std::move(children));
+}
+
+[[nodiscard]] const std::string& rope_line(const RopeRef& root, std::size_t idx) {
+    if (idx >= root->stats.lines) { throw std::out_of_range("rope_line"); }
+
+    const RopeNode* node = root.get();
+    while (!node->leaf()) {
+        for (const auto& child : node->children) {
+            if (idx < child->stats.lines) {
+                node = child.get();
+                break;
+            }
+            idx -= child->stats.lines;
+        }
+    }
+
+    return node->text.at(idx);
+}
+
+static void collect_leaves(const RopeRef& node, std::vector<const RopeNode*>& out) {
+    if (node->leaf()) {
+        out.push_back(node.get());
+        return;
+    }
+
+    for (const auto& child : node->children) {
+        collect_leaves(child, out);
+    }
+}
+
+// The spans of lines that differ between two versions of a rope. Edits only
+// copy the leaves they touch, so a leaf found in both is the same lines, and
+// only the leaves between the shared ones need looking at
+[[nodiscard]] std::vector<LineSpan> rope_diff(const RopeRef& from, const RopeRef& to) {
+    std::vector<const RopeNode*> before = {};
+    std::vector<const RopeNode*> after = {};
+    collect_leaves(from, before);
+    collect_leaves(to, after);
+
+    const std::unordered_set<const RopeNode*> in_before(before.begin(), before.end());
+    const std::unordered_set<const RopeNode*> in_after(after.begin(), after.end());
+
+    std::vector<LineSpan> ret = {};
+    std::size_t i = 0;
+    std::size_t j = 0;
+    std::size_t line = 0;
+
+    while (i < before.size() || j < after.size()) {
+        if (i < before.size() && j < after.size() && before.at(i) == after.at(j)) {
+            line += after.at(j)->stats.lines;
+            i++;
+            j++;
+            continue;
+        }
+
+        LineSpan span = {line, 0, 0};
+        while (i < before.size() && !in_after.contains(before.at(i))) {
+            span.removed += before.at(i++)->stats.lines;
+        }
+        while (j < after.size() && !in_before.contains(after.at(j))) {
+            span.added += after.at(j++)->stats.lines;
+        }
+
+        // NOTE: Edits never reorder leaves, but if they ever did the rest of
+        // the ropes would be one span
+        if (!span.removed && !span.added) {
+            for (; i < before.size(); i++) {
+                span.removed += before.at(i)->stats.lines;
+            }
+            for (; j < after.size(); j++) {
+                span.added += after.at(j)->stats.lines;
+            }
+        }
+
+        line += span.added;
+        ret.push_back(span);
+    }
+
+    return ret;
+}
+
+Rope::Rope(std::vector<std::string> lines) : root(make_root(make_leaves(std::move(lines)))) {}
+
+[[nodiscard]] std::size_t Rope::size() const {
+    return root->stats.lines;
+}
+
+[[nodiscard]] std::string_view Rope::at(const std::size_t idx) const {
+    if (idx == checked_out) { return pending; }
+    return rope_line(root, idx);
+}
+
+[[nodiscard]] std::string& Rope::edit(const std::size_t idx) {
+    if (idx == checked_out) { return pending; }
+
+    commit();
+    pending = rope_line(root, idx);
+    checked_out = idx;
+    return pending;
+}
+
+void Rope::set(const std::size_t idx, std::string text) {
+    if (idx == checked_out) {
+        pending = std::move(text);
+        return;
+    }
+
+    std::vector<std::string> lines = {};
+    lines.push_back(std::move(text));
+    splice(idx, 1, std::move(lines));
+}
+
+void Rope::insert(const std::size_t idx, std::string text) {
+    std::vector<std::string> lines = {};
+    lines.push_back(std::move(text));
+    splice(idx, 0, std::move(lines));
+}
+
+void Rope::erase(const std::size_t idx) {
+    splice(idx, 1, {});
+}
+
+void Rope::append(std::vector<std::string> text) {
+    splice(size(), 0, std::move(text));
+}
+
+// Swap `count` lines from `idx` for `text`, touching only the leaves they
+// span, however many lines there are
+void Rope::splice(const std::size_t idx, const std::size_t count, std::vector<std::string> text) {
+    if (idx + count > size()) { throw std::out_of_range("Rope::splice"); }
+    if (!count && text.empty()) { return; }
+
+    commit();
+    root = make_root(splice_node(root, idx, count, &text));
+}
+
+[[nodiscard]] std::size_t Rope::bytes() const {
+    commit();
+    return root->stats.bytes;
+}
+
+[[nodiscard]] std::size_t Rope::codepoints() const {
+    commit();
+    return root->stats.codepoints;
+}
+
+// Where line idx starts, counting from the start of the buffer
+[[nodiscard]] std::size_t Rope::offset_of(std::size_t idx) const {
+    if (idx > size()) { throw std::out_of_range("Rope::offset_of"); }
+    if (idx == size()) { return bytes(); }
+    commit();
+
+    std::size_t offset = 0;
+    const RopeNode* node = root.get();
+    while (!node->leaf()) {
+        for (const auto& child : node->children) {
+            if (idx < child->stats.lines) {
+                node = child.get();
+                break;
+            }
+            idx -= child->stats.lines;
+            offset += child->stats.bytes;
+        }
+    }
+
+    for (std::size_t i = 0; i < idx; i++) {
+        offset += node->text.at(i).size() + 1;
+    }
+
+    return offset;
+}
+
+// The line the byte at `offset` is in. A line's newline is part of it
+[[nodiscard]] std::size_t Rope::line_at(std::size_t offset) const {
+    if (offset >= bytes()) { throw std::out_of_range("Rope::line_at"); }
+
+    std::size_t idx = 0;
+    const RopeNode* node = root.get();
+    while (!node->leaf()) {
+        for (const auto& child : node->children) {
+            if (offset < child->stats.bytes) {
+                node = child.get();
+                break;
+            }
+            offset -= child->stats.bytes;
+            idx += child->stats.lines;
+        }
+    }
+
+    for (const auto& line : node->text) {
+        if (offset <= line.size()) { break; }
+        offset -= line.size() + 1;
+        idx++;
+    }
+
+    return idx;
+}
+
+// The buffer as it is now. Later edits don't change it
+[[nodiscard]] RopeRef Rope::snapshot() const {
+    commit();
+    return root;
+}
+
+void Rope::restore(RopeRef snap) {
+    checked_out = std::string::npos;
+    root = std::move(snap);
+}
+
+// Keeping a state is only keeping the root, as nodes are never changed
+[[nodiscard]] std::shared_ptr<const BufferState> Rope::keep_state() {
+    return std::make_shared<RopeState>(snapshot());
+}
+
+// Only the leaves that aren't in both are reported as changed
+[[nodiscard]] std::vector<LineSpan> Rope::restore_state(const BufferState& state) {
+    const RopeRef& kept = dynamic_cast<const RopeState&>(state).root;
+    std::vector<LineSpan> ret = rope_diff(snapshot(), kept);
+    restore(kept);
+    return ret;
+}
+
+RopeState::RopeState(RopeRef snapshot) : root(std::move(snapshot)) {}
+
+// Put the line handed out by `edit()` back into the tree
+void Rope::commit() const {
+    if (checked_out == std::string::npos) { return; }
+
+    std::vector<std::string> lines = {};
+    lines.push_back(std::move(pending));
+    root = make_root(splice_node(root, checked_out, 1, &lines));
+    checked_out = std::string::npos;
+}
@@ -0,0 +1,73 @@
+#ifndef ROPE_H
+#define ROPE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "text_buffer.h"
+
+// Totals for everything under a rope node. Every line counts its newline
+struct RopeStats {
+    std::size_t lines = 0;
+    std::size_t bytes = 0;
+    std::size_t codepoints = 0;
+};
+
+struct RopeNode;
+using RopeRef = std::shared_ptr<const RopeNode>;
+
+// Nodes are never changed once built, an edit copies the path down to the
+// lines it touches and shares the rest with the tree it came from
+struct RopeNode {
+    RopeStats stats = {};
+    std::vector<std::string> text = {};  // Leaves only
+    std::vector<RopeRef> children = {};  // Internal nodes only
+
+    [[nodiscard]] bool leaf() const;
+};
+
+// B-tree of chunks of lines. Finding a line, or the line at a byte offset, is
+// O(log n), and as nodes are immutable a copy of the whole buffer is just a
+// copy of `root` (see `snapshot`).
+// NOTE: `edit()` hands out the line outside of the tree, it's put back the
+// next time the tree is needed
+struct Rope : TextBuffer {
+    mutable RopeRef root;
+    mutable std::size_t checked_out = std::string::npos;
+    mutable std::string pending = "";
+
+    explicit Rope(std::vector<std::string>);
+    [[nodiscard]] std::size_t size() const override;
+    [[nodiscard]] std::string_view at(const std::size_t) const override;
+    [[nodiscard]] std::string& edit(const std::size_t) override;
+    void set(const std::size_t, std::string) override;
+    void insert(const std::size_t, std::string) override;
+    void erase(const std::size_t) override;
+    void append(std::vector<std::string>) override;
+    void splice(const std::size_t, const std::size_t, std::vector<std::string>) override;
+
+    [[nodiscard]] std::size_t bytes() const;
+    [[nodiscard]] std::size_t codepoints() const;
+    [[nodiscard]] std::size_t offset_of(const std::size_t) const;
+    [[nodiscard]] std::size_t line_at(const std::size_t) const;
+    [[nodiscard]] RopeRef snapshot() const;
+    void restore(RopeRef);
+    void commit() const;
+    [[nodiscard]] std::shared_ptr<const BufferState> keep_state() override;
+    [[nodiscard]] std::vector<LineSpan> restore_state(const BufferState&) override;
+};
+
+// A snapshot, as a state kept for `Rope::restore_state`
+struct RopeState : BufferState {
+    RopeRef root;
+
+    explicit RopeState(RopeRef);
+};
+
+[[nodiscard]] const std::string& rope_line(const RopeRef&, std::size_t);
+[[nodiscard]] std::vector<LineSpan> rope_diff(const RopeRef&, const RopeRef&);
+
+#endif  // ROPE_H
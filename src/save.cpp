@@ -0,0 +1,300 @@
+#include "save.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+
+#include "mapped_file.h"
+
+// Lines are copied into a buffer this big and written out a buffer at a time
+static const std::size_t WRITE_BUFFER_SIZE = 1024 * 1024;
+
+// write() until every byte has gone, or a real error
+[[nodiscard]] bool write_fully(const int fd, const char* data, std::size_t len) {
+    while (len) {
+        const ssize_t written = write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) { continue; }
+            return false;
+        }
+
+        data += written;
+        len -= std::size_t(written);
+    }
+
+    return true;
+}
+
+// Write lines [first, count) at the fd's current offset. `written.hash` is
+// carried on over every byte, so it ends up covering whatever came before
+[[nodiscard]] static bool write_lines(
+    const int fd,
+    const std::size_t first,
+    const std::size_t count,
+    const line_source_t& line,
+    Written& written) {
+    std::vector<char> buffer;
+    buffer.reserve(WRITE_BUFFER_SIZE);
+
+    auto flush = [&]() {
+        const bool ok = write_fully(fd, buffer.data(), buffer.size());
+        written.bytes += buffer.size();
+        written.hash = content_hash({buffer.data(), buffer.size()}, written.hash);
+        buffer.clear();
+        return ok;
+    };
+
+    for (std::size_t i = first; i < count; i++) {
+        const std::string_view text = line(i);
+        if (buffer.size() + text.size() + 1 > WRITE_BUFFER_SIZE && !flush()) { return false; }
+
+        // Lines bigger than the buffer skip it altogether
+        if (text.size() >= WRITE_BUFFER_SIZE) {
+            if (!write_fully(fd, text.data(), text.size())) { return false; }
+            written.bytes += text.size();
+            written.hash = content_hash(text, written.hash);
+        } else {
+            buffer.insert(buffer.end(), text.begin(), text.end());
+        }
+
+        buffer.push_back('\n');
+    }
+
+    return flush();
+}
+
+// Make sure a rename in `dir` survives a crash
+static void sync_dir(const std::filesystem::path& dir) {
+    const int dir_fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dir_fd != -1) {
+        fsync(dir_fd);
+        close(dir_fd);
+    }
+}
+
+// Match the permissions of the file being replaced, or what a newly created
+// file would have got
+static void copy_permissions(const int fd, const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        fchmod(fd, st.st_mode & 07777);
+        // Only works if we're allowed to, which is fine to ignore
+        [[maybe_unused]] const int ret = fchown(fd, st.st_uid, st.st_gid);
+        return;
+    }
+
+    const mode_t mask = umask(0);
+    umask(mask);
+    fchmod(fd, 0666 & ~mask);
+}
+
+// Write `count` lines to `path` without ever leaving a half written file
+// behind: the lines go to a temp file in the same directory, which is
+// fsynced and renamed over the original
+[[nodiscard]] std::optional<Written> atomic_write(
+    const std::string& path,
+    const std::size_t count,
+    const line_source_t& line) {
+    namespace fs = std::filesystem;
+
+    // Write through symlinks rather than replacing them
+    std::error_code ec;
+    fs::path target = path;
+    if (fs::is_symlink(target, ec)) {
+        target = fs::canonical(target, ec);
+        if (ec) { return {}; }
+    }
+
+    const fs::path dir = target.has_parent_path() ? target.parent_path() : fs::path(".");
+    std::string temp = (dir / ("." + target.filename().string() + ".iris-XXXXXX")).string();
+
+    const int fd = mkstemp(temp.data());
+    if (fd == -1) { return {}; }
+
+    copy_permissions(fd, target.string());
+
+    Written ret = {0, FNV_OFFSET_BASIS};
+    const bool written = write_lines(fd, 0, count, line, ret) && fsync(fd) == 0;
+
+    if (close(fd) != 0 || !written || std::rename(temp.c_str(), target.c_str()) != 0) {
+        unlink(temp.c_str());
+        return {};
+    }
+
+    sync_dir(dir);
+    return ret;
+}
+
+// Hash of the first `size` bytes of `path`
+[[nodiscard]] static std::optional<uint64_t> prefix_hash(
+    const std::string& path,
+    const std::size_t size) {
+    const MappedFile mapping(path);
+    if (mapping.size < size) { return {}; }
+    return content_hash(mapping.view().substr(0, size));
+}
+
+// Rewrite `path` from byte `offset` onward with lines [first, count), the
+// lines before that being on disk already. The unchanged part is cloned into a
+// temp file (FICLONE shares its extents rather than copying them) which is
+// renamed over the original, as in `atomic_write`. The bytes are the new size
+// of the file, and the part kept is read back to hash it.
+// NOTE: Where the filesystem can't clone, or `clone` is false, the whole file
+// is written by `atomic_write` instead. The original is never written to, so
+// a crash or a full disk part way through can't leave it cut short
+[[nodiscard]] std::optional<Written> incremental_write(
+    const std::string& path,
+    const std::size_t offset,
+    const std::size_t first,
+    const std::size_t count,
+    const line_source_t& line,
+    const bool clone) {
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    const fs::path target = fs::canonical(path, ec);
+    if (ec) { return {}; }
+
+    // The file isn't what the job was made from
+    const std::uintmax_t size = fs::file_size(target, ec);
+    if (ec || size < offset) { return {}; }
+
+    const int src_fd = open(target.c_str(), O_RDONLY);
+    if (src_fd == -1) { return {}; }
+
+    std::string temp =
+        (target.parent_path() / ("." + target.filename().string() + ".iris-XXXXXX")).string();
+    const int temp_fd = mkstemp(temp.data());
+    bool cloned = false;
+
+#ifdef FICLONE
+    if (clone && temp_fd != -1 && ioctl(temp_fd, FICLONE, src_fd) == 0) { cloned = true; }
+#endif
+
+    close(src_fd);
+    if (!cloned) {
+        if (temp_fd != -1) {
+            close(temp_fd);
+            unlink(temp.c_str());
+        }
+        return atomic_write(target.string(), count, line);
+    }
+
+    const std::optional<uint64_t> kept_hash = prefix_hash(target.string(), offset);
+    if (!kept_hash.has_value()) {
+        close(temp_fd);
+        unlink(temp.c_str());
+        return {};
+    }
+
+    Written ret = {0, kept_hash.value()};
+    const bool written = lseek(temp_fd, off_t(offset), SEEK_SET) != -1 &&
+                         write_lines(temp_fd, first, count, line, ret) &&
+                         ftruncate(temp_fd, off_t(offset + ret.bytes)) == 0 &&
+                         fsync(temp_fd) == 0;
+    ret.bytes += offset;
+    copy_permissions(temp_fd, target.string());
+
+    if (close(temp_fd) != 0 || !written || std::rename(temp.c_str(), target.c_str()) != 0) {
+        unlink(temp.c_str());
+        return {};
+    }
+
+    sync_dir(target.parent_path());
+    return ret;
+}
+
+[[nodiscard]] std::optional<FileStamp> file_stamp(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) { return {}; }
+
+    return FileStamp {
+        std::size_t(st.st_size), int64_t(st.st_mtim.tv_sec) * 1'000'000'000 + st.st_mtim.tv_nsec};
+}
+
+// How many of the first `lines` lines of the job match the file on disk, and
+// how many bytes they take up. CRLF endings, or the file having changed
+// underneath us, stop the prefix early
+[[nodiscard]] static std::pair<std::size_t, std::size_t> verify_prefix(
+    const SaveJob& job,
+    const std::size_t lines) {
+    const MappedFile mapping(job.filename);
+    const std::string_view disk = mapping.view();
+    std::size_t matched = 0;
+    std::size_t bytes = 0;
+
+    for (; matched < lines; matched++) {
+        const std::string_view line = job.line(matched);
+        if (disk.size() <= bytes + line.size() || disk.substr(bytes, line.size()) != line ||
+            disk[bytes + line.size()] != '\n') {
+            break;
+        }
+
+        bytes += line.size() + 1;
+    }
+
+    return {matched, bytes};
+}
+
+// Only rewrite the file from where it stops matching the job, falling back to
+// writing the whole thing if that doesn't work out
+[[nodiscard]] std::optional<Written> write_job(const SaveJob& job) {
+    std::size_t prefix_lines = job.prefix_lines;
+    std::size_t prefix_bytes = job.prefix_bytes;
+
+    if (!prefix_lines && job.verify_lines) {
+        std::tie(prefix_lines, prefix_bytes) = verify_prefix(job, job.verify_lines);
+    }
+
+    if (prefix_lines) {
+        const auto written =
+            incremental_write(job.filename, prefix_bytes, prefix_lines, job.count, job.line);
+        if (written.has_value()) { return written; }
+    }
+
+    return atomic_write(job.filename, job.count, job.line);
+}
+
+// Write the job out, then its undo history with the hash of what was written,
+// so neither the hashing nor the history's sync happen on the thread that
+// asked for the save
+[[nodiscard]] std::optional<Written> run_job(const SaveJob& job) {
+    std::optional<Written> ret = write_job(job);
+    if (ret.has_value() && job.history != nullptr) {
+        ret.value().history_kept = job.history->persist(job.history_path, ret.value().hash);
+    }
+    return ret;
+}
+
+BackgroundSave::BackgroundSave(SaveJob save_job)
+    : job(std::move(save_job)), worker(std::bind_front(&BackgroundSave::run, this)) {}
+
+// NOTE: A save is never abandoned part way, even when the model it came from
+// is closed, so the stop token is ignored
+void BackgroundSave::run([[maybe_unused]] std::stop_token stop) {
+    written = run_job(job);
+    finished = true;
+    finished.notify_all();
+}
+
+[[nodiscard]] bool BackgroundSave::done() const {
+    return finished;
+}
+
+void BackgroundSave::wait() {
+    finished.wait(false);
+}
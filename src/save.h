@@ -0,0 +1,91 @@
+#ifndef SAVE_H
+#define SAVE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "undo_log.h"
+
+using line_source_t = std::function<std::string_view(std::size_t)>;
+
+// Enough to tell if a file has been changed since we last wrote it
+struct FileStamp {
+    std::size_t size = 0;
+    int64_t mtime_ns = 0;
+
+    [[nodiscard]] bool operator==(const FileStamp& other) const {
+        return size == other.size && mtime_ns == other.mtime_ns;
+    }
+};
+
+// Everything needed to write a buffer out, without the buffer itself
+struct SaveJob {
+    std::string filename = "";
+    std::size_t count = 0;
+    line_source_t line = nullptr;
+
+    // The first `prefix_lines` lines (`prefix_bytes` bytes) are known to be
+    // on disk already. Failing that, up to `verify_lines` lines are checked
+    // against the file to see how many are
+    std::size_t prefix_lines = 0;
+    std::size_t prefix_bytes = 0;
+    std::size_t verify_lines = 0;
+
+    // What the model looked like when the job was made
+    std::size_t dirty_from = std::string::npos;
+    std::size_t version = 0;
+    std::size_t journal_mark = 0;
+
+    // A copy of the undo history, kept at `history_path` once the file is
+    // written. See `run_job`
+    std::shared_ptr<UndoLog> history = nullptr;
+    std::string history_path = "";
+};
+
+// What a save wrote, and the hash of the whole file once it had
+struct Written {
+    std::size_t bytes = 0;
+    uint64_t hash = 0;
+    bool history_kept = false;
+};
+
+// Runs a `SaveJob` on its own thread. `line` must only read data owned by
+// the job, as the buffer keeps changing while it runs
+struct BackgroundSave {
+    SaveJob job;
+    std::optional<Written> written = std::nullopt;
+    std::atomic<bool> finished = false;
+    std::jthread worker;  // Declared last so it's joined before the rest is destroyed
+
+    explicit BackgroundSave(SaveJob);
+    void run(std::stop_token);
+    [[nodiscard]] bool done() const;
+    void wait();
+};
+
+[[nodiscard]] std::optional<FileStamp> file_stamp(const std::string&);
+[[nodiscard]] bool write_fully(const int, const char*, std::size_t);
+
+[[nodiscard]] std::optional<Written> atomic_write(
+    const std::string&,
+    const std::size_t,
+    const line_source_t&);
+[[nodiscard]] std::optional<Written> incremental_write(
+    const std::string&,
+    const std::size_t,
+    const std::size_t,
+    const std::size_t,
+    const line_source_t&,
+    const bool clone = true);
+[[nodiscard]] std::optional<Written> write_job(const SaveJob&);
+[[nodiscard]] std::optional<Written> run_job(const SaveJob&);
+
+#endif  // SAVE_H
@@ -0,0 +1,186 @@
+#include "scan.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define IRIS_SCAN_X86
+#endif
+
+// All three kernels append the absolute offset (`base` + index) of every
+// '\n' and '\r' in `text` to `out`, in order. The vector kernels test a
+// whole register of bytes at once and only fall through to per-byte work for
+// the (rare) bytes that matched, plus the unaligned tail of the input
+
+static void scan_scalar(std::string_view text, std::size_t base, std::vector<std::size_t>& out) {
+    for (std::size_t i = 0; i < text.size(); i++) {
+        const char ch = text[i];
+        if (ch == '\n' || ch == '\r') { out.push_back(base + i); }
+    }
+}
+
+#ifdef IRIS_SCAN_X86
+static void scan_sse2(std::string_view text, std::size_t base, std::vector<std::size_t>& out) {
+    const char* const data = text.data();
+    const std::size_t len = text.size();
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage = _mm_set1_epi8('\r');
+
+    std::size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        const __m128i hits =
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriage));
+
+        auto mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+        while (mask) {
+            out.push_back(base + i + std::size_t(std::countr_zero(mask)));
+            mask &= mask - 1;
+        }
+    }
+
+    scan_scalar(text.substr(i), base + i, out);
+}
+
+__attribute__((target("avx2"))) static void scan_avx2(
+    std::string_view text,
+    std::size_t base,
+    std::vector<std::size_t>& out) {
+    const char* const data = text.data();
+    const std::size_t len = text.size();
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i carriage = _mm256_set1_epi8('\r');
+
+    std::size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i hits =
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, newline), _mm256_cmpeq_epi8(chunk, carriage));
+
+        auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+        while (mask) {
+            out.push_back(base + i + std::size_t(std::countr_zero(mask)));
+            mask &= mask - 1;
+        }
+    }
+
+    scan_sse2(text.substr(i), base + i, out);
+}
+#endif
+
+[[nodiscard]] ScanKernel best_scan_kernel() {
+#ifdef IRIS_SCAN_X86
+    static const ScanKernel best =
+        __builtin_cpu_supports("avx2") ? ScanKernel::AVX2 : ScanKernel::SSE2;
+    return best;
+#else
+    return ScanKernel::Scalar;
+#endif
+}
+
+void scan_line_chars(
+    std::string_view text,
+    std::size_t base,
+    std::vector<std::size_t>& out,
+    ScanKernel kernel) {
+    if (kernel == ScanKernel::Auto) { kernel = best_scan_kernel(); }
+
+    switch (kernel) {
+#ifdef IRIS_SCAN_X86
+        case ScanKernel::AVX2:
+            if (best_scan_kernel() == ScanKernel::AVX2) {
+                scan_avx2(text, base, out);
+                break;
+            }
+            [[fallthrough]];
+        case ScanKernel::SSE2:
+            scan_sse2(text, base, out);
+            break;
+#endif
+        default:
+            scan_scalar(text, base, out);
+            break;
+    };
+}
+
+// Whitespace here is the same set as WHITESPACE: ' ' plus '\t' through '\r'
+[[nodiscard]] static bool is_space(const char ch) {
+    return ch == ' ' || static_cast<unsigned char>(ch - '\t') <= '\r' - '\t';
+}
+
+[[nodiscard]] static std::size_t trim_point_scalar(std::string_view text) {
+    std::size_t end = text.size();
+    while (end && is_space(text[end - 1])) {
+        end--;
+    }
+
+    return end;
+}
+
+#ifdef IRIS_SCAN_X86
+// Walk back from the end of `text` a register at a time until one holds a
+// non-whitespace byte
+[[nodiscard]] static std::size_t trim_point_sse2(std::string_view text) {
+    const char* const data = text.data();
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i range = _mm_set1_epi8('\r' - '\t');
+
+    std::size_t end = text.size();
+    for (; end >= 16; end -= 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + end - 16));
+        const __m128i offset = _mm_sub_epi8(chunk, tab);
+        const __m128i spaces = _mm_or_si128(
+            _mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(_mm_min_epu8(offset, range), offset));
+
+        const auto other = static_cast<uint32_t>(~_mm_movemask_epi8(spaces)) & 0xFFFF;
+        if (other) { return end - 16 + std::size_t(31 - std::countl_zero(other)) + 1; }
+    }
+
+    return trim_point_scalar(text.substr(0, end));
+}
+#endif
+
+// Where the trailing whitespace of `text` starts, or its size if it has none
+[[nodiscard]] std::size_t trim_point(std::string_view text, ScanKernel kernel) {
+    if (kernel == ScanKernel::Auto) { kernel = best_scan_kernel(); }
+
+#ifdef IRIS_SCAN_X86
+    if (kernel != ScanKernel::Scalar) { return trim_point_sse2(text); }
+#endif
+
+    return trim_point_scalar(text);
+}
+
+// Cut `text` into (at most) `parts` chunks of roughly equal size. Every chunk
+// but the last ends just after a newline, so no line spans two chunks and
+// each one can be split into lines independently
+[[nodiscard]] std::vector<std::string_view> split_on_lines(
+    std::string_view text,
+    std::size_t parts) {
+    std::vector<std::string_view> chunks = {};
+    if (text.empty()) { return chunks; }
+
+    const std::size_t target = text.size() / std::max(parts, std::size_t(1));
+    std::size_t start = 0;
+
+    while (start < text.size()) {
+        std::size_t end = text.size();
+
+        if (chunks.size() + 1 < parts && start + target < text.size()) {
+            const void* found =
+                std::memchr(text.data() + start + target, '\n', text.size() - start - target);
+            if (found != nullptr) {
+                end = std::size_t(static_cast<const char*>(found) - text.data()) + 1;
+            }
+        }
+
+        chunks.push_back(text.substr(start, end - start));
+        start = end;
+    }
+
+    return chunks;
+}
@@ -0,0 +1,21 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Which implementation `scan_line_chars` runs. `Auto` picks the widest one
+// the current CPU supports
+enum class ScanKernel { Auto, Scalar, SSE2, AVX2 };
+
+[[nodiscard]] ScanKernel best_scan_kernel();
+void scan_line_chars(
+    std::string_view,
+    std::size_t,
+    std::vector<std::size_t>&,
+    ScanKernel kernel = ScanKernel::Auto);
+[[nodiscard]] std::size_t trim_point(std::string_view, ScanKernel kernel = ScanKernel::Auto);
+[[nodiscard]] std::vector<std::string_view> split_on_lines(std::string_view, std::size_t);
+
+#endif  // SCAN_H
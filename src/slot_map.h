@@ -0,0 +1,142 @@
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Refers to one value in a SlotMap. Once that value is erased the handle goes
+// stale, and never finds whatever is put in the same slot after it
+struct SlotHandle {
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    [[nodiscard]] bool operator==(const SlotHandle&) const = default;
+};
+
+// Values that never move once they're added, however many more are added or
+// erased around them. Finding, adding and erasing are all O(1), and a freed
+// slot is reused by the next value added
+template <typename T>
+struct SlotMap {
+    struct Slot {
+        std::unique_ptr<T> value = nullptr;
+        uint32_t generation = 0;
+    };
+
+    // Visits every value in slot order, stepping over empty slots
+    template <typename V, typename It>
+    struct Iterator {
+        It pos;
+        It last;
+
+        [[nodiscard]] V& operator*() const { return *pos->value; }
+        [[nodiscard]] bool operator==(const Iterator& other) const { return pos == other.pos; }
+
+        Iterator& operator++() {
+            do {
+                ++pos;
+            } while (pos != last && pos->value == nullptr);
+            return *this;
+        }
+    };
+
+    using iterator = Iterator<T, typename std::vector<Slot>::iterator>;
+    using const_iterator = Iterator<const T, typename std::vector<Slot>::const_iterator>;
+
+    std::vector<Slot> slots = {};
+    std::vector<uint32_t> free_slots = {};
+    std::size_t count = 0;
+
+    [[nodiscard]] SlotHandle insert(T value) {
+        uint32_t index = uint32_t(slots.size());
+        if (free_slots.empty()) {
+            slots.emplace_back();
+        } else {
+            index = free_slots.back();
+            free_slots.pop_back();
+        }
+
+        slots.at(index).value = std::make_unique<T>(std::move(value));
+        count++;
+        return {index, slots.at(index).generation};
+    }
+
+    template <typename... Args>
+    [[nodiscard]] SlotHandle emplace(Args&&... args) {
+        return insert(T(std::forward<Args>(args)...));
+    }
+
+    // Returns false if the handle had already gone stale
+    bool erase(const SlotHandle handle) {
+        if (get(handle) == nullptr) { return false; }
+
+        Slot& slot = slots.at(handle.index);
+        slot.value.reset();
+        slot.generation++;
+        free_slots.push_back(handle.index);
+        count--;
+        return true;
+    }
+
+    // nullptr if the value has been erased
+    [[nodiscard]] T* get(const SlotHandle handle) const {
+        if (handle.index >= slots.size()) { return nullptr; }
+
+        const Slot& slot = slots.at(handle.index);
+        if (slot.generation != handle.generation) { return nullptr; }
+        return slot.value.get();
+    }
+
+    [[nodiscard]] bool contains(const SlotHandle handle) const { return get(handle) != nullptr; }
+
+    // The value in slot `index`
+    [[nodiscard]] T& at(const std::size_t index) const {
+        if (index >= slots.size() || slots.at(index).value == nullptr) {
+            throw std::out_of_range("SlotMap::at");
+        }
+        return *slots.at(index).value;
+    }
+
+    // The handle for whatever is in slot `index` now, if anything
+    [[nodiscard]] std::optional<SlotHandle> handle_at(const std::size_t index) const {
+        if (index >= slots.size() || slots.at(index).value == nullptr) { return std::nullopt; }
+        return SlotHandle {uint32_t(index), slots.at(index).generation};
+    }
+
+    // Every live handle, in slot order
+    [[nodiscard]] std::vector<SlotHandle> handles() const {
+        std::vector<SlotHandle> ret = {};
+        ret.reserve(count);
+        for (std::size_t i = 0; i < slots.size(); i++) {
+            if (slots.at(i).value != nullptr) {
+                ret.push_back({uint32_t(i), slots.at(i).generation});
+            }
+        }
+        return ret;
+    }
+
+    [[nodiscard]] std::size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+
+    [[nodiscard]] iterator begin() { return first<iterator>(slots.begin(), slots.end()); }
+    [[nodiscard]] iterator end() { return {slots.end(), slots.end()}; }
+    [[nodiscard]] const_iterator begin() const {
+        return first<const_iterator>(slots.begin(), slots.end());
+    }
+    [[nodiscard]] const_iterator end() const { return {slots.end(), slots.end()}; }
+
+    template <typename I, typename It>
+    [[nodiscard]] static I first(It pos, const It last) {
+        while (pos != last && pos->value == nullptr) {
+            ++pos;
+        }
+        return {pos, last};
+    }
+};
+
+#endif  // SLOT_MAP_H
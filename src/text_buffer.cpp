@@ -0,0 +1,176 @@
+#include "text_buffer.h"
+
+#include <iterator>
+#include <stdexcept>
+
+#include "constants.h"
+#include "gap_buffer.h"
+#include "piece_table.h"
+#include "rope.h"
+
+void TextBuffer::splice(
+    const std::size_t idx,
+    const std::size_t count,
+    std::vector<std::string> lines) {
+    if (idx + count > size()) { throw std::out_of_range("TextBuffer::splice"); }
+
+    for (std::size_t i = 0; i < count; i++) {
+        erase(idx);
+    }
+
+    for (std::size_t i = 0; i < lines.size(); i++) {
+        insert(idx + i, std::move(lines.at(i)));
+    }
+}
+
+// Backends that can't point into the arena take a copy of every line.
+// NOTE: The arena is only freed once they're copied
+void TextBuffer::adopt(LineArena, std::vector<LineRef> lines) {
+    std::vector<std::string> text = {};
+    text.reserve(lines.size());
+    for (const LineRef& line : lines) {
+        text.emplace_back(line.text());
+    }
+    append(std::move(text));
+}
+
+// Backends that don't keep a LineRef for each line work it out when asked
+[[nodiscard]] LineRef TextBuffer::line_ref(const std::size_t idx) const {
+    return LineRef(at(idx));
+}
+
+[[nodiscard]] bool TextBuffer::read_only() const {
+    return false;
+}
+
+[[nodiscard]] std::shared_ptr<const BufferState> TextBuffer::keep_state() {
+    return nullptr;
+}
+
+[[nodiscard]] std::vector<LineSpan> TextBuffer::restore_state(const BufferState&) {
+    throw std::logic_error("TextBuffer::restore_state");
+}
+
+[[nodiscard]] bool TextBuffer::empty() const {
+    return size() == 0;
+}
+
+[[nodiscard]] bool TextBuffer::operator==(const TextBuffer& other) const {
+    if (size() != other.size()) { return false; }
+
+    for (std::size_t i = 0; i < size(); i++) {
+        if (at(i) != other.at(i)) { return false; }
+    }
+
+    return true;
+}
+
+[[nodiscard]] std::vector<std::string> TextBuffer::to_vector() const {
+    std::vector<std::string> ret = {};
+    ret.reserve(size());
+    for (std::size_t i = 0; i < size(); i++) {
+        ret.emplace_back(at(i));
+    }
+    return ret;
+}
+
+VectorBuffer::VectorBuffer(std::vector<std::string> text)
+    : lines(std::move(text)), info(lines.size()) {}
+
+[[nodiscard]] std::size_t VectorBuffer::size() const {
+    return lines.size();
+}
+
+[[nodiscard]] std::string_view VectorBuffer::at(const std::size_t idx) const {
+    return lines.at(idx);
+}
+
+// NOTE: The line is about to change, so what's known about it is forgotten
+[[nodiscard]] std::string& VectorBuffer::edit(const std::size_t idx) {
+    info.at(idx).forget();
+    return lines.at(idx);
+}
+
+void VectorBuffer::set(const std::size_t idx, std::string text) {
+    edit(idx) = std::move(text);
+}
+
+void VectorBuffer::insert(const std::size_t idx, std::string text) {
+    lines.insert(lines.begin() + std::ptrdiff_t(idx), std::move(text));
+    info.insert(info.begin() + std::ptrdiff_t(idx), LineInfo {});
+}
+
+void VectorBuffer::erase(const std::size_t idx) {
+    lines.erase(lines.begin() + std::ptrdiff_t(idx));
+    info.erase(info.begin() + std::ptrdiff_t(idx));
+}
+
+void VectorBuffer::append(std::vector<std::string> text) {
+    info.resize(info.size() + text.size());
+    if (lines.empty()) {
+        lines = std::move(text);
+        return;
+    }
+
+    lines.reserve(lines.size() + text.size());
+    std::move(text.begin(), text.end(), std::back_inserter(lines));
+}
+
+void VectorBuffer::splice(
+    const std::size_t idx,
+    const std::size_t count,
+    std::vector<std::string> text) {
+    if (idx + count > lines.size()) { throw std::out_of_range("VectorBuffer::splice"); }
+
+    const auto start = lines.begin() + std::ptrdiff_t(idx);
+    lines.erase(start, start + std::ptrdiff_t(count));
+    lines.insert(
+        lines.begin() + std::ptrdiff_t(idx), std::make_move_iterator(text.begin()),
+        std::make_move_iterator(text.end()));
+
+    const auto first = info.begin() + std::ptrdiff_t(idx);
+    info.erase(first, first + std::ptrdiff_t(count));
+    info.insert(info.begin() + std::ptrdiff_t(idx), text.size(), LineInfo {});
+}
+
+[[nodiscard]] LineRef VectorBuffer::line_ref(const std::size_t idx) const {
+    return info.at(idx).ref(lines.at(idx));
+}
+
+// The backend for a file of `bytes`. Small files keep the plain vector, big
+// ones something that doesn't move every line after an edit, and the biggest
+// a piece table that keeps their text in a few large slabs. Huge read-only
+// files are paged in from disk instead (see `open_file_paged`)
+[[nodiscard]] Backend choose_backend(const std::size_t bytes, const bool readonly) {
+    if (readonly && bytes >= PAGED_LOAD_SIZE) { return Backend::Paged; }
+    if (bytes >= PIECE_TABLE_SIZE) { return Backend::PieceTable; }
+    if (bytes >= GAP_BUFFER_SIZE) { return Backend::Gap; }
+    return Backend::Vector;
+}
+
+// With `Auto`, buffers with enough lines that shifting them all on every new
+// line would be noticeable are kept in a piece table.
+// NOTE: A paged buffer can only be opened from a file, so `Paged` is treated
+// as `Auto`
+[[nodiscard]] std::unique_ptr<TextBuffer> make_text_buffer(
+    std::vector<std::string> lines,
+    const Backend backend) {
+    switch (backend) {
+        case Backend::Vector:
+            return std::make_unique<VectorBuffer>(std::move(lines));
+        case Backend::Gap:
+            return std::make_unique<GapBuffer>(std::move(lines));
+        case Backend::PieceTable:
+            return std::make_unique<PieceTable>(std::move(lines));
+        case Backend::Rope:
+            return std::make_unique<Rope>(std::move(lines));
+        case Backend::Auto:
+        case Backend::Paged:
+            break;
+    };
+
+    if (lines.size() >= PIECE_TABLE_LINES) {
+        return std::make_unique<PieceTable>(std::move(lines));
+    }
+    return std::make_unique<VectorBuffer>(std::move(lines));
+}
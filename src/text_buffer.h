@@ -0,0 +1,88 @@
+#ifndef TEXT_BUFFER_H
+#define TEXT_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "line_arena.h"
+
+enum class Backend { Auto, Vector, Gap, PieceTable, Rope, Paged };
+
+// Lines [first, first + removed) of one version of a buffer that are
+// [first, first + added) in another. `first` counts any earlier spans as
+// already swapped
+struct LineSpan {
+    std::size_t first = 0;
+    std::size_t removed = 0;
+    std::size_t added = 0;
+};
+
+// A copy of a buffer from `TextBuffer::keep_state`, only for the buffer that
+// made it to go back to
+struct BufferState {
+    virtual ~BufferState() = default;
+};
+
+// Where the lines of a buffer are kept. A line returned by `at()` or `edit()`
+// is only valid until the buffer is next changed
+struct TextBuffer {
+    virtual ~TextBuffer() = default;
+
+    [[nodiscard]] virtual std::size_t size() const = 0;
+    [[nodiscard]] virtual std::string_view at(const std::size_t) const = 0;
+    // The line at idx, to be changed in place
+    [[nodiscard]] virtual std::string& edit(const std::size_t) = 0;
+    virtual void set(const std::size_t, std::string) = 0;
+    virtual void insert(const std::size_t, std::string) = 0;
+    virtual void erase(const std::size_t) = 0;
+    // Add lines to the end of the buffer
+    virtual void append(std::vector<std::string>) = 0;
+    // Swap `count` lines from idx for the given lines, in one go
+    virtual void splice(const std::size_t, const std::size_t, std::vector<std::string>);
+    // Add lines kept in an arena to the end of the buffer
+    virtual void adopt(LineArena, std::vector<LineRef>);
+    // Line idx, and what's known about it
+    [[nodiscard]] virtual LineRef line_ref(const std::size_t) const;
+
+    // Whether the lines can't be changed at all
+    [[nodiscard]] virtual bool read_only() const;
+    // The buffer as it is now, or nullptr for backends that would have to
+    // copy every line to keep it
+    [[nodiscard]] virtual std::shared_ptr<const BufferState> keep_state();
+    // Go back to a kept state, returning the lines that changed
+    [[nodiscard]] virtual std::vector<LineSpan> restore_state(const BufferState&);
+
+    [[nodiscard]] bool empty() const;
+    [[nodiscard]] std::vector<std::string> to_vector() const;
+    [[nodiscard]] bool operator==(const TextBuffer&) const;
+};
+
+// Every line its own string, one after the other. Cheapest for the small
+// files most edits happen in, but adding or removing a line moves every line
+// after it
+struct VectorBuffer : TextBuffer {
+    std::vector<std::string> lines;
+    // What's known about each line, see `LineInfo`
+    mutable std::vector<LineInfo> info;
+
+    explicit VectorBuffer(std::vector<std::string>);
+    [[nodiscard]] std::size_t size() const override;
+    [[nodiscard]] std::string_view at(const std::size_t) const override;
+    [[nodiscard]] std::string& edit(const std::size_t) override;
+    void set(const std::size_t, std::string) override;
+    void insert(const std::size_t, std::string) override;
+    void erase(const std::size_t) override;
+    void append(std::vector<std::string>) override;
+    void splice(const std::size_t, const std::size_t, std::vector<std::string>) override;
+    [[nodiscard]] LineRef line_ref(const std::size_t) const override;
+};
+
+[[nodiscard]] Backend choose_backend(const std::size_t, const bool);
+[[nodiscard]] std::unique_ptr<TextBuffer> make_text_buffer(
+    std::vector<std::string>,
+    const Backend = Backend::Auto);
+
+#endif  // TEXT_BUFFER_H
@@ -1,50 +1,30 @@
 #include "text_io.h"
 
+#include <algorithm>
 #include <array>
 #include <cstring>
 #include <filesystem>
-#include <fstream>
+#include <memory>
 #include <sstream>
+#include <tuple>
 
 #include <rawterm/text.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include "constants.h"
+#include "loader.h"
+#include "mapped_file.h"
+#include "rope.h"
+#include "save.h"
+#include "scan.h"
 #include "spdlog/spdlog.h"
 #include "view.h"
 
 [[nodiscard]] opt_lines_t open_file(const std::string& file) {
-    if (!get_file_size(file)) { return {}; }
-
-    auto ret = std::vector<std::string>();
-    std::string line = "";
-    char ch;
-
-    std::ifstream ifs(file);
-    if (ifs.fail()) { return {}; }
-
-    while (ifs.get(ch)) {
-        switch (ch) {
-            case '\r':
-                break;
-            case '\t':
-                line += std::string(TAB_SIZE, ' ');
-                break;
-            case '\n':
-                ret.push_back(line);
-                line = "";
-                break;
-            default:
-                line.push_back(ch);
-        };
-    }
-
-    // If there's no newlines in the stream at all, it never gets added to
-    // the vector
-    if (line.size()) { ret.push_back(line); }
-
-    return ret;
+    const MappedFile mapping(file);
+    if (!mapping.valid()) { return {}; }
+    return load_lines(mapping.view());
 }
 
 [[nodiscard]] unsigned int get_file_size(const std::string& file) {
@@ -56,25 +36,228 @@
     } catch (const fs::filesystem_error&) { return 0; }
 }
 
-[[nodiscard]] WriteData write_to_file(Model* model, std::optional<std::string> filename_input) {
+// Set up a save of `model`. With `snapshot` set, the job writes from its own
+// copy of the buffer so it can run while the model keeps changing
+[[nodiscard]] std::optional<SaveJob> prepare_save(
+    Model* model,
+    std::optional<std::string> filename_input,
+    const bool snapshot) {
     if (!filename_input.has_value() && (model->filename == "NO NAME" || model->filename == "")) {
-        return WriteData();
+        return {};
     }
+
+    // Writing the file would leave the edits a crash left behind with nothing
+    // to apply to, so it waits until they've been recovered or discarded
+    if (model->journal_pending) { return {}; }
+
+    // Only one save of a model at a time, so they land in order
+    std::ignore = poll_save(model, true);
+
+    const bool new_file = filename_input.has_value() && filename_input.value() != model->filename;
     if (filename_input.has_value()) { model->filename = filename_input.value(); }
 
-    std::ofstream out(model->filename);
-    for (auto&& line : model->buf) {
-        rtrim(line);
-        out << line << "\n";
+    // Don't truncate a file that's still being read in
+    model->wait_for_load();
+    model->flush_typing();
+
+    // Trailing whitespace is trimmed from the lines that have been edited, as
+    // one change that can be undone. Read-only buffers never have any
+    const std::size_t line_count = model->line_count();
+    const DirtyLines& dirty = model->dirty_lines;
+    model->begin_undo_group();
+    for (std::size_t i = dirty.next(0); i < line_count; i = dirty.next(i + 1)) {
+        if (trim_point(model->buf->at(i)) == model->buf->at(i).size()) { continue; }
+
+        model->before_edit(i);
+        rtrim(model->buf->edit(i));
+        model->mark_dirty(i);
+    }
+    model->end_undo_group();
+    model->dirty_lines.clear();
+
+    SaveJob job = {};
+    job.filename = model->filename;
+    job.count = line_count;
+    job.dirty_from = model->dirty_from;
+    job.version = model->version;
+    job.journal_mark = model->journal == nullptr ? 0 : model->journal->mark();
+    model->keep_history(job);
+
+    // NOTE: The last line is always written, as the file might not have ended
+    // in a newline
+    const std::optional<FileStamp> stamp = file_stamp(model->filename);
+    const std::size_t clean_lines =
+        (new_file || !stamp.has_value() || !line_count)
+            ? 0
+            : std::min(model->dirty_from, line_count - 1);
+
+    // We wrote the file last and nobody has touched it since, so the prefix
+    // doesn't need checking
+    if (clean_lines && model->disk_synced && model->disk_stamp == stamp.value()) {
+        job.prefix_lines = clean_lines;
+        job.prefix_bytes = model->offset_of(clean_lines);
+    } else {
+        job.verify_lines = clean_lines;
+    }
+
+    if (!snapshot) {
+        job.line = [model](std::size_t idx) { return std::string_view(model->line(idx)); };
+        return job;
+    }
+
+    // Edits made while the save runs are relative to what it writes
+    model->dirty_from = std::string::npos;
+
+    // A rope can hand out the buffer as it is now without copying any of it
+    if (const auto* rope = dynamic_cast<const Rope*>(model->buf.get())) {
+        job.line = [snap = rope->snapshot()](std::size_t idx) {
+            return std::string_view(rope_line(snap, idx));
+        };
+        return job;
+    }
+
+    // Only the lines that might get written are copied
+    const std::size_t first = job.prefix_lines;
+    auto lines = std::make_shared<std::vector<std::string>>();
+    lines->reserve(line_count - first);
+    for (std::size_t i = first; i < line_count; i++) {
+        lines->emplace_back(model->line(i));
+    }
+
+    job.line = [lines, first](std::size_t idx) {
+        return std::string_view(lines->at(idx - first));
+    };
+
+    return job;
+}
+
+// Record how a save of `model` went
+[[nodiscard]] WriteData finish_save(
+    Model* model,
+    const SaveJob& job,
+    const std::optional<Written> written) {
+    model->save_history(job, written.has_value() && written.value().history_kept);
+
+    if (!written.has_value()) {
+        model->dirty_from = std::min(model->dirty_from, job.dirty_from);
+        model->disk_synced = false;
+        return WriteData();
+    }
+
+    model->disk_synced = true;
+    model->disk_stamp = file_stamp(job.filename).value_or(FileStamp());
+
+    // Anything edited since the job was made still needs saving, and
+    // recovering if we crash before it is
+    if (model->version == job.version) {
+        model->unsaved = false;
+        model->dirty_from = std::string::npos;
+        model->journal = nullptr;
+        model->undo_log.clean = model->undo_log.current;
+    } else if (model->journal != nullptr) {
+        model->journal->rebase(job.filename, model->disk_stamp, job.journal_mark);
+    }
+
+    return WriteData(static_cast<int>(written.value().bytes), int32_t(job.count));
+}
+
+[[nodiscard]] WriteData write_to_file(Model* model, std::optional<std::string> filename_input) {
+    const std::optional<SaveJob> job = prepare_save(model, filename_input, false);
+    if (!job.has_value()) { return WriteData(); }
+
+    return finish_save(model, job.value(), run_job(job.value()));
+}
+
+// Write `model` out on a worker thread. The result is picked up by `poll_save`
+[[nodiscard]] bool start_save(Model* model, std::optional<std::string> filename_input) {
+    std::optional<SaveJob> job = prepare_save(model, filename_input, true);
+    if (!job.has_value()) { return false; }
+
+    model->saving = std::make_shared<BackgroundSave>(std::move(job.value()));
+    return true;
+}
+
+// The result of a background save once it's finished, or straight away with
+// `wait` set
+[[nodiscard]] std::optional<WriteData> poll_save(Model* model, const bool wait) {
+    if (model->saving == nullptr) { return {}; }
+
+    if (wait) {
+        model->saving->wait();
+    } else if (!model->saving->done()) {
+        return {};
     }
 
-    model->unsaved = false;
-    return WriteData(static_cast<int>(out.tellp()), int32_t(model->buf.size()));
+    const std::shared_ptr<BackgroundSave> save = std::move(model->saving);
+    model->saving = nullptr;
+    return finish_save(model, save->job, save->written);
 }
 
 void rtrim(std::string& str) {
-    size_t idx = str.find_last_not_of(WHITESPACE);
-    str = str.substr(0, idx + 1);
+    str.erase(trim_point(str));
+}
+
+// The column each char in `line` is drawn at, plus one past the end. Empty
+// if the line has no tabs, as then every char is drawn at its own index
+[[nodiscard]] std::vector<std::size_t> tab_columns(std::string_view line) {
+    std::vector<std::size_t> ret = {};
+    if (line.find('\t') == std::string_view::npos) { return ret; }
+
+    ret.reserve(line.size() + 1);
+    std::size_t col = 0;
+
+    for (const char c : line) {
+        ret.push_back(col);
+        col += (c == '\t') ? TAB_SIZE - (col % TAB_SIZE) : 1;
+    }
+
+    ret.push_back(col);
+    return ret;
+}
+
+// Columns [from, from + count) of `line` as drawn. Only what's on screen is
+// copied, and without tabs nothing before it is looked at either
+[[nodiscard]] DrawnLine draw_columns(
+    const LineParts& line,
+    const std::size_t from,
+    const std::size_t count) {
+    DrawnLine ret = {};
+
+    if (!line.tabs) {
+        if (from < line.size()) { line.copy(ret.text, from, count); }
+        ret.width = line.size();
+        return ret;
+    }
+
+    // NOTE: Tabs before the screen move everything after them, so a line
+    // with any is walked from the start
+    const std::size_t limit = from + count + TAB_SIZE;
+    std::size_t col = 0;
+
+    for (std::size_t i = 0; i < line.size() && col < limit; i++) {
+        const char c = line.at(i);
+        const std::size_t width = (c == '\t') ? TAB_SIZE - (col % TAB_SIZE) : 1;
+
+        for (std::size_t end = col + width; col < end; col++) {
+            if (col >= from && col < from + count) { ret.text.push_back(c == '\t' ? ' ' : c); }
+        }
+    }
+
+    ret.width = col;
+    return ret;
+}
+
+// The column char `pos` of `line` is drawn at, as with `tab_columns`
+[[nodiscard]] std::size_t column_of(const LineParts& line, const std::size_t pos) {
+    if (!line.tabs) { return pos; }
+
+    std::size_t col = 0;
+    const std::size_t end = std::min(pos, line.size());
+    for (std::size_t i = 0; i < end; i++) {
+        col += (line.at(i) == '\t') ? TAB_SIZE - (col % TAB_SIZE) : 1;
+    }
+
+    return col + pos - end;
 }
 
 [[nodiscard]] lines_t lines(const std::string& str) {
@@ -101,18 +284,6 @@ void rtrim(std::string& str) {
     return std::find(alphabet.begin(), alphabet.end(), c) != alphabet.end();
 }
 
-[[nodiscard]] std::string check_filename(const std::string& filename) {
-    std::string err_text = "Iris currently does not support tab-delineated files";
-
-    if (filename == "Makefile" || filename == "makefile") {
-        return err_text;
-    } else if (filename.ends_with(".go")) {
-        return err_text;
-    }
-
-    return "";
-}
-
 // https://stackoverflow.com/a/12774387
 [[nodiscard]] bool file_exists(std::string_view name) {
     struct stat buffer;
@@ -203,7 +374,7 @@ void rtrim(std::string& str) {
     return result;
 }
 
-[[nodiscard]] int first_non_whitespace(const std::string& line) {
+[[nodiscard]] int first_non_whitespace(std::string_view line) {
     std::size_t ret = line.find_first_not_of(WHITESPACE, 0);
     if (ret == std::string::npos) { return -1; }
     return int32_t(ret);
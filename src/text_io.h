@@ -7,6 +7,7 @@
 #include <vector>
 
 #include "model.h"
+#include "save.h"
 
 using lines_t = std::vector<std::string>;
 using opt_lines_t = std::optional<std::vector<std::string>>;
@@ -25,6 +26,7 @@ struct WriteData {
 struct WriteAllData {
     int files = 0;
     bool valid = false;
+    std::vector<std::string> failed = {};  // Filenames that couldn't be saved
 
     WriteAllData() {}
     WriteAllData(int file_count, bool is_valid) : files(file_count), valid(is_valid) {}
@@ -35,16 +37,30 @@ struct Response {
     std::string err = "";
 };
 
+// The columns of a line that are on screen, with tabs expanded, and how wide
+// the line is drawn. The width is only counted until it's past them by a few
+// columns, which is as far as is needed to tell if the line runs off screen
+struct DrawnLine {
+    std::string text = "";
+    std::size_t width = 0;
+};
+
 [[nodiscard]] opt_lines_t open_file(const std::string&);
 [[nodiscard]] unsigned int get_file_size(const std::string&);
+[[nodiscard]] std::optional<SaveJob> prepare_save(Model*, std::optional<std::string>, const bool);
+[[nodiscard]] WriteData finish_save(Model*, const SaveJob&, const std::optional<Written>);
 [[nodiscard]] WriteData write_to_file(Model*, std::optional<std::string>);
+[[nodiscard]] bool start_save(Model*, std::optional<std::string>);
+[[nodiscard]] std::optional<WriteData> poll_save(Model*, const bool wait = false);
 void rtrim(std::string& str);
+[[nodiscard]] std::vector<std::size_t> tab_columns(std::string_view);
+[[nodiscard]] DrawnLine draw_columns(const LineParts&, const std::size_t, const std::size_t);
+[[nodiscard]] std::size_t column_of(const LineParts&, const std::size_t);
 [[nodiscard]] lines_t lines(const std::string&);
 [[nodiscard]] bool is_letter(const char&);
-[[nodiscard]] std::string check_filename(const std::string&);
 [[nodiscard]] bool file_exists(std::string_view);
 [[nodiscard]] std::optional<Response> shell_exec(std::string);
 [[nodiscard]] std::vector<std::string> split_by(const std::string&, const char);
-[[nodiscard]] int first_non_whitespace(const std::string&);
+[[nodiscard]] int first_non_whitespace(std::string_view);
 
 #endif  // TEXT_IO_H
@@ -0,0 +1,467 @@
+#include "undo_log.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <tuple>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+#include "save.h"
+
+// Record layout, numbers as LEB128 varints:
+//   op (1 byte) | parent state | time | line | char | hunk count | hunks
+// and each hunk:
+//   first line | before count | after count | lines before | lines after
+// with every line its size and then its text. Record n makes state n, so the
+// tree can be built again by reading the records in order
+//
+// On disk the log follows a header of the magic, then as u64s the hash of the
+// file it leads up to, the size of the log, the state the file was in and the
+// number of records. The header is zeroed while the log is being rewritten,
+// so a file that was cut short is never reloaded
+static const std::string_view UNDO_MAGIC = "IRISUND2";
+static const std::size_t HEADER_SIZE = 40;
+
+template <typename T>
+static void put(std::string& out, const T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+[[nodiscard]] static T get(std::string_view data, const std::size_t pos) {
+    T value;
+    std::memcpy(&value, data.data() + pos, sizeof(T));
+    return value;
+}
+
+static void put_varint(std::string& out, std::size_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+[[nodiscard]] static std::size_t get_varint(std::string_view data, std::size_t& pos) {
+    std::size_t value = 0;
+    for (unsigned int shift = 0; pos < data.size(); shift += 7) {
+        const auto byte = static_cast<unsigned char>(data[pos++]);
+        value |= std::size_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) { return value; }
+    }
+
+    throw std::out_of_range("UndoLog: record cut short");
+}
+
+static void put_lines(std::string& out, const std::vector<std::string>& lines) {
+    for (const std::string& line : lines) {
+        put_varint(out, line.size());
+        out.append(line);
+    }
+}
+
+// Skip over `count` lines starting at `pos`
+static void skip_lines(std::string_view data, std::size_t& pos, const std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+        pos += get_varint(data, pos);
+    }
+}
+
+// Read the start of the record at `pos` into `node`, leaving `pos` at its
+// hunk count
+static void read_node(std::string_view data, std::size_t& pos, UndoNode& node) {
+    if (pos >= data.size() || data[pos] != static_cast<char>(UndoOp::Lines)) {
+        throw std::out_of_range("UndoLog: not a record");
+    }
+
+    node.offset = pos++;
+    node.parent = get_varint(data, pos);
+    node.time = int64_t(get_varint(data, pos));
+    std::ignore = get_varint(data, pos);
+    std::ignore = get_varint(data, pos);
+}
+
+// Where the record starting at `pos` ends, by walking over its hunks
+[[nodiscard]] static std::size_t record_end(std::string_view data, std::size_t pos) {
+    UndoNode node = {};
+    read_node(data, pos, node);
+    const std::size_t count = get_varint(data, pos);
+
+    for (std::size_t i = 0; i < count; i++) {
+        std::ignore = get_varint(data, pos);
+        const std::size_t before_count = get_varint(data, pos);
+        const std::size_t after_count = get_varint(data, pos);
+        skip_lines(data, pos, before_count + after_count);
+    }
+
+    return pos;
+}
+
+[[nodiscard]] static std::string make_header(
+    const uint64_t hash,
+    const std::size_t size,
+    const std::size_t current,
+    const std::size_t count) {
+    std::string header(UNDO_MAGIC);
+    put(header, hash);
+    put(header, uint64_t(size));
+    put(header, uint64_t(current));
+    put(header, uint64_t(count));
+    return header;
+}
+
+[[nodiscard]] static int open_log(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+    return open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+}
+
+[[nodiscard]] static bool write_at(const int fd, std::string_view data, const std::size_t pos) {
+    if (lseek(fd, off_t(pos), SEEK_SET) == -1) { return false; }
+    return write_fully(fd, data.data(), data.size());
+}
+
+[[nodiscard]] static bool read_at(const int fd, char* out, std::size_t len, std::size_t pos) {
+    while (len) {
+        const ssize_t got = pread(fd, out, len, off_t(pos));
+        if (got <= 0) { return false; }
+
+        out += got;
+        len -= std::size_t(got);
+        pos += std::size_t(got);
+    }
+
+    return true;
+}
+
+// Add a record for `change`, made at `time` to the current state, and make
+// the state it leads to current. Returns that state
+[[nodiscard]] std::size_t UndoLog::append(const Change& change, const int64_t time) {
+    const std::size_t seq = nodes.size();
+    const UndoNode node = {spilled + bytes.size(), current, 0, depth() + 1, time};
+
+    bytes.push_back(static_cast<char>(UndoOp::Lines));
+    put_varint(bytes, current);
+    put_varint(bytes, std::size_t(std::max(time, int64_t(0))));
+    put_varint(bytes, change.line_pos);
+    put_varint(bytes, change.char_pos);
+    put_varint(bytes, change.hunks.size());
+
+    for (const Hunk& hunk : change.hunks) {
+        put_varint(bytes, hunk.first);
+        put_varint(bytes, hunk.before.size());
+        put_varint(bytes, hunk.after.size());
+        put_lines(bytes, hunk.before);
+        put_lines(bytes, hunk.after);
+    }
+
+    // The buffer before any change counts as being from just before the first
+    if (seq == 1) { nodes.front().time = time; }
+    nodes.at(current).child = seq;
+    nodes.push_back(node);
+    current = seq;
+
+    spill();
+    return seq;
+}
+
+// How many changes have been made, on every branch
+[[nodiscard]] std::size_t UndoLog::size() const {
+    return nodes.size() - 1;
+}
+
+// How many changes the current state is from the buffer as it started
+[[nodiscard]] std::size_t UndoLog::depth() const {
+    return nodes.at(current).depth;
+}
+
+[[nodiscard]] bool UndoLog::can_undo() const {
+    return current != 0;
+}
+
+[[nodiscard]] bool UndoLog::can_redo() const {
+    return nodes.at(current).child != 0;
+}
+
+[[nodiscard]] std::optional<UndoStep> UndoLog::undo_step() const {
+    if (!can_undo()) { return std::nullopt; }
+    return UndoStep {current, true};
+}
+
+[[nodiscard]] std::optional<UndoStep> UndoLog::redo_step() const {
+    if (!can_redo()) { return std::nullopt; }
+    return UndoStep {nodes.at(current).child, false};
+}
+
+// The buffer has been taken through `step`. Redo from the state it came from
+// now goes back the same way
+void UndoLog::step(const UndoStep& step) {
+    const std::size_t parent = nodes.at(step.seq).parent;
+    nodes.at(parent).child = step.seq;
+    current = step.undo ? parent : step.seq;
+}
+
+// The steps from state `from` to state `to`: undoing back to where their
+// branches meet, then redoing down the other one
+[[nodiscard]] std::vector<UndoStep> UndoLog::route(std::size_t from, std::size_t to) const {
+    std::vector<UndoStep> ret = {};
+    std::vector<UndoStep> down = {};
+
+    while (from != to) {
+        if (nodes.at(from).depth >= nodes.at(to).depth) {
+            ret.push_back({from, true});
+            from = nodes.at(from).parent;
+        } else {
+            down.push_back({to, false});
+            to = nodes.at(to).parent;
+        }
+    }
+
+    ret.insert(ret.end(), down.rbegin(), down.rend());
+    return ret;
+}
+
+// The last state made at or before `time`, or the buffer as it started
+[[nodiscard]] std::size_t UndoLog::state_at(const int64_t time) const {
+    const auto found = std::partition_point(
+        nodes.begin() + 1, nodes.end(), [time](const UndoNode& node) { return node.time <= time; });
+    return std::size_t(found - nodes.begin()) - 1;
+}
+
+// The state `amount` changes on from the current one, or with `seconds` set
+// the last one made by `amount` seconds on. Negative goes back. Either way
+// states are taken in the order they were made, whichever branch they're on
+[[nodiscard]] std::size_t UndoLog::travel(const int64_t amount, const bool seconds) const {
+    if (seconds) { return state_at(nodes.at(current).time + amount); }
+
+    const int64_t target = int64_t(current) + amount;
+    return std::size_t(std::clamp(target, int64_t(0), int64_t(size())));
+}
+
+// The record that made state `seq`, read back from the file if it was
+// spilled. Empty if it couldn't be.
+// NOTE: Only valid until this is next called, or the log is added to
+[[nodiscard]] std::string_view UndoLog::record(const std::size_t seq) const {
+    if (seq == 0 || seq >= nodes.size()) { throw std::out_of_range("UndoLog::record"); }
+
+    const std::size_t start = nodes.at(seq).offset;
+    const std::size_t end =
+        seq + 1 < nodes.size() ? nodes.at(seq + 1).offset : spilled + bytes.size();
+    if (start >= spilled) { return std::string_view(bytes).substr(start - spilled, end - start); }
+
+    loaded.assign(end - start, '\0');
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    const bool ok = fd != -1 && read_at(fd, loaded.data(), loaded.size(), HEADER_SIZE + start);
+    if (fd != -1) { close(fd); }
+
+    if (!ok) { return {}; }
+    return loaded;
+}
+
+// The hunks of `record`, in the order they were made.
+// NOTE: Only valid until this is next called
+[[nodiscard]] std::span<const LoggedHunk> UndoLog::hunks(std::string_view record) const {
+    std::size_t pos = 0;
+    UndoNode node = {};
+    read_node(record, pos, node);
+    const std::size_t count = get_varint(record, pos);
+
+    scratch.clear();
+    for (std::size_t i = 0; i < count; i++) {
+        LoggedHunk hunk = {};
+        hunk.first = get_varint(record, pos);
+        hunk.before_count = get_varint(record, pos);
+        hunk.after_count = get_varint(record, pos);
+        hunk.before = pos;
+        skip_lines(record, pos, hunk.before_count);
+        hunk.after = pos;
+        skip_lines(record, pos, hunk.after_count);
+        scratch.push_back(hunk);
+    }
+
+    return scratch;
+}
+
+// Copy `count` lines out of `record`, starting at `pos`
+[[nodiscard]] std::vector<std::string> UndoLog::lines(
+    std::string_view record,
+    std::size_t pos,
+    const std::size_t count) const {
+    std::vector<std::string> ret = {};
+    ret.reserve(count);
+
+    for (std::size_t i = 0; i < count; i++) {
+        const std::size_t size = get_varint(record, pos);
+        ret.emplace_back(record.substr(pos, size));
+        pos += size;
+    }
+
+    return ret;
+}
+
+// Load the log kept at `log_path`, if it's the history of a file whose
+// contents hash to `hash`. Either way, that's where it's kept from now on.
+// Every record is walked to build the tree again, but only the newest are
+// kept in memory, as with `spill`
+[[nodiscard]] bool UndoLog::restore(const std::string& log_path, const uint64_t hash) {
+    path = log_path;
+
+    const MappedFile mapping(path);
+    const std::string_view data = mapping.view();
+    if (data.size() < HEADER_SIZE || data.substr(0, UNDO_MAGIC.size()) != UNDO_MAGIC) {
+        return false;
+    }
+
+    const std::size_t size = get<uint64_t>(data, 16);
+    const std::size_t at = get<uint64_t>(data, 24);
+    if (get<uint64_t>(data, 8) != hash || HEADER_SIZE + size > data.size()) { return false; }
+
+    const std::string_view log = data.substr(HEADER_SIZE, size);
+    std::vector<UndoNode> found = {UndoNode {}};
+    found.reserve(get<uint64_t>(data, 32) + 1);
+
+    try {
+        for (std::size_t pos = 0; pos < log.size(); pos = record_end(log, pos)) {
+            std::size_t start = pos;
+            UndoNode node = {};
+            read_node(log, start, node);
+            if (node.parent >= found.size()) { return false; }
+
+            node.depth = found.at(node.parent).depth + 1;
+            found.at(node.parent).child = found.size();
+            found.push_back(node);
+        }
+    } catch (const std::out_of_range&) { return false; }
+
+    if (at >= found.size()) { return false; }
+    if (found.size() > 1) { found.front().time = found.at(1).time; }
+
+    const auto first = std::partition_point(
+        found.begin() + 1, found.end(),
+        [&](const UndoNode& node) { return size - node.offset > budget / 2; });
+    const std::size_t start = first == found.end() ? size : first->offset;
+
+    bytes = std::string(log.substr(start));
+    nodes = std::move(found);
+    current = at;
+    clean = at;
+    spilled = start;
+    kept = size;
+    return true;
+}
+
+// Write the whole log out to `log_path`, as the history of a file whose
+// contents hash to `hash`, and keep it there from now on
+[[nodiscard]] bool UndoLog::persist(const std::string& log_path, const uint64_t hash) {
+    if (log_path.empty()) { return false; }
+
+    // The spilled records have to come along if it's moving
+    std::string head = "";
+    if (log_path != path && spilled) {
+        head.resize(spilled);
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        const bool ok = fd != -1 && read_at(fd, head.data(), head.size(), HEADER_SIZE);
+        if (fd != -1) { close(fd); }
+        if (!ok) { return false; }
+    }
+
+    // Whatever the file already holds needn't be written again
+    const std::size_t same =
+        log_path == path ? std::min(bytes.size(), kept - std::min(kept, spilled)) : 0;
+    const std::string_view tail = std::string_view(bytes).substr(same);
+    const std::size_t size = spilled + bytes.size();
+
+    const int fd = open_log(log_path);
+    if (fd == -1) { return false; }
+
+    const bool ok = write_at(fd, std::string(HEADER_SIZE, '\0'), 0) &&
+                    write_at(fd, head, HEADER_SIZE) &&
+                    write_at(fd, tail, HEADER_SIZE + spilled + same) &&
+                    ftruncate(fd, off_t(HEADER_SIZE + size)) == 0 && fdatasync(fd) == 0 &&
+                    write_at(fd, make_header(hash, size, current, this->size()), 0);
+    close(fd);
+    if (!ok) { return false; }
+
+    path = log_path;
+    kept = size;
+    return true;
+}
+
+// Move the oldest records out to `path` once the log in memory is bigger than
+// `budget`, until it's back under half of it. `record` reads them back if
+// they're ever needed again
+void UndoLog::spill() {
+    if (path.empty() || held || bytes.size() <= budget) { return; }
+
+    const std::size_t end = spilled + bytes.size();
+    const auto first = std::partition_point(
+        nodes.begin() + 1, nodes.end(),
+        [&](const UndoNode& node) { return end - node.offset > budget / 2; });
+    const std::size_t size = (first == nodes.end() ? end : first->offset) - spilled;
+
+    // Only what the file doesn't already hold is written. Records are only
+    // ever added, so a log saved there before stays valid, but one left by
+    // some other version of the file mustn't be reloaded once it's written over
+    const std::size_t same = std::min(size, kept - std::min(kept, spilled));
+    if (same < size) {
+        const int fd = open_log(path);
+        if (fd == -1) { return; }
+
+        const std::string_view moved = std::string_view(bytes).substr(same, size - same);
+        const bool ok = (kept || write_at(fd, std::string(HEADER_SIZE, '\0'), 0)) &&
+                        write_at(fd, moved, HEADER_SIZE + spilled + same);
+        close(fd);
+        if (!ok) { return; }
+    }
+
+    bytes.erase(0, size);
+    spilled += size;
+    kept = std::max(kept, spilled);
+}
+
+// Where the undo history of `filename` is kept, under $XDG_STATE_HOME named
+// after the file's full path. Empty if there's nowhere to keep it
+[[nodiscard]] std::string undo_path(const std::string& filename) {
+    namespace fs = std::filesystem;
+
+    fs::path dir = "";
+    if (const char* state = std::getenv("XDG_STATE_HOME"); state != nullptr && *state) {
+        dir = state;
+    } else if (const char* home = std::getenv("HOME"); home != nullptr && *home) {
+        dir = fs::path(home) / ".local" / "state";
+    } else {
+        return "";
+    }
+
+    std::error_code ec;
+    std::string name = fs::absolute(filename, ec).lexically_normal().string();
+    if (ec) { return ""; }
+    std::replace(name.begin(), name.end(), '/', '%');
+
+    return (dir / "iris" / "undo" / name).string();
+}
+
+// 64-bit FNV-1a, enough to tell if a file is the one a log was kept for. Data
+// read in parts is hashed by passing the hash of the parts before it along
+[[nodiscard]] uint64_t content_hash(std::string_view data, uint64_t hash) {
+    for (const char c : data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+[[nodiscard]] std::optional<uint64_t> file_hash(const std::string& filename) {
+    if (!file_stamp(filename).has_value()) { return {}; }
+
+    const MappedFile mapping(filename);
+    return content_hash(mapping.view());
+}
@@ -0,0 +1,98 @@
+#ifndef UNDO_LOG_H
+#define UNDO_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "change.h"
+#include "constants.h"
+
+enum class UndoOp : char { Lines = 'L' };
+
+// Where a hunk of a record is in the record. `before` and `after` are the
+// offsets its two sets of lines start at
+struct LoggedHunk {
+    std::size_t first = 0;
+    std::size_t before_count = 0;
+    std::size_t after_count = 0;
+    std::size_t before = 0;
+    std::size_t after = 0;
+};
+
+// One state of the buffer, reached by making the change in record `offset`
+// to its parent. `child` is the state redo goes to, the last one made or
+// undone from here
+struct UndoNode {
+    std::size_t offset = 0;
+    std::size_t parent = 0;
+    std::size_t child = 0;
+    std::size_t depth = 0;
+    int64_t time = 0;  // When it was made, in seconds
+};
+
+// Going from one state to the next: undoing the change that made state
+// `seq`, or redoing it
+struct UndoStep {
+    std::size_t seq = 0;
+    bool undo = false;
+
+    [[nodiscard]] bool operator==(const UndoStep&) const = default;
+};
+
+// Every change made to a buffer, one variable length record after another in
+// a single growing string rather than an allocation per edit. Nothing is ever
+// dropped, a change made after an undo starts a new branch of the tree of
+// states in `nodes`, so any state the buffer has been in can be gone back to
+struct UndoLog {
+    std::string bytes = "";
+    std::vector<UndoNode> nodes = {UndoNode {}};  // The buffer before any change, then each one
+    std::size_t current = 0;                      // The state the buffer is in
+    std::size_t clean = 0;                        // The state the buffer was last saved in
+
+    // Reused by every `hunks()` so stepping through the log doesn't allocate
+    mutable std::vector<LoggedHunk> scratch = {};
+    mutable std::string loaded = "";  // The last record read back from the file
+
+    // Where the log is kept between sessions, and where its oldest records
+    // go once it's bigger than `budget`. Without one it all stays in memory
+    std::string path = "";
+    std::size_t budget = UNDO_MEMORY_BUDGET;
+    std::size_t spilled = 0;  // Bytes of the log before `bytes`, only in the file
+    std::size_t kept = 0;     // Bytes at the start of the file that match the log
+    bool held = false;        // A copy is being persisted to the file, so nothing is spilled
+
+    [[nodiscard]] std::size_t append(const Change&, const int64_t);
+    [[nodiscard]] std::size_t size() const;
+    [[nodiscard]] std::size_t depth() const;
+    [[nodiscard]] bool can_undo() const;
+    [[nodiscard]] bool can_redo() const;
+    [[nodiscard]] std::optional<UndoStep> undo_step() const;
+    [[nodiscard]] std::optional<UndoStep> redo_step() const;
+    void step(const UndoStep&);
+    [[nodiscard]] std::vector<UndoStep> route(std::size_t, std::size_t) const;
+    [[nodiscard]] std::size_t state_at(const int64_t) const;
+    [[nodiscard]] std::size_t travel(const int64_t, const bool) const;
+
+    [[nodiscard]] std::string_view record(const std::size_t) const;
+    [[nodiscard]] std::span<const LoggedHunk> hunks(std::string_view) const;
+    [[nodiscard]] std::vector<std::string> lines(std::string_view, std::size_t, const std::size_t)
+        const;
+
+    [[nodiscard]] bool restore(const std::string&, const uint64_t);
+    [[nodiscard]] bool persist(const std::string&, const uint64_t);
+    void spill();
+};
+
+// Where `content_hash` starts from
+const uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+
+[[nodiscard]] std::string undo_path(const std::string&);
+[[nodiscard]] uint64_t content_hash(std::string_view, uint64_t = FNV_OFFSET_BASIS);
+[[nodiscard]] std::optional<uint64_t> file_hash(const std::string&);
+
+#endif  // UNDO_LOG_H
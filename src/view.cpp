@@ -19,7 +19,6 @@
 
 #include "constants.h"
 #include "controller.h"
-#include "enumerate.h"
 #include "text_io.h"
 
 View::View(Controller* controller, const rawterm::Pos dims)
@@ -28,16 +27,16 @@ View::View(Controller* controller, const rawterm::Pos dims)
     prev_tab_bar.reserve(uint_t(dims.horizontal));
 }
 
-void View::add_model(Model* m) {
-    view_models.push_back(m);
+void View::add_model(const ModelHandle handle) {
+    view_models.push_back(handle);
     active_model = view_models.size() - 1;
-    set_lineno_offset(m);
+    set_lineno_offset(get_active_model());
 
     // Set visual offset
 }
 
 Model* View::get_active_model() const {
-    return view_models.at(active_model);
+    return ctrlr_ptr->models.get(view_models.at(active_model));
 }
 
 void View::draw_screen() {
@@ -78,9 +77,9 @@ void View::draw_screen() {
     if (view_models.size() > 1) { screen += render_tab_bar(); }
 
     // Get displayable subrange
-    std::size_t end = std::min(std::size_t(view_size.vertical - 2), get_active_model()->buf.size());
-    auto viewable_range = get_active_model()->buf |
-                          std::views::drop(get_active_model()->view_offset) | std::views::take(end);
+    const Model* const model = get_active_model();
+    std::size_t end = std::min(std::size_t(view_size.vertical - 2), model->line_count());
+    const std::size_t last_idx = std::min(model->view_offset + end, model->line_count());
 
     // Viewable length for truncating - moved out of loop to prevent recalculating each time
     const uint_t viewable_hor_len = static_cast<unsigned int>(
@@ -88,7 +87,12 @@ void View::draw_screen() {
 
     const std::size_t start_idx = get_active_model()->view_offset + 1;
     const std::size_t vert_offset = get_active_model()->vertical_offset;
-    for (const auto& [idx, line] : enumerate<std::string>(viewable_range, start_idx)) {
+    for (std::size_t idx = start_idx; idx <= last_idx; idx++) {
+        // NOTE: Only the lines on screen are read, so paged buffers never
+        // have to load anything outside the viewport
+        const DrawnLine line =
+            draw_columns(model->line_parts(idx - 1), vert_offset, viewable_hor_len);
+
         if (LINE_NUMBERS) {
             rawterm::Color c = COLOR_UI_BG;
             if (get_active_model()->is_marked(idx - 1)) { c = COLOR_GREEN; }
@@ -98,27 +102,27 @@ void View::draw_screen() {
                 rawterm::set_foreground(std::format("{:>{}}\u2502", idx, line_number_offset), c);
         }
 
-        if (line.empty() || (vert_offset && line.size() < vert_offset)) {
+        if (!line.width || (vert_offset && line.width < vert_offset)) {
             screen += "\r\n";
             continue;
         }
 
         if (vert_offset) { screen += "\u00AB"; }
 
-        if (line.size() > viewable_hor_len) {
+        if (line.width > viewable_hor_len) {
             const std::size_t draw_len = viewable_hor_len - 2 - (vert_offset ? 1 : 0);
-            screen += line.substr(vert_offset, draw_len);
+            screen += line.text.substr(0, draw_len);
 
-            if (line.size() > draw_len + vert_offset + 3) { screen += "\u00BB"; }
+            if (line.width > draw_len + vert_offset + 3) { screen += "\u00BB"; }
         } else {
-            screen += line.substr(vert_offset, line.size());
+            screen += line.text;
         };
 
         screen += "\r\n";
     }
 
     // Set 1 line number if no text in the buffer
-    if (LINE_NUMBERS && !(get_active_model()->buf.size())) {
+    if (LINE_NUMBERS && !(get_active_model()->line_count())) {
         screen += rawterm::set_foreground(
                       std::format("{:>{}}\u2502", 1, line_number_offset), COLOR_UI_BG) +
                   "\n";
@@ -154,8 +158,8 @@ const std::string View::render_tab_bar() const {
     std::vector<std::string> base_filenames;
     std::size_t filename_max_length = 0;
 
-    for (const auto& model : view_models) {
-        std::string full_path = model->filename;
+    for (const auto& handle : view_models) {
+        std::string full_path = ctrlr_ptr->models.get(handle)->filename;
         std::size_t last_slash = full_path.find_last_of("/\\");
         std::string filename =
             (last_slash != std::string::npos) ? full_path.substr(last_slash + 1) : full_path;
@@ -177,7 +181,7 @@ const std::string View::render_tab_bar() const {
                 display_name = display_name.substr(0, filename_max_length);
             }
 
-            if (view_models.at(i)->unsaved) { display_name += "*"; }
+            if (ctrlr_ptr->models.get(view_models.at(i))->unsaved) { display_name += "*"; }
 
             if (i == active_model) {
                 ret += rawterm::inverse(display_name);
@@ -226,7 +230,9 @@ void View::draw_line(const Draw_Line_dir::values redraw_prev) {
     const uint_t viewable_hor_len = static_cast<unsigned int>(
         view_size.horizontal - int(LINE_NUMBERS ? line_number_offset + 1 : 0));
 
-    std::string_view curr_line = get_active_model()->buf.at(idx);
+    const std::size_t vert_offset = get_active_model()->vertical_offset;
+    const DrawnLine curr_line =
+        draw_columns(get_active_model()->line_parts(idx), vert_offset, viewable_hor_len);
 
     if (LINE_NUMBERS) {
         // TODO: refactor lineno colour into it's own view method
@@ -238,20 +244,19 @@ void View::draw_line(const Draw_Line_dir::values redraw_prev) {
             rawterm::set_foreground(std::format("{:>{}}\u2502", idx + 1, line_number_offset), c);
     }
 
-    const std::size_t vert_offset = get_active_model()->vertical_offset;
-    if (curr_line.empty() || (vert_offset && curr_line.size() < vert_offset)) { return line; }
+    if (!curr_line.width || (vert_offset && curr_line.width < vert_offset)) { return line; }
 
     // Truncate
-    if (curr_line.size() > viewable_hor_len) {
+    if (curr_line.width > viewable_hor_len) {
         if (vert_offset) { line += "\u00AB"; }
 
         const std::size_t draw_len = viewable_hor_len - 2 - (vert_offset ? 1 : 0);
-        line += curr_line.substr(vert_offset, draw_len);
+        line += curr_line.text.substr(0, draw_len);
 
-        if (curr_line.size() > draw_len + vert_offset + 2) { line += "\u00BB"; }
+        if (curr_line.width > draw_len + vert_offset + 2) { line += "\u00BB"; }
 
     } else {
-        line += curr_line.substr(vert_offset, curr_line.size());
+        line += curr_line.text;
     }
 
     return line;
@@ -268,7 +273,7 @@ void View::draw_status_bar() {
 
 const std::string View::render_status_bar() const {
     const std::size_t thirds = std::size_t(view_size.horizontal / 3);
-    std::string filename = view_models.at(active_model)->filename;
+    std::string filename = get_active_model()->filename;
 
     // left = mode | (git branch) | status
     // center = file name
@@ -283,6 +288,10 @@ const std::string View::render_status_bar() const {
         left += " | [X]";
     }
 
+    if (get_active_model()->loading()) {
+        left += std::format(" | Loading {}%", get_active_model()->load_progress());
+    }
+
     if (!(git_branch.empty()) && left.size() + git_branch.size() < thirds - 2) {
         left += std::string(" | ") + git_branch;
     }
@@ -359,13 +368,11 @@ void View::display_message(std::string msg, std::optional<rawterm::Color> color)
 // crashes that were down to the offset being wrong after editing text (I think)
 [[nodiscard]] std::size_t View::clamp_horizontal_movement(const int offset) {
     const int line_pos = static_cast<int>(get_active_model()->current_line) + offset;
-    if (line_pos < 0 || line_pos > int32_t(get_active_model()->buf.size())) { return 0; }
-
-    std::string_view line_moving_to =
-        get_active_model()->buf.at(static_cast<std::size_t>(line_pos));
+    if (line_pos < 0 || line_pos > int32_t(get_active_model()->line_count())) { return 0; }
 
-    if (line_moving_to.size() < get_active_model()->current_char) {
-        return get_active_model()->current_char - line_moving_to.size();
+    const std::size_t size = get_active_model()->line_size(static_cast<std::size_t>(line_pos));
+    if (size < get_active_model()->current_char) {
+        return get_active_model()->current_char - size;
     }
 
     return 0;
@@ -373,15 +380,22 @@ void View::display_message(std::string msg, std::optional<rawterm::Color> color)
 
 // Returns: (bool) Redraw whole screen
 [[maybe_unused]] bool View::cursor_left(std::size_t dist) {
-    if (get_active_model()->vertical_offset &&
+    Model* const model = get_active_model();
+    const std::size_t cols = (dist == 0 || model->current_char < dist)
+                                 ? dist
+                                 : model->display_col(model->current_line, model->current_char) -
+                                       model->display_col(
+                                           model->current_line, model->current_char - dist);
+
+    if (model->vertical_offset &&
         uint_t(cur.horizontal) == (LINE_NUMBERS ? line_number_offset + 3 : 0)) {
-        get_active_model()->current_char -= uint_t(dist);
-        if (get_active_model()->vertical_offset == 2) { get_active_model()->vertical_offset--; }
-        get_active_model()->vertical_offset -= dist;
+        model->current_char -= uint_t(dist);
+        if (model->vertical_offset == 2) { model->vertical_offset--; }
+        model->vertical_offset -= cols;
         return true;
-    } else if (get_active_model()->current_char) {
-        get_active_model()->current_char -= uint_t(dist);
-        cur.move_left(int32_t(dist));
+    } else if (model->current_char) {
+        model->current_char -= uint_t(dist);
+        cur.move_left(int32_t(cols));
         return false;
     }
 
@@ -408,6 +422,7 @@ void View::display_message(std::string msg, std::optional<rawterm::Color> color)
         }
     }
 
+    align_tab_column(get_active_model()->current_line + count);
     cursor_left(horizontal_clamp);
 
     return redraw_sentinal;
@@ -415,7 +430,7 @@ void View::display_message(std::string msg, std::optional<rawterm::Color> color)
 
 [[maybe_unused]] bool View::cursor_down(unsigned int count) {
     // If we're on the last line, do nothing
-    if (get_active_model()->current_line >= get_active_model()->buf.size() - 1) { return false; }
+    if (get_active_model()->current_line >= get_active_model()->line_count() - 1) { return false; }
 
     std::size_t horizontal_clamp = clamp_horizontal_movement(int32_t(count));
     get_active_model()->current_line += count;
@@ -436,51 +451,61 @@ void View::display_message(std::string msg, std::optional<rawterm::Color> color)
         }
     }
 
+    align_tab_column(get_active_model()->current_line - count);
     cursor_left(horizontal_clamp);
     return redraw_sentinal;
 }
 
+// Lines with different tabs draw the same char index at different columns,
+// so nudge the cursor to match after moving from `prev_line`
+void View::align_tab_column(const std::size_t prev_line) {
+    const Model* const model = get_active_model();
+    if (!model->lineno_in_scope(int32_t(model->current_line))) { return; }
+
+    const auto prev_col = int32_t(model->display_col(prev_line, model->current_char));
+    const auto new_col = int32_t(model->display_col(model->current_line, model->current_char));
+    cur.move(cur.vertical, cur.horizontal + new_col - prev_col);
+}
+
 // Return if we need to redraw after the cursor is moved
 [[maybe_unused]] bool View::cursor_right(std::size_t dist) {
     // Only scroll if we're still in the line
-    std::string_view curr_line = get_active_model()->buf.at(get_active_model()->current_line);
-    const std::size_t line_size = curr_line.size();
+    const std::size_t line_size = get_active_model()->line_size(get_active_model()->current_line);
     if (get_active_model()->current_char == line_size) { return false; }
 
     // Clamp dist to line
     dist = std::min(dist, line_size - get_active_model()->current_char);
     if (dist == 0) { return false; }
+
+    const std::size_t cols =
+        get_active_model()->display_col(
+            get_active_model()->current_line, get_active_model()->current_char + dist) -
+        get_active_model()->display_col(
+            get_active_model()->current_line, get_active_model()->current_char);
     get_active_model()->current_char += uint_t(dist);
 
     if (cur.horizontal < view_size.horizontal - 2) {
-        cur.move_right(int32_t(dist));
+        cur.move_right(int32_t(cols));
         return false;
     } else {
         if (!get_active_model()->vertical_offset) { get_active_model()->vertical_offset++; }
-        get_active_model()->vertical_offset += dist;
+        get_active_model()->vertical_offset += cols;
         return true;
     }
 }
 
 void View::cursor_end_of_line() {
-    std::size_t line_len = get_active_model()->buf.at(get_active_model()->current_line).size();
+    std::size_t line_len = get_active_model()->line_size(get_active_model()->current_line);
     std::size_t curr_pos = get_active_model()->current_char;
     cursor_right(line_len - curr_pos);
 }
 
 void View::cursor_start_of_line() {
-    const std::string& cur_line = get_active_model()->buf.at(get_active_model()->current_line);
-
-    if (!(cur_line.empty())) {
-        auto it = std::find_if(
-            cur_line.begin(), cur_line.end(), [](char c) { return !(std::isspace(c)); });
+    const LineRef cur_line = get_active_model()->line_ref(get_active_model()->current_line);
+    if (cur_line.blank()) { return; }
 
-        if (it != cur_line.end()) {
-            const auto dist = std::distance(cur_line.begin(), it);
-            const long cursor_distance = get_active_model()->current_char - dist;
-            cursor_left(uint_t(cursor_distance));
-        }
-    }
+    const long cursor_distance = get_active_model()->current_char - long(cur_line.indent());
+    cursor_left(uint_t(cursor_distance));
 }
 
 void View::center_current_line() {
@@ -488,21 +513,22 @@ void View::center_current_line() {
 }
 
 void View::set_current_line(const unsigned int lineno) {
-    if (lineno > get_active_model()->buf.size()) { return; }
+    if (lineno > get_active_model()->line_count() && get_active_model()->loading()) {
+        get_active_model()->wait_for_load();
+        set_lineno_offset(get_active_model());
+    }
+    if (lineno > get_active_model()->line_count()) { return; }
 
     get_active_model()->current_line = lineno - 1;
     uint_t half_view = static_cast<uint_t>(std::floor(view_size.vertical / 2));
-    std::size_t curr_char = get_active_model()->current_char + line_number_offset + 2;
-    if (get_active_model()->vertical_offset) {
-        curr_char -= (get_active_model()->vertical_offset - 1);
-    }
+    const int curr_char = screen_column();
 
     if (lineno <= half_view) {
         get_active_model()->view_offset = 0;
-        cur.move({static_cast<int>(lineno + visible_tab_bar()), int32_t(curr_char)});
+        cur.move({static_cast<int>(lineno + visible_tab_bar()), curr_char});
     } else {
         get_active_model()->view_offset = lineno - half_view - 1;
-        cur.move({static_cast<int>(half_view + 1 + visible_tab_bar()), int32_t(curr_char)});
+        cur.move({static_cast<int>(half_view + 1 + visible_tab_bar()), curr_char});
     }
 }
 
@@ -512,8 +538,7 @@ void View::get_git_branch() {
 }
 
 void View::tab_new() {
-    ctrlr_ptr->models.emplace_back(view_size.vertical, "NO NAME");
-    add_model(&ctrlr_ptr->models.at(ctrlr_ptr->models.size() - 1));
+    add_model(ctrlr_ptr->models.emplace(view_size.vertical, "NO NAME"));
     cur.move(2, int(line_number_offset) + 2);
 }
 
@@ -545,7 +570,7 @@ void View::tab_prev() {
 
 [[maybe_unused]] uint_t View::set_lineno_offset(Model* m) {
     if (LINE_NUMBERS) {
-        line_number_offset = uint_t(std::to_string(m->buf.size()).size() + 1);
+        line_number_offset = uint_t(std::to_string(m->line_count()).size() + 1);
         return line_number_offset;
     }
 
@@ -555,18 +580,26 @@ void View::tab_prev() {
 void View::change_model_cursor() {
     const uint_t vertical =
         get_active_model()->current_line - get_active_model()->view_offset + visible_tab_bar() + 1;
-    std::size_t horizontal = get_active_model()->current_char + uint_t(line_number_offset) + 2;
-    if (get_active_model()->vertical_offset) {
-        horizontal -= get_active_model()->vertical_offset - 1;
-    }
+    cur.move(int(vertical), screen_column());
+}
+
+// The terminal column the cursor belongs in for the active model's position
+[[nodiscard]] int View::screen_column() const {
+    const Model* const model = get_active_model();
+    std::size_t horizontal = model->display_col(model->current_line, model->current_char) +
+                             uint_t(line_number_offset) + 2;
+    if (model->vertical_offset) { horizontal -= model->vertical_offset - 1; }
 
-    cur.move(int(vertical), int(horizontal));
+    return int(horizontal);
 }
 
-bool View::set_buffer(const std::size_t bufnr, const std::size_t model_len) {
-    if (bufnr >= model_len) { return false; }
+// Show buffer `bufnr` in the current tab. A buffer's number is the slot it's
+// kept in, so it doesn't change when others are closed
+bool View::set_buffer(const std::size_t bufnr) {
+    const std::optional<ModelHandle> handle = ctrlr_ptr->models.handle_at(bufnr);
+    if (!handle.has_value()) { return false; }
 
-    view_models.at(active_model) = &ctrlr_ptr->models.at(std::size_t(bufnr));
+    view_models.at(active_model) = handle.value();
     change_model_cursor();
     return true;
 }
@@ -588,7 +621,10 @@ void View::draw_overlay(std::span<std::string> contents, std::string_view title)
 
 [[nodiscard]] std::string View::render_cursor_coords() const {
     std::string ret = "";
-    const std::size_t curr_char = get_active_model()->current_char + 1;
+    const std::size_t curr_char =
+        get_active_model()->display_col(
+            get_active_model()->current_line, get_active_model()->current_char) +
+        1;
 
     if (curr_char >= LINE_BORDER) { ret += COLOR_ALERT; }
 
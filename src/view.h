@@ -12,8 +12,11 @@
 #include <rawterm/screen.h>
 
 #include "model.h"
+#include "slot_map.h"
 
 using uint_t = unsigned int;
+// A model kept by the controller
+using ModelHandle = SlotHandle;
 
 struct Controller;
 
@@ -26,8 +29,8 @@ namespace Draw_Line_dir {
 struct View {
     Controller* ctrlr_ptr;
     rawterm::Pos view_size;
-    std::vector<Model*> view_models = {};  // Indexes into controller.models
-    std::size_t active_model = 0;          // 0-indexed
+    std::vector<ModelHandle> view_models = {};  // Handles into controller.models
+    std::size_t active_model = 0;               // 0-indexed
     rawterm::Cursor cur;
     uint_t line_number_offset = 0;
     std::string command_text = ";";
@@ -36,7 +39,7 @@ struct View {
     bool overlay_open = false;
 
     View(Controller*, const rawterm::Pos);
-    void add_model(Model*);
+    void add_model(const ModelHandle);
     Model* get_active_model() const;
     void draw_screen();
     [[nodiscard]] const std::string render_screen() const;
@@ -53,6 +56,7 @@ struct View {
     [[maybe_unused]] bool cursor_up(unsigned int count = 1);
     [[maybe_unused]] bool cursor_down(unsigned int count = 1);
     [[maybe_unused]] bool cursor_right(std::size_t dist = 1);
+    void align_tab_column(const std::size_t);
     void cursor_end_of_line();
     void cursor_start_of_line();
     void center_current_line();
@@ -64,7 +68,8 @@ struct View {
     [[nodiscard]] uint_t visible_tab_bar() const;
     [[maybe_unused]] uint_t set_lineno_offset(Model*);
     void change_model_cursor();
-    bool set_buffer(const std::size_t, const std::size_t);
+    [[nodiscard]] int screen_column() const;
+    bool set_buffer(const std::size_t);
     void draw_overlay(std::span<std::string>, std::string_view);
     [[nodiscard]] std::string render_cursor_coords() const;
 };
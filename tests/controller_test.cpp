@@ -1,13 +1,18 @@
 #include "controller.h"
 
+#include <filesystem>
+#include <fstream>
+
 #include <catch2/catch_test_case_info.hpp>
 #include <catch2/catch_test_macros.hpp>
 
 #include "flags.h"
+#include "journal.h"
+#include "text_io.h"
 
 TEST_CASE("Construction", "[controller]") {
     Controller c;
-    REQUIRE(c.models.capacity() == 8);
+    REQUIRE(c.models.empty());
 }
 
 TEST_CASE("set_mode", "[controller]") {
@@ -35,7 +40,7 @@ TEST_CASE("create_view", "[controller]") {
         c.create_view(f);
 
         REQUIRE(c.models.size() == 1);
-        REQUIRE(*c.models.at(0).buf.at(0).begin() == 'T');
+        REQUIRE(*c.models.at(0).buf->at(0).begin() == 'T');
     }
 
     SECTION("Empty view") {
@@ -44,7 +49,7 @@ TEST_CASE("create_view", "[controller]") {
         c.create_view(f);
 
         REQUIRE(c.models.size() == 1);
-        REQUIRE(c.models.at(0).buf.size() == 1);
+        REQUIRE(c.models.at(0).buf->size() == 1);
     }
 
     SECTION("View with scroll offset") {
@@ -53,7 +58,7 @@ TEST_CASE("create_view", "[controller]") {
         c.create_view(f);
 
         REQUIRE(c.models.size() == 1);
-        REQUIRE(*c.models.at(0).buf.at(0).begin() == 'L');
+        REQUIRE(*c.models.at(0).buf->at(0).begin() == 'L');
     }
 
     SECTION("View set to read only") {
@@ -62,7 +67,7 @@ TEST_CASE("create_view", "[controller]") {
         c.create_view(f);
 
         REQUIRE(c.models.size() == 1);
-        REQUIRE(*c.models.at(0).buf.at(0).begin() == 'L');
+        REQUIRE(*c.models.at(0).buf->at(0).begin() == 'L');
         REQUIRE(c.models.at(0).readonly == true);
     }
 }
@@ -127,6 +132,32 @@ TEST_CASE("quit_app", "[controller]") {
         REQUIRE(c.quit_app(false));
         REQUIRE(!c.quit_flag);
     }
+
+    SECTION("Closing a tab frees its buffer") {
+        Controller c;
+        Flags f = {std::string("tests/fixture/test_file_1.txt")};
+        c.create_view(f);
+        c.view.tab_new();
+        const ModelHandle closed = c.view.view_models.at(c.view.active_model);
+
+        REQUIRE(c.quit_app(false));
+        REQUIRE_FALSE(c.models.contains(closed));
+        REQUIRE(c.models.size() == 1);
+        REQUIRE(c.view.get_active_model()->filename == "tests/fixture/test_file_1.txt");
+    }
+
+    SECTION("A buffer still shown in another tab is kept") {
+        Controller c;
+        Flags f = {std::string("tests/fixture/test_file_1.txt")};
+        c.create_view(f);
+        const ModelHandle shared = c.view.view_models.at(0);
+        c.view.view_models.push_back(shared);
+        c.view.active_model = 1;
+
+        REQUIRE(c.quit_app(false));
+        REQUIRE(c.models.contains(shared));
+        REQUIRE(c.models.size() == 1);
+    }
 }
 
 TEST_CASE("check_for_saved_file", "[controller]") {
@@ -170,6 +201,55 @@ TEST_CASE("write_all", "[controller]") {
     c.view.cursor_right(1);
     std::ignore = c.models.at(0).backspace();
     std::ignore = c.write_all();
+
+    SECTION("Failures are reported per file") {
+        c.models.at(1).filename = "tests/fixture/no_such_dir/file.txt";
+
+        const WriteAllData data = c.write_all();
+        REQUIRE(!data.valid);
+        REQUIRE(data.files == 1);
+        REQUIRE(data.failed == std::vector<std::string> {"tests/fixture/no_such_dir/file.txt"});
+    }
+}
+
+TEST_CASE("start_save_all", "[controller]") {
+    Controller c;
+    Flags f = {std::string("tests/fixture/test_file_1.txt")};
+    c.create_view(f);
+    c.view.tab_new();
+    c.models.at(1).filename = "tests/fixture/no_such_dir/file.txt";
+
+    c.view.command_text = ";wa";
+    std::ignore = c.parse_command();
+    REQUIRE(c.saving_all.size() == 2);
+
+    SECTION("Reported once every save has finished") {
+        // Still waiting for as long as the other save is running
+        c.models.at(0).saving->wait();
+        std::ignore = c.poll_background_saves();
+        REQUIRE(c.saving_all_result.has_value() == (c.models.at(1).saving != nullptr));
+
+        if (c.models.at(1).saving != nullptr) {
+            c.models.at(1).saving->wait();
+            REQUIRE(c.poll_background_saves());
+        }
+        REQUIRE(c.saving_all.empty());
+        REQUIRE(!c.saving_all_result.has_value());
+    }
+
+    SECTION("Failures are listed together") {
+        // Waited on elsewhere, as `;q` does
+        for (auto& m : c.models) {
+            std::ignore = poll_save(&m, true);
+        }
+
+        const std::optional<WriteAllData> data = c.take_save_all();
+        REQUIRE(data.has_value());
+        REQUIRE(!data.value().valid);
+        REQUIRE(data.value().files == 1);
+        REQUIRE(
+            data.value().failed == std::vector<std::string> {"tests/fixture/no_such_dir/file.txt"});
+    }
 }
 
 TEST_CASE("quit_all", "[controller]") {
@@ -214,3 +294,51 @@ TEST_CASE("display_all_buffers", "[controller]") {
     REQUIRE_FALSE(c.display_all_buffers());
     REQUIRE(c.view.overlay_open);
 }
+
+TEST_CASE("Recovering from a crash", "[controller]") {
+    namespace fs = std::filesystem;
+    const std::string filename = "tests/fixture/temp_journal_file.txt";
+    {
+        std::ofstream out(filename);
+        out << "foo\nbar\n";
+    }
+
+    // Left behind by a crash
+    {
+        auto crashed = Model({"foo", "bar"}, filename);
+        crashed.insert('x');
+        crashed.journal->sync();
+        fs::copy_file(journal_path(filename), filename + ".kept");
+    }
+    fs::rename(filename + ".kept", journal_path(filename));
+
+    Controller c;
+    c.create_view(Flags {filename});
+    c.offer_recovery();
+    Model* m = c.view.get_active_model();
+
+    // Nothing can be edited or saved until the crash's edits are dealt with
+    REQUIRE(m->journal_pending);
+    REQUIRE(c.is_readonly_model());
+    REQUIRE_FALSE(prepare_save(m, std::nullopt, false).has_value());
+    REQUIRE(c.write_all().files == 0);
+
+    SECTION("Recovered") {
+        c.view.command_text = ";recover";
+        REQUIRE(c.parse_command());
+        REQUIRE_FALSE(m->journal_pending);
+        REQUIRE(m->buf->at(0) == "xfoo");
+        REQUIRE_FALSE(c.is_readonly_model());
+    }
+
+    SECTION("Discarded") {
+        c.view.command_text = ";discard";
+        std::ignore = c.parse_command();
+        REQUIRE_FALSE(m->journal_pending);
+        REQUIRE(m->buf->at(0) == "foo");
+        REQUIRE(!fs::exists(journal_path(filename)));
+    }
+
+    fs::remove(journal_path(filename));
+    fs::remove(filename);
+}
@@ -0,0 +1,85 @@
+#include "dirty_lines.h"
+
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+    std::vector<std::size_t> all_set(const DirtyLines& dirty) {
+        std::vector<std::size_t> ret = {};
+        for (std::size_t i = dirty.next(0); i != std::string::npos; i = dirty.next(i + 1)) {
+            ret.push_back(i);
+        }
+        return ret;
+    }
+}  // namespace
+
+TEST_CASE("set", "[dirty_lines]") {
+    DirtyLines dirty = {};
+    REQUIRE(dirty.empty());
+    REQUIRE(!dirty.test(100));
+
+    dirty.set(3);
+    dirty.set(200);
+    REQUIRE(dirty.test(3));
+    REQUIRE(dirty.test(200));
+    REQUIRE(!dirty.test(4));
+    REQUIRE(!dirty.empty());
+    REQUIRE(all_set(dirty) == std::vector<std::size_t> {3, 200});
+
+    dirty.clear();
+    REQUIRE(dirty.empty());
+    REQUIRE(dirty.next(0) == std::string::npos);
+}
+
+TEST_CASE("insert", "[dirty_lines]") {
+    DirtyLines dirty = {};
+    dirty.set(1);
+    dirty.set(63);
+    dirty.set(64);
+
+    SECTION("Lines after it move down") {
+        dirty.insert(2);
+        REQUIRE(all_set(dirty) == std::vector<std::size_t> {1, 2, 64, 65});
+    }
+
+    SECTION("Before everything") {
+        dirty.insert(0);
+        REQUIRE(all_set(dirty) == std::vector<std::size_t> {0, 2, 64, 65});
+    }
+
+    SECTION("Past the end") {
+        dirty.insert(500);
+        REQUIRE(all_set(dirty) == std::vector<std::size_t> {1, 63, 64, 500});
+    }
+
+    SECTION("Top bit carries into a new word") {
+        dirty.set(127);
+        dirty.insert(0);
+        REQUIRE(all_set(dirty) == std::vector<std::size_t> {0, 2, 64, 65, 128});
+    }
+}
+
+TEST_CASE("erase", "[dirty_lines]") {
+    DirtyLines dirty = {};
+    dirty.set(1);
+    dirty.set(5);
+    dirty.set(64);
+    dirty.set(130);
+
+    SECTION("Lines after it move up") {
+        dirty.erase(3);
+        REQUIRE(all_set(dirty) == std::vector<std::size_t> {1, 4, 63, 129});
+    }
+
+    SECTION("Erasing a dirty line") {
+        dirty.erase(5);
+        REQUIRE(all_set(dirty) == std::vector<std::size_t> {1, 63, 129});
+    }
+
+    SECTION("Past the end") {
+        dirty.erase(1000);
+        REQUIRE(all_set(dirty) == std::vector<std::size_t> {1, 5, 64, 130});
+    }
+}
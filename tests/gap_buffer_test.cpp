@@ -0,0 +1,172 @@
+#include "gap_buffer.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("GapBuffer", "[gap_buffer]") {
+    SECTION("Gap starts at the end") {
+        GapBuffer buf({"foo", "bar"});
+        REQUIRE(buf.size() == 2);
+        REQUIRE(buf.gap_start == 2);
+
+        buf.insert(2, "baz");
+        REQUIRE(buf.slots.size() > 3);
+        REQUIRE(buf.at(2) == "baz");
+        REQUIRE_THROWS_AS(buf.at(3), std::out_of_range);
+    }
+
+    SECTION("Gap follows the edits") {
+        GapBuffer buf({"a", "b", "c", "d"});
+        buf.insert(1, "x");
+        REQUIRE(buf.gap_start == 2);
+
+        buf.insert(2, "y");
+        REQUIRE(buf.gap_start == 3);
+
+        buf.erase(0);
+        REQUIRE(buf.gap_start == 0);
+        REQUIRE(buf.to_vector() == std::vector<std::string> {"x", "y", "b", "c", "d"});
+    }
+
+    SECTION("Append") {
+        GapBuffer buf({"a"});
+        buf.insert(0, "b");
+        buf.append({"c", "d"});
+        buf.edit(0) += "!";
+        REQUIRE(buf.to_vector() == std::vector<std::string> {"b!", "a", "c", "d"});
+    }
+
+    SECTION("Matches a vector through random edits") {
+        std::vector<std::string> expected(200, "line");
+        GapBuffer buf(expected);
+        std::mt19937 rng(42);
+
+        for (int i = 0; i < 5000; i++) {
+            const std::size_t idx = rng() % (expected.size() + 1);
+            const std::string text = std::to_string(i);
+
+            if (rng() % 2 || idx == expected.size()) {
+                buf.insert(idx, text);
+                expected.insert(expected.begin() + std::ptrdiff_t(idx), text);
+            } else {
+                buf.erase(idx);
+                expected.erase(expected.begin() + std::ptrdiff_t(idx));
+            }
+        }
+
+        REQUIRE(buf.to_vector() == expected);
+    }
+
+    SECTION("What's known about a line follows it through edits") {
+        GapBuffer buf(std::vector<std::string>(100, "line"));
+        std::mt19937 rng(7);
+
+        for (int i = 0; i < 2000; i++) {
+            const std::size_t idx = rng() % buf.size();
+            const std::string text = i % 3 ? "  \t" + std::to_string(i) : "  ";
+
+            if (rng() % 3 == 0) {
+                buf.insert(idx, text);
+            } else if (rng() % 2) {
+                buf.erase(idx);
+                buf.insert(rng() % (buf.size() + 1), "x");
+            } else {
+                buf.edit(idx) += "\t";
+            }
+
+            // Anything cached on the way has to match the line as it is now
+            const std::size_t look = rng() % buf.size();
+            const LineRef ref = buf.line_ref(look);
+            const LineRef fresh(buf.at(look));
+            REQUIRE(ref.text() == fresh.text());
+            REQUIRE(ref.flags == fresh.flags);
+            REQUIRE(ref.indent() == fresh.indent());
+        }
+    }
+}
+
+TEST_CASE("GapLine", "[gap_buffer]") {
+    GapLine line = {};
+    line.load("hello world");
+    REQUIRE(line.str() == "hello world");
+
+    SECTION("Typing in one place") {
+        std::size_t pos = 6;
+        for (const char c : std::string("big ")) {
+            line.insert(pos++, c);
+        }
+        REQUIRE(line.str() == "hello big world");
+        REQUIRE(line.gap_start == 10);
+    }
+
+    SECTION("Gap grows") {
+        for (std::size_t i = 0; i < 1000; i++) {
+            line.insert(0, 'a');
+        }
+        REQUIRE(line.size() == 1011);
+        REQUIRE(line.str() == std::string(1000, 'a') + "hello world");
+    }
+
+    SECTION("Erase") {
+        line.erase(5, 6);
+        REQUIRE(line.str() == "hello");
+        line.erase(0, 1);
+        REQUIRE(line.str() == "ello");
+        REQUIRE(line.at(3) == 'o');
+        REQUIRE_THROWS_AS(line.erase(3, 2), std::out_of_range);
+        REQUIRE_THROWS_AS(line.at(4), std::out_of_range);
+    }
+
+    SECTION("Read in parts either side of the gap") {
+        line.insert(5, '\t');
+        line.insert(6, ',');
+        REQUIRE(line.stale);
+
+        const LineParts parts = line.parts();
+        REQUIRE(parts.head == "hello\t,");
+        REQUIRE(parts.tail == " world");
+        REQUIRE(parts.tabs);
+        REQUIRE(parts.size() == 13);
+        REQUIRE(parts.at(7) == ' ');
+        REQUIRE(line.stale);
+
+        std::string copied = "";
+        parts.copy(copied, 4, 5);
+        REQUIRE(copied == "o\t, w");
+
+        line.erase(4, 2);
+        REQUIRE(!line.parts().tabs);
+    }
+}
+
+// Run with `./run.py test "[!benchmark]"`
+TEST_CASE("Benchmark typing into a long line", "[!benchmark][gap_buffer]") {
+    const std::string long_line(1024 * 1024, 'x');
+
+    BENCHMARK_ADVANCED("std::string: 1000 chars mid-line")(Catch::Benchmark::Chronometer meter) {
+        std::string line = long_line;
+        meter.measure([&] {
+            for (std::size_t i = 0; i < 1000; i++) {
+                line.insert(line.size() / 2 + i, 1, 'a');
+            }
+            return line.size();
+        });
+    };
+
+    BENCHMARK_ADVANCED("GapLine: 1000 chars mid-line")(Catch::Benchmark::Chronometer meter) {
+        GapLine line = {};
+        line.load(long_line);
+        meter.measure([&] {
+            const std::size_t start = line.size() / 2;
+            for (std::size_t i = 0; i < 1000; i++) {
+                line.insert(start + i, 'a');
+            }
+            return line.size();
+        });
+    };
+}
@@ -136,6 +136,9 @@ def test_write_command(r: TmuxRunner):
     status_bar = r.await_statusbar_parts()
     assert status_bar[0] == "READ"
 
+    # Saving happens in the background
+    r.await_text("Saved")
+
     # Check highlighting colour
     message_line: str = r.color_screenshot()[-1]
     # NOTE: This should already contain "hello world" -- set setup()
@@ -155,6 +158,7 @@ def test_write_with_filename_command(r: TmuxRunner):
     r.type_str("ifoo bar")
     r.press('Escape')
     r.iris_cmd("w tests/fixture/temp_file.txt")
+    r.await_text("Saved")
 
     message_line: str = r.color_screenshot()[-1]
     assert "Saved 8 bytes" in message_line
@@ -201,6 +205,7 @@ def test_write_all_command(r: TmuxRunner):
     assert "*" in r.await_tab_bar_parts()[1]
 
     r.iris_cmd("wa")
+    r.await_text("Saved")
     assert "[X]" not in r.statusbar_parts()
     assert "*" not in r.await_tab_bar_parts()[1]
     time.sleep(0.1)
@@ -211,6 +216,7 @@ def test_write_all_command(r: TmuxRunner):
 
     r.press("u")
     r.iris_cmd("wa")
+    r.await_text("Saved")
     time.sleep(0.1)
 
     with open(r.filename, "r") as f:
@@ -250,6 +256,16 @@ def test_lineno_command(r: TmuxRunner):
     assert first_line[0:len(prefix)] == prefix
 
 
+@setup("tests/fixture/lorem_ipsum.txt")
+def test_go_to_byte_command(r: TmuxRunner):
+    # The first line is 72 chars and its newline
+    r.iris_cmd("go 80")
+    assert r.await_statusbar_parts()[-1] == "2:8"
+
+    r.iris_cmd("go 999999")
+    assert "Offset is outside of the file" in r.color_screenshot()[-1]
+
+
 @setup("tests/fixture/lorem_ipsum.txt")
 def test_lineno_command_exact_center(r: TmuxRunner):
     r.iris_cmd("11")
@@ -367,6 +383,42 @@ def test_search_and_replace_multiline_command(r: TmuxRunner):
     assert "This was some text" in r.lines()[0]
     assert "here was a newline and a tab" in r.lines()[1]
 
+    r.press("u")
+    assert "This is some text" in r.lines()[0]
+    assert "here is a newline and a tab" in r.lines()[1]
+
+
+@setup("tests/fixture/test_file_1.txt")
+def test_undo_to_change_command(r: TmuxRunner):
+    r.type_str("dl")
+    r.press("u")
+    r.type_str("j")
+    r.type_str("dl")
+    assert "This is some text" in r.lines()[0]
+
+    # The change that was undone before the second one is still there
+    r.iris_cmd("undo 1")
+    assert "here is a newline" in r.lines()[0]
+
+    r.iris_cmd("undo 9")
+    err_line: str = r.color_screenshot()[-1]
+    assert "No such change" in err_line
+
+
+@setup("tests/fixture/test_file_1.txt")
+def test_earlier_and_later_commands(r: TmuxRunner):
+    r.type_str("dl")
+    r.type_str("dl")
+    r.iris_cmd("earlier 2")
+    assert "This is some text" in r.lines()[0]
+
+    r.iris_cmd("later 1h")
+    assert "This is some text" not in r.lines()[0]
+
+    r.iris_cmd("earlier soon")
+    err_line: str = r.color_screenshot()[-1]
+    assert "Expected a count" in err_line
+
 
 @setup("tests/fixture/test_file_1.txt")
 def test_find_next_str_command(r: TmuxRunner):
@@ -323,7 +323,7 @@ def test_undo_redo_newline(r: TmuxRunner):
     r.press("u")
     assert r.await_statusbar_parts()[-1] == "2:1"
     lines = r.lines()
-    assert lines[0] == " 1\u2502This issome text"
+    assert lines[0] == " 1\u2502This is some text"
     assert lines[1] == " 2\u2502    here is a newline and a tab"
 
     r.press("R")
@@ -333,6 +333,21 @@ def test_undo_redo_newline(r: TmuxRunner):
     assert lines[1] == " 2\u2502some text"
 
 
+@setup("tests/fixture/test_file_1.txt")
+def test_undo_redo_open_line(r: TmuxRunner):
+    r.press("o")
+    r.type_str("hello")
+    r.press("Escape")
+    assert r.lines()[1].startswith(" 2\u2502hello")
+
+    # The new line goes along with what was typed on it
+    r.press("u")
+    assert r.lines()[1] == " 2\u2502    here is a newline and a tab"
+
+    r.press("R")
+    assert r.lines()[1].startswith(" 2\u2502hello")
+
+
 @setup("tests/fixture/test_file_1.txt")
 def test_undo_redo_toggle_case(r: TmuxRunner):
     r.press("l")
@@ -358,9 +373,10 @@ def test_undo_redo_insert_char(r: TmuxRunner):
     line: str = r.lines()[0]
     assert line.startswith(" 1\u2502hello")
 
+    # Everything typed in Write mode is undone at once
     r.press("u")
     line = r.lines()[0]
-    assert line.startswith(" 1\u2502hellT")
+    assert line.startswith(" 1\u2502This")
 
     r.press("R")
     line = r.lines()[0]
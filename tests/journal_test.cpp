@@ -0,0 +1,191 @@
+#include "journal.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "save.h"
+
+namespace {
+    const std::string FILENAME = "tests/fixture/temp_journal_file.txt";
+
+    FileStamp reset_file() {
+        std::ofstream out(FILENAME);
+        out << "foo\nbar\n";
+        out.close();
+        return file_stamp(FILENAME).value();
+    }
+}  // namespace
+
+TEST_CASE("journal_path", "[journal]") {
+    REQUIRE(journal_path("tests/fixture/foo.txt") == "tests/fixture/.foo.txt.iris-swp");
+    REQUIRE(journal_path("foo.txt") == ".foo.txt.iris-swp");
+}
+
+TEST_CASE("Journal", "[journal]") {
+    namespace fs = std::filesystem;
+    const FileStamp base = reset_file();
+
+    SECTION("Edits are read back in order") {
+        Journal journal(FILENAME, base, false);
+        journal.set_line(0, "hello");
+        journal.insert_line(1, "");
+        journal.erase_line(2);
+        journal.sync();
+
+        const auto entries = read_journal(FILENAME);
+        REQUIRE(entries.has_value());
+        REQUIRE(entries.value().size() == 3);
+        REQUIRE(entries.value().at(0).op == JournalOp::SetLine);
+        REQUIRE(entries.value().at(0).text == "hello");
+        REQUIRE(entries.value().at(1).op == JournalOp::InsertLine);
+        REQUIRE(entries.value().at(1).idx == 1);
+        REQUIRE(entries.value().at(2).op == JournalOp::EraseLine);
+        REQUIRE(entries.value().at(2).idx == 2);
+    }
+
+    SECTION("Lines past 4Gi are kept whole") {
+        const std::size_t far = (std::size_t(1) << 32) + 7;
+        Journal journal(FILENAME, base, false);
+        journal.insert_line(far, "far");
+        journal.erase_line(far + 1);
+        journal.sync();
+
+        const auto entries = read_journal(FILENAME);
+        REQUIRE(entries.value().size() == 2);
+        REQUIRE(entries.value().at(0).idx == far);
+        REQUIRE(entries.value().at(0).text == "far");
+        REQUIRE(entries.value().at(1).idx == far + 1);
+    }
+
+    SECTION("Removed once closed") {
+        {
+            Journal journal(FILENAME, base, false);
+            journal.set_line(0, "hello");
+            journal.sync();
+            REQUIRE(fs::exists(journal_path(FILENAME)));
+        }
+
+        REQUIRE(!fs::exists(journal_path(FILENAME)));
+        REQUIRE(!read_journal(FILENAME).has_value());
+    }
+
+    SECTION("Nothing synced yet") {
+        Journal journal(FILENAME, base, false);
+        journal.set_line(0, "hello");
+        REQUIRE(!read_journal(FILENAME).has_value());
+    }
+
+    SECTION("Ignored once the file changes") {
+        Journal journal(FILENAME, base, false);
+        journal.set_line(0, "hello");
+        journal.sync();
+
+        {
+            std::ofstream out(FILENAME, std::ios::app);
+            out << "baz\n";
+        }
+
+        REQUIRE(!read_journal(FILENAME).has_value());
+    }
+
+    SECTION("Half written records are dropped") {
+        Journal journal(FILENAME, base, false);
+        journal.set_line(0, "hello");
+        journal.set_line(1, "world");
+        journal.sync();
+
+        fs::resize_file(journal_path(FILENAME), fs::file_size(journal_path(FILENAME)) - 2);
+
+        const auto entries = read_journal(FILENAME);
+        REQUIRE(entries.value().size() == 1);
+        REQUIRE(entries.value().at(0).text == "hello");
+    }
+
+    SECTION("Rebase keeps the edits after the mark") {
+        Journal journal(FILENAME, base, false);
+        journal.set_line(0, "saved");
+        const std::size_t mark = journal.mark();
+        journal.set_line(1, "not saved");
+
+        {
+            std::ofstream out(FILENAME);
+            out << "saved\nbar\n";
+        }
+        journal.rebase(FILENAME, file_stamp(FILENAME).value(), mark);
+
+        const auto entries = read_journal(FILENAME);
+        REQUIRE(entries.value().size() == 1);
+        REQUIRE(entries.value().at(0).idx == 1);
+        REQUIRE(entries.value().at(0).text == "not saved");
+    }
+
+    SECTION("Rebase reads back what's been synced") {
+        Journal journal(FILENAME, base, false);
+        journal.set_line(0, "saved");
+        journal.sync();
+        const std::size_t mark = journal.mark();
+        journal.set_line(1, "synced");
+        journal.sync();
+        journal.erase_line(0);
+        REQUIRE(journal.pending.size() < journal.written - mark);
+
+        {
+            std::ofstream out(FILENAME);
+            out << "saved\nbar\n";
+        }
+        journal.rebase(FILENAME, file_stamp(FILENAME).value(), mark);
+        REQUIRE(journal.pending.empty());
+        REQUIRE(journal.written == journal.on_disk);
+
+        const auto entries = read_journal(FILENAME);
+        REQUIRE(entries.value().size() == 2);
+        REQUIRE(entries.value().at(0).text == "synced");
+        REQUIRE(entries.value().at(1).op == JournalOp::EraseLine);
+    }
+
+    SECTION("One left behind is kept unless replaced") {
+        // As if iris had crashed with it open
+        {
+            Journal journal(FILENAME, base, false);
+            journal.set_line(0, "crashed");
+            journal.sync();
+            fs::copy_file(journal_path(FILENAME), FILENAME + ".kept");
+        }
+        fs::rename(FILENAME + ".kept", journal_path(FILENAME));
+
+        {
+            Journal journal(FILENAME, base, false);
+            REQUIRE(journal.fd == -1);
+            journal.set_line(0, "new");
+            journal.sync();
+            REQUIRE_FALSE(journal.pending.empty());
+        }
+        REQUIRE(read_journal(FILENAME).value().at(0).text == "crashed");
+
+        Journal journal(FILENAME, base, true);
+        REQUIRE(journal.fd != -1);
+        REQUIRE(!read_journal(FILENAME).has_value());
+    }
+
+    SECTION("Never written over while in use") {
+        {
+            Journal journal(FILENAME, base, false);
+            REQUIRE(journal_in_use(FILENAME));
+
+            Journal other(FILENAME, base, true);
+            REQUIRE(other.fd == -1);
+            journal.set_line(0, "hello");
+            journal.sync();
+        }
+
+        REQUIRE(!journal_in_use(FILENAME));
+        REQUIRE(!fs::exists(journal_path(FILENAME)));
+    }
+
+    fs::remove(journal_path(FILENAME));
+    fs::remove(FILENAME);
+}
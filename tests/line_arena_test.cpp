@@ -0,0 +1,116 @@
+#include "line_arena.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <sys/mman.h>
+
+#include "constants.h"
+
+TEST_CASE("LineRef", "[line_arena]") {
+    SECTION("Flags") {
+        const LineRef line("\t  foo bar");
+        REQUIRE(sizeof(line) == 16);
+        REQUIRE(line.text() == "\t  foo bar");
+        REQUIRE(line.ascii());
+        REQUIRE(line.has_tabs());
+        REQUIRE_FALSE(line.blank());
+        REQUIRE(line.indent() == 3);
+
+        REQUIRE(LineRef("").blank());
+        REQUIRE(LineRef(" \t ").blank());
+        REQUIRE_FALSE(LineRef("café").ascii());
+        REQUIRE_FALSE(LineRef("foo").has_tabs());
+    }
+
+    SECTION("Indent longer than is cached") {
+        const std::string line = std::string(70'000, ' ') + "x";
+        const LineRef ref(line);
+        REQUIRE(ref.leading == UINT16_MAX);
+        REQUIRE(ref.indent() == 70'000);
+        REQUIRE_FALSE(ref.blank());
+    }
+
+    SECTION("Lines over 4GiB") {
+        // Untouched pages all read back as the same zero page, so this
+        // doesn't take 4GiB of memory. A non-ASCII char up front stops the
+        // scan for one early
+        const std::size_t size = std::size_t(UINT32_MAX) + 10;
+        void* pages = mmap(
+            nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+            -1, 0);
+        REQUIRE(pages != MAP_FAILED);
+        char* text = static_cast<char*>(pages);
+        text[0] = ' ';
+        text[1] = '\xc3';
+
+        const std::string_view line(text, size);
+        const LineRef ref(line);
+        REQUIRE(ref.text().data() == line.data());
+        REQUIRE(ref.text().size() == size);
+        REQUIRE(ref.indent() == 1);
+        REQUIRE_FALSE(ref.ascii());
+        REQUIRE_FALSE(ref.has_tabs());
+        REQUIRE_FALSE(ref.blank());
+
+        munmap(pages, size);
+    }
+}
+
+TEST_CASE("LineArena", "[line_arena]") {
+    SECTION("Small lines share a slab") {
+        LineArena arena = {};
+        const std::string_view first = arena.store("foo");
+        const std::string_view second = arena.store("bar");
+
+        REQUIRE(first == "foo");
+        REQUIRE(second == "bar");
+        REQUIRE(arena.slabs.size() == 1);
+        REQUIRE(second.data() == first.data() + first.size());
+    }
+
+    SECTION("A new slab is started when one is full") {
+        LineArena arena = {};
+        const std::string line(ARENA_SLAB_SIZE / 2 + 1, 'x');
+        const std::string_view first = arena.store(line);
+        const std::string_view second = arena.store(line);
+
+        REQUIRE(arena.slabs.size() == 2);
+        REQUIRE(first == line);
+        REQUIRE(second == line);
+    }
+
+    SECTION("Big allocations get their own slab") {
+        LineArena arena = {};
+        std::ignore = arena.store("foo");
+        char* big = arena.allocate(ARENA_SLAB_SIZE * 2);
+
+        REQUIRE(arena.slabs.size() == 2);
+        REQUIRE(big == arena.slabs.back().get());
+
+        // Small lines keep filling the first slab
+        const std::string_view after = arena.store("bar");
+        REQUIRE(after.data() == arena.slabs.front().get() + 3);
+    }
+
+    SECTION("Adopted slabs outlive the arena they came from") {
+        LineArena arena = {};
+        std::vector<std::string_view> lines = {};
+        {
+            LineArena other = {};
+            lines.push_back(other.store("from the other arena"));
+            arena.adopt(std::move(other));
+        }
+
+        lines.push_back(arena.store("foo"));
+        REQUIRE(arena.slabs.size() == 2);
+        REQUIRE(lines.at(0) == "from the other arena");
+        REQUIRE(lines.at(1) == "foo");
+    }
+}
@@ -0,0 +1,172 @@
+#include "loader.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "constants.h"
+#include "model.h"
+#include "gap_buffer.h"
+#include "paged_buffer.h"
+#include "piece_table.h"
+
+TEST_CASE("append_lines", "[loader]") {
+    std::vector<std::string> out = {"existing"};
+    append_lines("foo\tbar\r\nbaz\n\nlast", out);
+
+    const std::vector<std::string> expected = {"existing", "foo\tbar", "baz", "", "last"};
+    REQUIRE(out == expected);
+}
+
+TEST_CASE("load_lines", "[loader]") {
+    REQUIRE(load_lines("foo\nbar\n") == std::vector<std::string> {"foo", "bar"});
+    REQUIRE(load_lines("").empty());
+
+    SECTION("Into an arena") {
+        LineArena arena = {};
+        std::vector<LineRef> out = {};
+        load_lines("foo\tbar\r\nbaz\n\nlast", arena, out);
+        load_lines("", arena, out);
+
+        REQUIRE(out.size() == 4);
+        REQUIRE(out.at(0).text() == "foo\tbar");
+        REQUIRE(out.at(0).has_tabs());
+        REQUIRE(out.at(1).text() == "baz");
+        REQUIRE(out.at(2).blank());
+        REQUIRE(out.at(3).text() == "last");
+        REQUIRE(arena.slabs.size() == 1);
+    }
+
+    SECTION("Into an arena on multiple threads") {
+        std::string text = "";
+        std::vector<std::string> expected = {};
+        for (std::size_t i = 0; text.size() <= PARALLEL_LOAD_SIZE; i++) {
+            expected.push_back("line " + std::to_string(i));
+            text += expected.back() + "\r\n";
+        }
+
+        LineArena arena = {};
+        std::vector<LineRef> out = {};
+        load_lines(text, arena, out);
+
+        REQUIRE(out.size() == expected.size());
+        REQUIRE(std::equal(out.begin(), out.end(), expected.begin(), [](const LineRef& a, const std::string& b) {
+            return a.text() == b;
+        }));
+    }
+}
+
+TEST_CASE("open_text_buffer", "[loader]") {
+    SECTION("Backend follows the file size") {
+        REQUIRE(choose_backend(100, false) == Backend::Vector);
+        REQUIRE(choose_backend(GAP_BUFFER_SIZE, false) == Backend::Gap);
+        REQUIRE(choose_backend(PIECE_TABLE_SIZE, false) == Backend::PieceTable);
+        REQUIRE(choose_backend(PAGED_LOAD_SIZE, false) == Backend::PieceTable);
+        REQUIRE(choose_backend(PIECE_TABLE_SIZE, true) == Backend::PieceTable);
+        REQUIRE(choose_backend(PAGED_LOAD_SIZE, true) == Backend::Paged);
+    }
+
+    SECTION("Small file") {
+        auto opened = open_text_buffer("tests/fixture/lorem_ipsum.txt", 10, false);
+        REQUIRE(opened.has_value());
+        REQUIRE(dynamic_cast<VectorBuffer*>(opened.value().buf.get()) != nullptr);
+        REQUIRE(opened.value().rest == nullptr);
+    }
+
+    SECTION("Large file") {
+        const std::string filename = "tests/fixture/large_temp_file.txt";
+        {
+            std::ofstream out(filename);
+            for (std::size_t i = 0; std::size_t(out.tellp()) <= STREAMING_LOAD_SIZE; i++) {
+                out << "line " << i << "\n";
+            }
+        }
+
+        auto opened = open_text_buffer(filename, 10, false);
+        std::filesystem::remove(filename);
+
+        REQUIRE(opened.has_value());
+        REQUIRE(dynamic_cast<PieceTable*>(opened.value().buf.get()) != nullptr);
+        REQUIRE(opened.value().buf->size() == 10);
+        REQUIRE(opened.value().rest != nullptr);
+
+        // The rest is loaded into slabs, and handed over to the piece table
+        // when it's done
+        auto m = Model(std::move(opened.value().buf), filename);
+        m.loader = std::move(opened.value().rest);
+        m.wait_for_load();
+
+        const auto& table = dynamic_cast<const PieceTable&>(*m.buf);
+        REQUIRE(table.blocks.size() == 2);
+        REQUIRE(table.edited.empty());
+        REQUIRE(table.arena.slabs.size() < table.size() / 1000);
+        REQUIRE(m.buf->at(10) == "line 10");
+        REQUIRE(m.buf->at(m.buf->size() - 1).starts_with("line "));
+    }
+
+    SECTION("Large file with tabs and CRLFs") {
+        const std::string filename = "tests/fixture/large_temp_file.txt";
+        std::size_t lines = 0;
+        {
+            std::ofstream out(filename);
+            while (std::size_t(out.tellp()) <= STREAMING_LOAD_SIZE) {
+                out << "\tline " << lines << "\r\n";
+                lines++;
+            }
+            out << "last line";
+        }
+
+        auto opened = open_text_buffer(filename, 10, false);
+        std::filesystem::remove(filename);
+
+        REQUIRE(opened.has_value());
+        REQUIRE(opened.value().buf->size() == 10);
+        REQUIRE(opened.value().buf->at(0) == "\tline 0");
+        REQUIRE(opened.value().rest != nullptr);
+
+        auto m = Model(std::move(opened.value().buf), filename);
+        m.loader = std::move(opened.value().rest);
+        REQUIRE(m.loading());
+
+        m.wait_for_load();
+        REQUIRE_FALSE(m.loading());
+        REQUIRE(m.load_progress() == 100);
+        REQUIRE(m.buf->size() == lines + 1);
+        REQUIRE(m.buf->at(10) == "\tline 10");
+        REQUIRE(m.buf->at(lines - 1) == "\tline " + std::to_string(lines - 1));
+        REQUIRE(m.buf->at(m.buf->size() - 1) == "last line");
+    }
+
+    SECTION("Lines are handed over as they're read") {
+        const MappedFile expected("tests/fixture/lorem_ipsum.txt");
+        const std::vector<std::string> lines = load_lines(expected.view());
+
+        auto m = Model(std::make_unique<PieceTable>(std::vector<std::string> {"head"}), "");
+        m.loader = std::make_shared<FileLoader>(MappedFile("tests/fixture/lorem_ipsum.txt"), 0);
+        m.loader->wait();
+
+        // As if the last batch was still being read
+        m.loader->finished = false;
+        REQUIRE(m.poll_load());
+        REQUIRE(m.loading());
+        REQUIRE(m.line_count() == lines.size() + 1);
+        REQUIRE(m.buf->at(1) == lines.at(0));
+        REQUIRE(m.loader->take().lines.empty());
+
+        REQUIRE_FALSE(m.poll_load());
+        m.loader->finished = true;
+        REQUIRE(m.poll_load());
+        REQUIRE_FALSE(m.loading());
+        REQUIRE(m.line_count() == lines.size() + 1);
+    }
+
+    SECTION("File does not exist") {
+        REQUIRE(!open_text_buffer("tests/fixture/does_not_exist.txt", 10, false).has_value());
+    }
+}
@@ -0,0 +1,29 @@
+#include "mapped_file.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "text_io.h"
+
+TEST_CASE("MappedFile", "[mapped_file]") {
+    SECTION("Existing file") {
+        const MappedFile m("tests/fixture/test_file_1.txt");
+        REQUIRE(m.valid());
+        REQUIRE(m.size == get_file_size("tests/fixture/test_file_1.txt"));
+        REQUIRE(m.view().starts_with("This is some text\n"));
+    }
+
+    SECTION("Missing file") {
+        const MappedFile m("tests/fixture/does_not_exist.txt");
+        REQUIRE_FALSE(m.valid());
+        REQUIRE(m.size == 0);
+    }
+
+    SECTION("Move ownership") {
+        MappedFile m("tests/fixture/no_newline_file.txt");
+        MappedFile other = std::move(m);
+
+        REQUIRE_FALSE(m.valid());
+        REQUIRE(other.valid());
+        REQUIRE(other.view() == "hello");
+    }
+}
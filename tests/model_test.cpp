@@ -1,5 +1,9 @@
 #include "model.h"
 
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
 #include <stdexcept>
 
 #include <catch2/catch_test_macros.hpp>
@@ -7,7 +11,7 @@
 #include <rawterm/text.h>
 
 #include "action.h"
-#include "change.h"
+#include "piece_table.h"
 #include "text_io.h"
 #include "view.h"
 
@@ -15,7 +19,7 @@ TEST_CASE("Constructor", "[model]") {
     auto m = Model(32, "");
 
     REQUIRE(m.filename == "");
-    REQUIRE(m.buf.capacity() == 32);
+    REQUIRE(dynamic_cast<VectorBuffer&>(*m.buf).lines.capacity() == 32);
 }
 
 TEST_CASE("Constructor with params", "[model]") {
@@ -23,7 +27,7 @@ TEST_CASE("Constructor with params", "[model]") {
     auto m = Model(expected_buf, "");
 
     REQUIRE(m.filename == "");
-    REQUIRE(m.buf.at(0) == "foo");
+    REQUIRE(m.buf->at(0) == "foo");
 }
 
 TEST_CASE("backspace", "[model]") {
@@ -33,8 +37,8 @@ TEST_CASE("backspace", "[model]") {
         m.current_line = 1;
         std::ignore = m.backspace();
 
-        REQUIRE(m.buf.size() == 2);
-        REQUIRE(m.buf.at(0) == "foobar");
+        REQUIRE(m.buf->size() == 2);
+        REQUIRE(m.buf->at(0) == "foobar");
     }
 
     SECTION("backspace a char") {
@@ -44,9 +48,9 @@ TEST_CASE("backspace", "[model]") {
         m.current_char = 2;
         std::ignore = m.backspace();
 
-        REQUIRE(m.buf.size() == 3);
-        REQUIRE(m.buf.at(1) == "br");
-        REQUIRE(m.buf.at(1).size() == 2);
+        REQUIRE(m.buf->size() == 3);
+        REQUIRE(m.buf->at(1) == "br");
+        REQUIRE(m.buf->at(1).size() == 2);
     }
 
     SECTION("backspace the last char") {
@@ -56,9 +60,9 @@ TEST_CASE("backspace", "[model]") {
         m.current_char = 3;
         std::ignore = m.backspace();
 
-        REQUIRE(m.buf.size() == 3);
-        REQUIRE(m.buf.at(1) == "ba");
-        REQUIRE(m.buf.at(1).size() == 2);
+        REQUIRE(m.buf->size() == 3);
+        REQUIRE(m.buf->at(1) == "ba");
+        REQUIRE(m.buf->at(1).size() == 2);
     }
 
     SECTION("backspace a tab-space") {
@@ -70,8 +74,8 @@ TEST_CASE("backspace", "[model]") {
         REQUIRE(draw.type == RedrawType::Line);
         REQUIRE(draw.count == 4);
 
-        REQUIRE(m.buf.at(0).size() == 8);
-        REQUIRE(m.buf.at(0).at(0) == 'S');
+        REQUIRE(m.buf->at(0).size() == 8);
+        REQUIRE(m.buf->at(0).at(0) == 'S');
     }
 }
 
@@ -84,9 +88,9 @@ TEST_CASE("newline", "[model]") {
         const std::size_t prev_line_len = m.newline();
 
         REQUIRE(prev_line_len == 3);
-        REQUIRE(m.buf.size() == 4);
-        REQUIRE(m.buf.at(0).size() == 3);
-        REQUIRE(m.buf.at(1).size() == 1);
+        REQUIRE(m.buf->size() == 4);
+        REQUIRE(m.buf->at(0).size() == 3);
+        REQUIRE(m.buf->at(1).size() == 1);
     }
 
     SECTION("At mid of line") {
@@ -97,11 +101,11 @@ TEST_CASE("newline", "[model]") {
         const std::size_t prev_line_len = m.newline();
 
         REQUIRE(prev_line_len == 1);
-        REQUIRE(m.buf.size() == 4);
-        REQUIRE(m.buf.at(0).size() == 1);
-        REQUIRE(m.buf.at(0) == "f");
-        REQUIRE(m.buf.at(1).size() == 2);
-        REQUIRE(m.buf.at(1) == "oo");
+        REQUIRE(m.buf->size() == 4);
+        REQUIRE(m.buf->at(0).size() == 1);
+        REQUIRE(m.buf->at(0) == "f");
+        REQUIRE(m.buf->at(1).size() == 2);
+        REQUIRE(m.buf->at(1) == "oo");
     }
 
     SECTION("At start of line") {
@@ -111,11 +115,11 @@ TEST_CASE("newline", "[model]") {
         const std::size_t prev_line_len = m.newline();
 
         REQUIRE(prev_line_len == 0);
-        REQUIRE(m.buf.size() == 4);
-        REQUIRE(m.buf.at(0).size() == 0);
-        REQUIRE(m.buf.at(0) == "");
-        REQUIRE(m.buf.at(1).size() == v.at(0).size());
-        REQUIRE(m.buf.at(1) == "foo");
+        REQUIRE(m.buf->size() == 4);
+        REQUIRE(m.buf->at(0).size() == 0);
+        REQUIRE(m.buf->at(0) == "");
+        REQUIRE(m.buf->at(1).size() == v.at(0).size());
+        REQUIRE(m.buf->at(1) == "foo");
     }
 
     SECTION("Remove whitespace from second line") {
@@ -125,9 +129,9 @@ TEST_CASE("newline", "[model]") {
 
         const std::size_t prev_line_len = m.newline();
         REQUIRE(prev_line_len == 4);
-        REQUIRE(m.buf.at(0) == "Some");
-        REQUIRE(m.buf.at(1) == "long text");
-        REQUIRE(m.buf.at(2) == "and another");
+        REQUIRE(m.buf->at(0) == "Some");
+        REQUIRE(m.buf->at(1) == "long text");
+        REQUIRE(m.buf->at(2) == "and another");
     }
 
     SECTION("Insert indentation") {
@@ -137,8 +141,8 @@ TEST_CASE("newline", "[model]") {
         const std::size_t line_one_len = m.newline();
 
         REQUIRE(line_one_len == 11);
-        REQUIRE(m.buf.at(0) == "    an indented");
-        REQUIRE(m.buf.at(1) == "    line");
+        REQUIRE(m.buf->at(0) == "    an indented");
+        REQUIRE(m.buf->at(1) == "    line");
     }
 }
 
@@ -148,14 +152,14 @@ TEST_CASE("insert", "[model]") {
         auto m = Model(v, "");
 
         m.insert('x');
-        REQUIRE(m.buf.at(0) == "xfoo");
-        REQUIRE(m.buf.at(0).size() == 4);
-        REQUIRE(m.buf.size() == 3);
+        REQUIRE(m.buf->at(0) == "xfoo");
+        REQUIRE(m.buf->at(0).size() == 4);
+        REQUIRE(m.buf->size() == 3);
 
         m.insert('y');
-        REQUIRE(m.buf.at(0) == "xyfoo");
-        REQUIRE(m.buf.at(0).size() == 5);
-        REQUIRE(m.buf.size() == 3);
+        REQUIRE(m.buf->at(0) == "xyfoo");
+        REQUIRE(m.buf->at(0).size() == 5);
+        REQUIRE(m.buf->size() == 3);
     }
 
     SECTION("Insert in mid of line") {
@@ -165,9 +169,9 @@ TEST_CASE("insert", "[model]") {
         m.current_char++;
         m.insert('x');
 
-        REQUIRE(m.buf.at(0) == "fxoo");
-        REQUIRE(m.buf.at(0).size() == 4);
-        REQUIRE(m.buf.size() == 3);
+        REQUIRE(m.buf->at(0) == "fxoo");
+        REQUIRE(m.buf->at(0).size() == 4);
+        REQUIRE(m.buf->size() == 3);
     }
 
     SECTION("Insert at end of line") {
@@ -177,9 +181,53 @@ TEST_CASE("insert", "[model]") {
         m.current_char = static_cast<unsigned int>(v.at(0).size());
         m.insert('x');
 
-        REQUIRE(m.buf.at(0) == "foox");
-        REQUIRE(m.buf.at(0).size() == 4);
-        REQUIRE(m.buf.size() == 3);
+        REQUIRE(m.buf->at(0) == "foox");
+        REQUIRE(m.buf->at(0).size() == 4);
+        REQUIRE(m.buf->size() == 3);
+    }
+
+    SECTION("Typing in Write mode") {
+        lines_t v = {"foo", "bar", "baz"};
+        auto m = Model(v, "");
+        m.start_typing();
+
+        m.current_char = 1;
+        m.insert('x');
+        m.insert('y');
+
+        // Held in the gap buffer until the line is left
+        REQUIRE(m.typing_line == 0);
+        REQUIRE(m.line(0) == "fxyoo");
+        REQUIRE(m.buf->at(0) == "foo");
+        REQUIRE(m.unsaved);
+        REQUIRE(m.dirty_lines.test(0));
+
+        std::ignore = m.backspace();
+        REQUIRE(m.line(0) == "fxoo");
+        REQUIRE(m.current_char == 2);
+
+        m.current_line = 1;
+        m.current_char = 0;
+        m.insert('z');
+        REQUIRE(m.typing_line == 1);
+        REQUIRE(m.buf->at(0) == "fxoo");
+
+        m.stop_typing();
+        REQUIRE(m.typing_line == std::string::npos);
+        REQUIRE(m.buf->at(1) == "zbar");
+    }
+
+    SECTION("Other edits flush the typing line first") {
+        lines_t v = {"foo", "bar"};
+        auto m = Model(v, "");
+        m.start_typing();
+
+        m.insert('x');
+        std::ignore = m.newline();
+
+        REQUIRE(m.buf->at(0) == "x");
+        REQUIRE(m.buf->at(1) == "foo");
+        REQUIRE(m.typing_line == std::string::npos);
     }
 }
 
@@ -206,7 +254,7 @@ TEST_CASE("next_word_pos", "[model]") {
 
     // if at end of line, don't crash
     m.current_line = 0;
-    m.current_char = static_cast<uint>(m.buf.at(0).size()) - 1;
+    m.current_char = static_cast<uint>(m.buf->at(0).size()) - 1;
     REQUIRE_FALSE(m.next_word_pos().has_value());
 }
 
@@ -254,7 +302,7 @@ TEST_CASE("prev_para_pos", "[model]") {
     auto opt = m.prev_para_pos();
     REQUIRE_FALSE(opt.has_value());
 
-    m.current_line = static_cast<unsigned int>(m.buf.size() - 1);
+    m.current_line = static_cast<unsigned int>(m.buf->size() - 1);
 
     opt = m.prev_para_pos();
     REQUIRE(opt.has_value());
@@ -290,25 +338,25 @@ TEST_CASE("replace_char", "[model]") {
 
     m.current_line = 1;
     m.replace_char('c');
-    REQUIRE(m.buf.at(1).size() == 1);
-    REQUIRE(m.buf.at(1) == "c");
+    REQUIRE(m.buf->at(1).size() == 1);
+    REQUIRE(m.buf->at(1) == "c");
 
     m.current_line = 2;
     m.current_char = 4;
     m.replace_char('_');
-    REQUIRE(m.buf.at(2).size() == 9);
-    REQUIRE(m.buf.at(2).at(4) == '_');
-    REQUIRE(m.buf.at(2) == "line_five");
+    REQUIRE(m.buf->at(2).size() == 9);
+    REQUIRE(m.buf->at(2).at(4) == '_');
+    REQUIRE(m.buf->at(2) == "line_five");
 }
 
 TEST_CASE("toggle_case", "[model]") {
     auto m = Model({"line one", "line two", "line three", "", "line four", "line five"}, "");
 
     m.toggle_case();
-    REQUIRE(m.buf.at(0).at(0) == 'L');
+    REQUIRE(m.buf->at(0).at(0) == 'L');
 
     m.current_char = 4;
-    REQUIRE(m.buf.at(0).at(4) == ' ');
+    REQUIRE(m.buf->at(0).at(4) == ' ');
 }
 
 TEST_CASE("find_next", "[model]") {
@@ -348,7 +396,7 @@ TEST_CASE("find_prev", "[model]") {
     m.current_char = static_cast<unsigned int>(ret.value().horizontal);
     REQUIRE(m.current_line == 5);
     REQUIRE(m.current_char == 5);
-    REQUIRE(m.buf.at(5).at(5) == 'f');
+    REQUIRE(m.buf->at(5).at(5) == 'f');
 
     ret = m.find_prev('t');
     REQUIRE(ret.has_value());
@@ -364,147 +412,358 @@ TEST_CASE("find_prev", "[model]") {
 
 TEST_CASE("undo", "[model]") {
     auto m = Model({"line one", "line two", "line three", "", "line four", "line five"}, "");
+    m.current_line = 1;
+    m.current_char = 1;
 
-    // NOTE: In the actual execution, wemove the cursor back one then perform
-    // the same change as DelCurrentChar -- note that the current_char is one
-    // less here. It _should_ be the `i` char that's deleted here.
-    SECTION("Backspace") {
-        m.current_line = 1;
-        m.current_char = 1;
-        m.undo_stack.push_back(Change(
-            ActionType::Backspace, m.current_line, m.current_char + 1, m.get_current_char()));
-
-        m.buf.at(m.current_line).erase(m.current_char, 1);
-        REQUIRE(m.buf.at(m.current_line) == "lne two");
+    // Make an edit in an undo group of its own, then undo it
+    auto undoes = [&m](auto edit) {
+        const std::vector<std::string> before = m.buf->to_vector();
+        m.begin_undo_group();
+        edit();
+        m.end_undo_group();
+        REQUIRE(m.buf->to_vector() != before);
 
         REQUIRE(m.undo(24));
-        REQUIRE(m.buf.at(m.current_line) == "line two");
+        return m.buf->to_vector() == before;
     };
 
-    SECTION("DelCurrentChar") {
-        m.current_line = 1;
-        m.current_char = 2;
+    SECTION("Nothing to undo") {
+        REQUIRE_FALSE(m.undo(24));
+    }
 
-        char next_char = m.buf.at(m.current_line).at(m.current_char);
-        m.undo_stack.push_back(
-            Change(ActionType::DelCurrentChar, m.current_line, m.current_char, next_char));
-        m.buf.at(m.current_line).erase(m.current_char, 1);
-        REQUIRE(m.buf.at(m.current_line) == "lie two");
+    SECTION("Backspace") {
+        REQUIRE(undoes([&] { std::ignore = m.backspace(); }));
+    }
 
-        REQUIRE(m.undo(24));
-        REQUIRE(m.buf.at(m.current_line) == "line two");
-    };
+    SECTION("Backspace joining lines") {
+        m.current_char = 0;
+        REQUIRE(undoes([&] { std::ignore = m.backspace(); }));
+        REQUIRE(m.buf->size() == 6);
+    }
 
     SECTION("Newline") {
-        m.current_line = 1;
-        m.current_char = 1;
-        std::ignore = m.newline();
-        REQUIRE(m.buf.at(m.current_line - 1) == "l");
-        REQUIRE(m.buf.at(m.current_line) == "ine two");
+        REQUIRE(undoes([&] { std::ignore = m.newline(); }));
+        REQUIRE(m.buf->size() == 6);
+    }
 
-        m.undo_stack.push_back(Change(ActionType::Newline, 1, 1));
+    SECTION("ToggleCase") {
+        REQUIRE(undoes([&] { m.toggle_case(); }));
+    }
 
-        REQUIRE(m.undo(24));
-        REQUIRE(m.buf.at(m.current_line - 1) == "line two");
-        REQUIRE(m.buf.size() == 6);
-    };
+    SECTION("InsertChar") {
+        REQUIRE(undoes([&] { m.insert('?'); }));
+    }
 
-    SECTION("ToggleCase") {
-        m.current_line = 1;
-        m.current_char = 1;
-        m.toggle_case();
-        REQUIRE(m.get_current_char() == 'I');
+    SECTION("ReplaceChar") {
+        REQUIRE(undoes([&] { m.replace_char('?'); }));
+    }
+
+    SECTION("DelCurrentLine") {
+        REQUIRE(undoes([&] { m.delete_current_line(); }));
+        REQUIRE(m.buf->at(1) == "line two");
+    }
+
+    SECTION("DelCurrentWord") {
+        REQUIRE(undoes([&] { m.delete_current_word(m.current_word().value()); }));
+    }
+
+    SECTION("IndentLine") {
+        REQUIRE(undoes([&] { m.indent_curr_line(); }));
+    }
+
+    SECTION("DedentLine") {
+        m.indent_curr_line();
+        REQUIRE(undoes([&] { m.dedent_curr_line(); }));
+        REQUIRE(m.buf->at(1) == "    line two");
+    }
+
+    SECTION("Move line") {
+        REQUIRE(undoes([&] { std::ignore = m.move_line_down(); }));
+    }
+
+    SECTION("Only the last change is undone") {
+        m.begin_undo_group();
+        m.insert('!');
+        m.end_undo_group();
+        REQUIRE(undoes([&] { m.insert('?'); }));
+        REQUIRE(m.buf->at(1) == "l!ine two");
+        REQUIRE(m.unsaved);
 
-        m.undo_stack.push_back(Change(ActionType::ToggleCase, m.current_line, m.current_char));
         REQUIRE(m.undo(24));
-        REQUIRE(m.get_current_char() == 'i');
-    };
+        REQUIRE(m.buf->at(1) == "line two");
+        REQUIRE(!m.unsaved);
+    }
 
-    SECTION("InsertChar") {
-        m.current_line = 1;
-        m.current_char = 1;
-        m.insert('?');
-        REQUIRE(m.buf.at(m.current_line) == "l?ine two");
+    SECTION("Cursor is kept inside the buffer") {
+        m.current_line = 5;
+        m.begin_undo_group();
+        std::ignore = m.newline();
+        std::ignore = m.newline();
+        m.end_undo_group();
+        REQUIRE(m.current_line == 7);
 
-        m.undo_stack.push_back(Change(ActionType::InsertChar, m.current_line, m.current_char, '?'));
         REQUIRE(m.undo(24));
-        REQUIRE(m.buf.at(m.current_line) == "line two");
-    };
+        REQUIRE(m.current_line == 5);
+        REQUIRE(m.current_char <= m.buf->at(5).size());
+    }
+}
 
-    SECTION("ReplaceChar") {
-        m.current_line = 1;
-        m.current_char = 1;
+TEST_CASE("undo groups", "[model]") {
+    auto m = Model({"line one", "line two", "line three", "", "line four", "line five"}, "");
+    const std::vector<std::string> before = m.buf->to_vector();
+    m.current_line = 1;
+    m.current_char = 1;
 
-        m.undo_stack.push_back(
-            Change(ActionType::ReplaceChar, m.current_line, m.current_char, m.get_current_char()));
+    SECTION("Every edit in a group is one change") {
+        m.begin_undo_group();
+        m.insert('a');
+        std::ignore = m.newline();
+        m.insert('b');
+        std::ignore = m.backspace();
+        m.current_line = 4;
+        m.delete_current_line();
+        m.end_undo_group();
 
-        m.replace_char('?');
-        REQUIRE(m.buf.at(m.current_line) == "l?ne two");
+        const std::vector<std::string> after = m.buf->to_vector();
+        REQUIRE(m.undo_log.size() == 1);
 
         REQUIRE(m.undo(24));
-        REQUIRE(m.buf.at(m.current_line) == "line two");
-    };
+        REQUIRE(m.buf->to_vector() == before);
+
+        // The far away line is a hunk of its own
+        const std::string_view record = m.undo_log.record(1);
+        const auto hunks = m.undo_log.hunks(record);
+        REQUIRE(hunks.size() == 2);
+        REQUIRE(hunks.front().first == 1);
+        REQUIRE(m.undo_log.lines(record, hunks.front().before, hunks.front().before_count) ==
+                std::vector<std::string> {"line two"});
+        REQUIRE(m.buf->to_vector() == before);
+        REQUIRE(m.redo(24));
+        REQUIRE(m.buf->to_vector() == after);
+    }
 
-    SECTION("DelCurrentLine") {
-        m.current_line = 1;
-        m.undo_stack.push_back(Change(ActionType::DelCurrentLine, 1, 0, "line two"));
+    SECTION("Nested groups") {
+        m.begin_undo_group();
+        m.insert('a');
+        m.begin_undo_group();
+        std::ignore = m.newline();
+        m.end_undo_group();
+        REQUIRE(!m.undo_log.can_undo());
+        m.end_undo_group();
 
-        m.delete_current_line();
-        REQUIRE(m.buf.size() == 5);
-        REQUIRE(m.buf.at(1) == "line three");
+        REQUIRE(m.undo_log.size() == 1);
+        REQUIRE(m.undo(24));
+        REQUIRE(m.buf->to_vector() == before);
+    }
+
+    SECTION("A group that changes nothing isn't kept") {
+        m.begin_undo_group();
+        m.insert('a');
+        std::ignore = m.backspace();
+        m.end_undo_group();
+        REQUIRE(!m.undo_log.can_undo());
+    }
+
+    SECTION("Edits outside a group aren't kept") {
+        m.insert('a');
+        REQUIRE(!m.undo_log.can_undo());
+    }
+
+    SECTION("A visit to Write mode is one change") {
+        m.start_typing();
+        for (const char c : std::string("hello")) {
+            m.insert(c);
+        }
+        std::ignore = m.newline();
+        m.insert('!');
+        m.stop_typing();
+
+        REQUIRE(m.buf->at(1) == "lhello");
+        REQUIRE(m.buf->at(2) == "!ine two");
+        REQUIRE(m.undo_log.size() == 1);
 
         REQUIRE(m.undo(24));
-        REQUIRE(m.buf.size() == 6);
-        REQUIRE(m.buf.at(1) == "line two");
+        REQUIRE(m.buf->to_vector() == before);
     }
 
-    SECTION("DelCurrentWord") {
-        m.current_line = 1;
+    SECTION("A change after an undo starts a branch") {
+        m.begin_undo_group();
+        m.insert('a');
+        m.end_undo_group();
+        REQUIRE(m.undo(24));
+        REQUIRE(m.undo_log.can_redo());
+
         m.current_char = 1;
-        m.undo_stack.push_back(Change(ActionType::DelCurrentWord, 1, 0, "line"));
+        m.begin_undo_group();
+        m.insert('b');
+        m.end_undo_group();
+        REQUIRE(!m.undo_log.can_redo());
+        REQUIRE_FALSE(m.redo(24));
+        REQUIRE(m.buf->at(1) == "lbine two");
+
+        // The first branch can still be gone back to
+        REQUIRE(m.go_to_state(1, 24));
+        REQUIRE(m.buf->at(1) == "laine two");
+        REQUIRE(m.undo(24));
+        REQUIRE(m.redo(24));
+        REQUIRE(m.buf->at(1) == "laine two");
+    }
 
-        m.delete_current_word(m.current_word().value());
-        REQUIRE(m.buf.at(1) == " two");
+    SECTION("Offsets are kept up to date") {
+        std::ignore = m.offset_of(0);
+        m.begin_undo_group();
+        std::ignore = m.newline();
+        m.delete_current_line();
+        m.delete_current_line();
+        m.end_undo_group();
+
+        std::size_t bytes = 0;
+        for (const auto& line : before) {
+            bytes += line.size() + 1;
+        }
 
         REQUIRE(m.undo(24));
-        REQUIRE(m.buf.at(1) == "line two");
+        REQUIRE(m.offset_of(m.line_count()) == bytes);
+        REQUIRE(m.offset_of(2) == 18);
     }
+}
 
-    SECTION("IndentLine") {
-        m.undo_stack.push_back(Change(ActionType::IndentLine, 0, 0));
+TEST_CASE("go_to_state", "[model]") {
+    auto m = Model({"line one", "line two", "line three", "", "line four", "line five"}, "");
+    std::vector<std::vector<std::string>> states = {m.buf->to_vector()};
 
-        m.indent_curr_line();
-        REQUIRE(m.buf.at(m.current_line).at(0) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(1) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(2) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(3) == ' ');
+    auto change = [&m, &states](const std::size_t line) {
+        m.current_line = uint_t(line % m.line_count());
+        m.current_char = 0;
+        m.begin_undo_group();
+        m.insert('x');
+        m.end_undo_group();
+        states.push_back(m.buf->to_vector());
+    };
+
+    SECTION("Any state can be jumped to") {
+        for (std::size_t i = 0; i < 5; i++) {
+            change(i);
+        }
+
+        REQUIRE(m.go_to_state(2, 24));
+        REQUIRE(m.buf->to_vector() == states.at(2));
+        REQUIRE(m.unsaved);
+        REQUIRE(m.go_to_state(0, 24));
+        REQUIRE(m.buf->to_vector() == states.at(0));
+        REQUIRE(!m.unsaved);
+        REQUIRE(m.go_to_state(5, 24));
+        REQUIRE(m.buf->to_vector() == states.at(5));
+
+        REQUIRE_FALSE(m.go_to_state(5, 24));
+        REQUIRE_FALSE(m.go_to_state(6, 24));
+    }
 
+    SECTION("Across branches") {
+        change(0);
+        change(1);
         REQUIRE(m.undo(24));
-        REQUIRE(m.buf.at(m.current_line).at(0) == 'l');
-        REQUIRE(m.buf.at(m.current_line).at(1) == 'i');
-        REQUIRE(m.buf.at(m.current_line).at(2) == 'n');
-        REQUIRE(m.buf.at(m.current_line).at(3) == 'e');
+        change(2);
+
+        REQUIRE(m.go_to_state(2, 24));
+        REQUIRE(m.buf->to_vector() == states.at(2));
+        REQUIRE(m.go_to_state(3, 24));
+        REQUIRE(m.buf->to_vector() == states.at(3));
     }
 
-    SECTION("DedentLine") {
-        m.indent_curr_line();
-        REQUIRE(m.buf.at(m.current_line).at(0) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(1) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(2) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(3) == ' ');
-
-        m.undo_stack.push_back(Change(ActionType::DedentLine, 0, 0));
-        m.dedent_curr_line();
-        REQUIRE(m.buf.at(m.current_line).at(0) == 'l');
-        REQUIRE(m.buf.at(m.current_line).at(1) == 'i');
-        REQUIRE(m.buf.at(m.current_line).at(2) == 'n');
-        REQUIRE(m.buf.at(m.current_line).at(3) == 'e');
+    SECTION("By time") {
+        for (std::size_t i = 0; i < 4; i++) {
+            change(i);
+            m.undo_log.nodes.at(i + 1).time = int64_t(i) * 60;
+        }
+
+        REQUIRE(m.travel(-120, true, 24));
+        REQUIRE(m.undo_log.current == 2);
+        REQUIRE(m.travel(-1, false, 24));
+        REQUIRE(m.buf->to_vector() == states.at(1));
+        REQUIRE(m.travel(90, true, 24));
+        REQUIRE(m.undo_log.current == 2);
+        REQUIRE(m.travel(10, false, 24));
+        REQUIRE(m.buf->to_vector() == states.at(4));
+    }
 
+    SECTION("Far jumps start from a snapshot") {
+        m.set_backend(Backend::Rope);
+        std::ignore = m.offset_of(0);
+        for (std::size_t i = 0; i < UNDO_SNAPSHOT_INTERVAL * 3; i++) {
+            change(i * 7);
+        }
+        REQUIRE(m.snapshots.size() == 3);
+
+        REQUIRE(m.go_to_state(10, 24));
+        REQUIRE(m.undo_log.current == 10);
+        REQUIRE(m.buf->to_vector() == states.at(10));
+
+        // Only the lines that differ were reported
+        std::size_t bytes = 0;
+        for (const auto& line : states.at(10)) {
+            bytes += line.size() + 1;
+        }
+        REQUIRE(m.offset_of(m.line_count()) == bytes);
+
+        REQUIRE(m.go_to_state(UNDO_SNAPSHOT_INTERVAL * 2 + 5, 24));
+        REQUIRE(m.buf->to_vector() == states.at(UNDO_SNAPSHOT_INTERVAL * 2 + 5));
         REQUIRE(m.undo(24));
-        REQUIRE(m.buf.at(m.current_line).at(0) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(1) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(2) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(3) == ' ');
+        REQUIRE(m.buf->to_vector() == states.at(UNDO_SNAPSHOT_INTERVAL * 2 + 4));
+    }
+
+    SECTION("Far jumps in a file opened as a piece table") {
+        const std::string filename = "tests/fixture/temp_snapshot_file.txt";
+        {
+            std::ofstream out(filename);
+            const std::string filler(850, 'a');
+            for (std::size_t i = 0; std::size_t(out.tellp()) <= PIECE_TABLE_SIZE; i++) {
+                out << i << filler << "\n";
+            }
+        }
+
+        auto opened = open_text_buffer(filename, 24, false);
+        std::filesystem::remove(filename);
+        REQUIRE(opened.has_value());
+
+        auto big = Model(std::move(opened.value().buf), filename);
+        big.loader = std::move(opened.value().rest);
+        big.wait_for_load();
+        REQUIRE(dynamic_cast<PieceTable*>(big.buf.get()) != nullptr);
+        std::ignore = big.offset_of(0);
+
+        const std::vector<std::size_t> kept = {
+            10, UNDO_SNAPSHOT_INTERVAL * 2 + 4, UNDO_SNAPSHOT_INTERVAL * 2 + 5};
+        std::map<std::size_t, std::vector<std::string>> big_states = {};
+        for (std::size_t i = 1; i <= UNDO_SNAPSHOT_INTERVAL * 3; i++) {
+            big.current_line = uint_t((i * 7) % big.line_count());
+            big.current_char = 0;
+            big.begin_undo_group();
+            big.insert('x');
+            big.end_undo_group();
+            if (std::ranges::find(kept, i) != kept.end()) {
+                big_states[i] = big.buf->to_vector();
+            }
+        }
+        REQUIRE(big.snapshots.size() == 3);
+
+        // What needs redrawing depends on where the changes landed, so only the
+        // state each jump ends at is checked
+        std::ignore = big.go_to_state(10, 24);
+        REQUIRE(big.undo_log.current == 10);
+        REQUIRE(big.buf->to_vector() == big_states.at(10));
+
+        std::size_t bytes = 0;
+        for (const auto& line : big_states.at(10)) {
+            bytes += line.size() + 1;
+        }
+        REQUIRE(big.offset_of(big.line_count()) == bytes);
+
+        std::ignore = big.go_to_state(UNDO_SNAPSHOT_INTERVAL * 2 + 5, 24);
+        REQUIRE(big.undo_log.current == UNDO_SNAPSHOT_INTERVAL * 2 + 5);
+        REQUIRE(big.buf->to_vector() == big_states.at(UNDO_SNAPSHOT_INTERVAL * 2 + 5));
+        std::ignore = big.undo(24);
+        REQUIRE(big.buf->to_vector() == big_states.at(UNDO_SNAPSHOT_INTERVAL * 2 + 4));
     }
 }
 
@@ -522,137 +781,69 @@ TEST_CASE("redo", "[model]") {
     m.current_line = 1;
     m.current_char = 1;
 
-    SECTION("Backspace") {
-        m.insert('?');
-        REQUIRE(m.buf.at(1) == "l?ine two");
-
-        m.redo_stack.push(Change(ActionType::Backspace, m.current_line, m.current_char, 'i'));
+    // Make an edit in an undo group of its own, undo it, then redo it
+    auto redoes = [&m](auto edit) {
+        m.begin_undo_group();
+        edit();
+        m.end_undo_group();
+        const std::vector<std::string> after = m.buf->to_vector();
 
+        REQUIRE(m.undo(24));
+        REQUIRE(m.buf->to_vector() != after);
         REQUIRE(m.redo(24));
-        REQUIRE(m.buf.at(1) == "line two");
+        return m.buf->to_vector() == after;
     };
 
-    SECTION("DelCurrentChar") {
-        m.redo_stack.push(Change(ActionType::DelCurrentChar, m.current_line, m.current_char, '?'));
+    SECTION("Nothing to redo") {
+        REQUIRE_FALSE(m.redo(24));
+    }
 
-        REQUIRE(m.redo(24));
-        REQUIRE(m.buf.at(1) == "lne two");
-    };
+    SECTION("Backspace") {
+        REQUIRE(redoes([&] { std::ignore = m.backspace(); }));
+        REQUIRE(m.buf->at(1) == "ine two");
+    }
 
     SECTION("Newline") {
-        m.redo_stack.push(Change(ActionType::Newline, m.current_line, m.current_char));
-
-        REQUIRE(m.redo(24));
-        REQUIRE(m.buf.at(m.current_line) == "l");
-        REQUIRE(m.buf.at(m.current_line + 1) == "ine two");
-    };
+        REQUIRE(redoes([&] { std::ignore = m.newline(); }));
+        REQUIRE(m.buf->at(1) == "l");
+        REQUIRE(m.buf->at(2) == "ine two");
+    }
 
     SECTION("ToggleCase") {
-        m.redo_stack.push(Change(ActionType::ToggleCase, m.current_line, m.current_char));
-        REQUIRE(m.redo(24));
-        REQUIRE(m.get_current_char() == 'I');
-    };
+        REQUIRE(redoes([&] { m.toggle_case(); }));
+        REQUIRE(m.buf->at(1) == "lIne two");
+    }
 
     SECTION("InsertChar") {
-        REQUIRE(m.buf.at(1) == "line two");
-
-        m.redo_stack.push(Change(ActionType::InsertChar, m.current_line, m.current_char + 1, '?'));
-        REQUIRE(m.redo(24));
-        REQUIRE(m.buf.at(1) == "l?ine two");
-    };
+        REQUIRE(redoes([&] { m.insert('?'); }));
+        REQUIRE(m.buf->at(1) == "l?ine two");
+    }
 
     SECTION("ReplaceChar") {
-        m.replace_char('!');
-        REQUIRE(m.buf.at(1) == "l!ne two");
-
-        m.redo_stack.push(Change(ActionType::ReplaceChar, m.current_line, m.current_char, 'i'));
-
-        REQUIRE(m.redo(24));
-        REQUIRE(m.buf.at(1) == "line two");
-    };
+        REQUIRE(redoes([&] { m.replace_char('!'); }));
+        REQUIRE(m.buf->at(1) == "l!ne two");
+    }
 
     SECTION("DelCurrentLine") {
-        m.undo_stack.push_back(Change(ActionType::DelCurrentLine, 1, 0, "line two"));
-
-        m.delete_current_line();
-        REQUIRE(m.buf.size() == 5);
-        REQUIRE(m.buf.at(1) == "line three");
-
-        REQUIRE(m.undo(24));
-        REQUIRE(m.buf.size() == 6);
-        REQUIRE(m.buf.at(1) == "line two");
-
-        REQUIRE(m.redo(24));
-        REQUIRE(m.buf.size() == 5);
-        REQUIRE(m.buf.at(1) == "line three");
+        REQUIRE(redoes([&] { m.delete_current_line(); }));
+        REQUIRE(m.buf->size() == 5);
+        REQUIRE(m.buf->at(1) == "line three");
     }
 
     SECTION("DelCurrentWord") {
-        m.current_line = 1;
-        m.current_char = 1;
-        m.undo_stack.push_back(Change(ActionType::DelCurrentWord, 1, 0, "line"));
-
-        m.delete_current_word(m.current_word().value());
-        REQUIRE(m.buf.at(1) == " two");
-
-        REQUIRE(m.undo(24));
-        REQUIRE(m.buf.at(1) == "line two");
-
-        REQUIRE(m.redo(24));
-        REQUIRE(m.buf.at(1) == " two");
+        REQUIRE(redoes([&] { m.delete_current_word(m.current_word().value()); }));
+        REQUIRE(m.buf->at(1) == " two");
     }
 
     SECTION("IndentLine") {
-        m.current_line = 0;
-        m.current_char = 0;
-        m.undo_stack.push_back(Change(ActionType::IndentLine, 0, 0));
-
-        m.indent_curr_line();
-        REQUIRE(m.buf.at(m.current_line).at(0) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(1) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(2) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(3) == ' ');
-
-        REQUIRE(m.undo(24));
-        REQUIRE(m.buf.at(m.current_line).at(0) == 'l');
-        REQUIRE(m.buf.at(m.current_line).at(1) == 'i');
-        REQUIRE(m.buf.at(m.current_line).at(2) == 'n');
-        REQUIRE(m.buf.at(m.current_line).at(3) == 'e');
-
-        REQUIRE(m.redo(24));
-        REQUIRE(m.buf.at(m.current_line).at(0) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(1) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(2) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(3) == ' ');
+        REQUIRE(redoes([&] { m.indent_curr_line(); }));
+        REQUIRE(m.buf->at(1) == "    line two");
     }
 
     SECTION("DedentLine") {
-        m.current_line = 0;
-        m.current_char = 0;
         m.indent_curr_line();
-        REQUIRE(m.buf.at(m.current_line).at(0) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(1) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(2) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(3) == ' ');
-
-        m.undo_stack.push_back(Change(ActionType::DedentLine, 0, 0));
-        m.dedent_curr_line();
-        REQUIRE(m.buf.at(m.current_line).at(0) == 'l');
-        REQUIRE(m.buf.at(m.current_line).at(1) == 'i');
-        REQUIRE(m.buf.at(m.current_line).at(2) == 'n');
-        REQUIRE(m.buf.at(m.current_line).at(3) == 'e');
-
-        REQUIRE(m.undo(24));
-        REQUIRE(m.buf.at(m.current_line).at(0) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(1) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(2) == ' ');
-        REQUIRE(m.buf.at(m.current_line).at(3) == ' ');
-
-        REQUIRE(m.redo(24));
-        REQUIRE(m.buf.at(m.current_line).at(0) == 'l');
-        REQUIRE(m.buf.at(m.current_line).at(1) == 'i');
-        REQUIRE(m.buf.at(m.current_line).at(2) == 'n');
-        REQUIRE(m.buf.at(m.current_line).at(3) == 'e');
+        REQUIRE(redoes([&] { m.dedent_curr_line(); }));
+        REQUIRE(m.buf->at(1) == "line two");
     }
 }
 
@@ -660,14 +851,14 @@ TEST_CASE("move_line_down", "[model]") {
     auto m = Model({"line one", "line two", "line three", "", "line four", "line five"}, "");
 
     REQUIRE(m.move_line_down());
-    REQUIRE(m.buf.at(0) == "line two");
-    REQUIRE(m.buf.at(1) == "line one");
+    REQUIRE(m.buf->at(0) == "line two");
+    REQUIRE(m.buf->at(1) == "line one");
 
     m.current_line++;
 
     REQUIRE(m.move_line_down());
-    REQUIRE(m.buf.at(1) == "line three");
-    REQUIRE(m.buf.at(2) == "line one");
+    REQUIRE(m.buf->at(1) == "line three");
+    REQUIRE(m.buf->at(2) == "line one");
 }
 
 TEST_CASE("move_line_up", "[model]") {
@@ -675,14 +866,14 @@ TEST_CASE("move_line_up", "[model]") {
     m.current_line = 5;
 
     REQUIRE(m.move_line_up());
-    REQUIRE(m.buf.at(4) == "line five");
-    REQUIRE(m.buf.at(5) == "line four");
+    REQUIRE(m.buf->at(4) == "line five");
+    REQUIRE(m.buf->at(5) == "line four");
 
     m.current_line--;
 
     REQUIRE(m.move_line_up());
-    REQUIRE(m.buf.at(3) == "line five");
-    REQUIRE(m.buf.at(4) == "");
+    REQUIRE(m.buf->at(3) == "line five");
+    REQUIRE(m.buf->at(4) == "");
 }
 
 TEST_CASE("set_read_only", "[model]") {
@@ -698,8 +889,8 @@ TEST_CASE("set_read_only", "[model]") {
 TEST_CASE("delete_current_line", "[model]") {
     auto m = Model({"line one", "line two", "line three", "", "line four", "line five"}, "");
     m.delete_current_line();
-    REQUIRE(m.buf.size() == 5);
-    REQUIRE(m.buf.at(0) == "line two");
+    REQUIRE(m.buf->size() == 5);
+    REQUIRE(m.buf->at(0) == "line two");
 }
 
 TEST_CASE("current_word", "[model]") {
@@ -721,7 +912,7 @@ TEST_CASE("current_word", "[model]") {
 
         const std::optional<WordPos> ret = m.current_word();
         REQUIRE(ret.has_value());
-        REQUIRE(m.buf.at(m.current_line).at(m.current_char) == 'w');
+        REQUIRE(m.buf->at(m.current_line).at(m.current_char) == 'w');
         REQUIRE(ret.value().text == "two");
         REQUIRE(ret.value().start_pos == 5);
     }
@@ -733,13 +924,13 @@ TEST_CASE("delete_current_word", "[model]") {
     m.current_char = 2;
 
     m.delete_current_word(m.current_word().value());
-    REQUIRE(m.buf.at(1) == " two");
+    REQUIRE(m.buf->at(1) == " two");
 
     m.current_line = 2;
     m.current_char = 7;
 
     m.delete_current_word(m.current_word().value());
-    REQUIRE(m.buf.at(2) == "line ");
+    REQUIRE(m.buf->at(2) == "line ");
 }
 
 TEST_CASE("search_text", "[model]") {
@@ -765,14 +956,37 @@ TEST_CASE("search_and_replace", "[model]") {
          "line seven", "line eight", "line nine", "line ten"},
         "");
     m.search_and_replace("one|TEST");
-    REQUIRE(m.buf.at(0) == "line TEST");
+    REQUIRE(m.buf->at(0) == "line TEST");
+    REQUIRE(m.unsaved);
 
     // multiline flag
+    const std::vector<std::string> before = m.buf->to_vector();
     m.search_and_replace("line|entry|m");
-    for (std::size_t i = 0; i < m.buf.size(); i++) {
+    for (std::size_t i = 0; i < m.buf->size(); i++) {
         if (i == 3) { continue; }
-        REQUIRE(m.buf.at(i).substr(0, 5) == "entry");
+        REQUIRE(m.buf->at(i).substr(0, 5) == "entry");
     }
+    const std::vector<std::string> after = m.buf->to_vector();
+
+    // One change, holding just the lines that were replaced
+    REQUIRE(m.undo_log.size() == 2);
+    const std::string_view record = m.undo_log.record(2);
+    const auto hunks = m.undo_log.hunks(record);
+    REQUIRE(hunks.size() == 2);
+    REQUIRE(hunks[0].first == 0);
+    REQUIRE(hunks[0].before_count == 3);
+    REQUIRE(hunks[1].first == 4);
+    REQUIRE(m.undo_log.lines(record, hunks[1].before, hunks[1].before_count).front() ==
+            "line four");
+
+    REQUIRE(m.undo(24));
+    REQUIRE(m.buf->to_vector() == before);
+    REQUIRE(m.redo(24));
+    REQUIRE(m.buf->to_vector() == after);
+
+    // Nothing to replace is nothing to undo
+    m.search_and_replace("missing|entry|m");
+    REQUIRE(m.undo_log.size() == 2);
 }
 
 TEST_CASE("find_next_str", "[model]") {
@@ -804,11 +1018,11 @@ TEST_CASE("indent_curr_line", "[model]") {
     auto m = Model({"foo", "bar"}, "");
     m.indent_curr_line();
 
-    REQUIRE(m.buf.at(0).size() == 7);
-    REQUIRE(m.buf.at(1).size() == 3);
+    REQUIRE(m.buf->at(0).size() == 7);
+    REQUIRE(m.buf->at(1).size() == 3);
 
-    REQUIRE(m.buf.at(0).at(0) == ' ');
-    REQUIRE(m.buf.at(0).at(4) == 'f');
+    REQUIRE(m.buf->at(0).at(0) == ' ');
+    REQUIRE(m.buf->at(0).at(4) == 'f');
 }
 
 TEST_CASE("dedent_curr_line", "[model]") {
@@ -816,15 +1030,15 @@ TEST_CASE("dedent_curr_line", "[model]") {
 
     // Dedent a line that has some indentation
     m.dedent_curr_line();
-    REQUIRE(m.buf.at(0).size() == 3);
-    REQUIRE(m.buf.at(1).size() == 3);
-    REQUIRE(m.buf.at(0).at(0) == 'f');
+    REQUIRE(m.buf->at(0).size() == 3);
+    REQUIRE(m.buf->at(1).size() == 3);
+    REQUIRE(m.buf->at(0).at(0) == 'f');
 
     // Dedent a line that has no indentation
     m.dedent_curr_line();
-    REQUIRE(m.buf.at(0).size() == 3);
-    REQUIRE(m.buf.at(1).size() == 3);
-    REQUIRE(m.buf.at(0).at(0) == 'f');
+    REQUIRE(m.buf->at(0).size() == 3);
+    REQUIRE(m.buf->at(1).size() == 3);
+    REQUIRE(m.buf->at(0).at(0) == 'f');
 }
 
 TEST_CASE("add_mark", "[model]") {
@@ -860,3 +1074,175 @@ TEST_CASE("go_to_mark", "[model]") {
 
     REQUIRE(!m.go_to_mark('b'));
 }
+
+TEST_CASE("display_col", "[model]") {
+    auto m = Model({"\tfoo", "ab\tc", "bar"}, "");
+
+    REQUIRE(m.display_col(0, 0) == 0);
+    REQUIRE(m.display_col(0, 1) == 4);
+    REQUIRE(m.display_col(1, 3) == 4);
+    REQUIRE(m.display_col(1, 6) == 7);
+    REQUIRE(m.display_col(2, 2) == 2);
+
+    SECTION("Kept until the line changes") {
+        REQUIRE(m.display_col(1, 3) == 4);
+        REQUIRE(m.columns.line == 1);
+
+        m.current_line = 1;
+        m.current_char = 0;
+        m.insert('\t');
+        REQUIRE(m.display_col(1, 4) == 8);
+        REQUIRE(m.columns.version == m.version);
+    }
+}
+
+TEST_CASE("line_ref", "[model]") {
+    auto m = Model({"  foo", "", "bar"}, "");
+    m.set_backend(Backend::PieceTable);
+
+    REQUIRE(m.line_ref(0).indent() == 2);
+    REQUIRE(m.line_ref(1).blank());
+
+    // The line being typed into is checked as it is now
+    m.start_typing();
+    m.current_line = 1;
+    m.insert('x');
+    REQUIRE(m.line_ref(1).text() == "x");
+    REQUIRE_FALSE(m.line_ref(1).blank());
+}
+
+TEST_CASE("offset_of", "[model]") {
+    auto m = Model({"foo", "", "bar baz"}, "");
+    REQUIRE(m.offset_of(2) == 5);
+    REQUIRE(m.line_at(6) == 2);
+    REQUIRE(m.offset_index().bytes() == 13);
+
+    // Kept up to date by every edit once it's built
+    m.current_line = 0;
+    m.current_char = 3;
+    m.insert('!');
+    std::ignore = m.newline();
+    m.current_line = 3;
+    m.delete_current_line();
+
+    m.start_typing();
+    m.current_line = 2;
+    m.current_char = 0;
+    m.insert('x');
+    m.insert('y');
+
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < m.line_count(); i++) {
+        REQUIRE(m.offset_of(i) == offset);
+        offset += m.line(i).size() + 1;
+    }
+    REQUIRE(m.offset_index().bytes() == offset);
+}
+
+TEST_CASE("mark_dirty", "[model]") {
+    auto m = Model({"foo", "bar", "baz"}, "");
+    REQUIRE(m.dirty_from == std::string::npos);
+
+    m.current_line = 2;
+    m.insert('x');
+    REQUIRE(m.dirty_from == 2);
+    REQUIRE(m.dirty_lines.test(2));
+    REQUIRE(!m.dirty_lines.test(1));
+
+    m.current_line = 1;
+    m.current_char = 0;
+    std::ignore = m.backspace();
+    REQUIRE(m.dirty_from == 0);
+
+    // Joining the lines moves the edited line up one
+    REQUIRE(m.dirty_lines.test(0));
+    REQUIRE(m.dirty_lines.test(1));
+    REQUIRE(!m.dirty_lines.test(2));
+}
+
+TEST_CASE("replay", "[model]") {
+    const std::string filename = "tests/fixture/temp_journal_file.txt";
+    {
+        std::ofstream out(filename);
+        out << "foo\nbar\nbaz\n";
+    }
+
+    auto m = Model({"foo", "bar", "baz"}, filename);
+    m.insert('x');
+    m.current_line = 1;
+    m.current_char = 3;
+    std::ignore = m.newline();
+    m.current_line = 3;
+    m.delete_current_line();
+    REQUIRE(m.journal != nullptr);
+    m.journal->sync();
+
+    const auto entries = read_journal(filename);
+    REQUIRE(entries.has_value());
+
+    auto recovered = Model({"foo", "bar", "baz"}, filename);
+    REQUIRE(recovered.replay(entries.value()));
+    REQUIRE(*recovered.buf == *m.buf);
+    REQUIRE(recovered.unsaved);
+
+    SECTION("Undone in one step") {
+        REQUIRE(recovered.undo_log.current == 1);
+        std::ignore = recovered.undo(24);
+        REQUIRE(recovered.buf->to_vector() == std::vector<std::string> {"foo", "bar", "baz"});
+        REQUIRE_FALSE(recovered.unsaved);
+
+        std::ignore = recovered.go_to_state(1, 24);
+        REQUIRE(*recovered.buf == *m.buf);
+    }
+
+    SECTION("Out of range edits") {
+        auto shorter = Model({"foo"}, "");
+        REQUIRE(!shorter.replay({JournalEntry {JournalOp::EraseLine, 5}}));
+    }
+
+    std::filesystem::remove(filename);
+}
+
+TEST_CASE("discard_journal", "[model]") {
+    namespace fs = std::filesystem;
+    const std::string filename = "tests/fixture/temp_journal_file.txt";
+    {
+        std::ofstream out(filename);
+        out << "foo\nbar\n";
+    }
+
+    // Left behind by a crash
+    {
+        auto crashed = Model({"foo", "bar"}, filename);
+        crashed.insert('x');
+        crashed.journal->sync();
+        fs::copy_file(journal_path(filename), filename + ".kept");
+    }
+    fs::rename(filename + ".kept", journal_path(filename));
+
+    auto m = Model({"foo", "bar"}, filename);
+
+    SECTION("Editing without recovering keeps it") {
+        m.current_line = 1;
+        m.insert('y');
+        REQUIRE(m.journal->fd == -1);
+        REQUIRE(read_journal(filename).value().at(0).text == "xfoo");
+
+        // until it's discarded, when this buffer's edits take its place
+        m.discard_journal();
+        REQUIRE(m.journal->fd != -1);
+        const auto entries = read_journal(filename);
+        REQUIRE(entries.value().size() == 1);
+        REQUIRE(entries.value().at(0).text == "ybar");
+    }
+
+    SECTION("Discarded before any edit") {
+        m.discard_journal();
+        REQUIRE(!fs::exists(journal_path(filename)));
+
+        m.insert('y');
+        REQUIRE(m.journal->fd != -1);
+    }
+
+    fs::remove(filename);
+}
@@ -0,0 +1,144 @@
+#include "offset_index.h"
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+    // Where each line starts, the slow way
+    std::vector<std::size_t> starts(const std::vector<std::size_t>& lengths) {
+        std::vector<std::size_t> ret = {0};
+        for (const std::size_t length : lengths) {
+            ret.push_back(ret.back() + length + 1);
+        }
+        return ret;
+    }
+
+    bool matches(const OffsetIndex& index, const std::vector<std::size_t>& lengths) {
+        const std::vector<std::size_t> expected = starts(lengths);
+        if (index.size() != lengths.size()) { return false; }
+
+        for (std::size_t i = 0; i < lengths.size(); i++) {
+            if (index.offset_of(i) != expected.at(i)) { return false; }
+            if (index.line_at(expected.at(i)) != i) { return false; }
+            if (index.line_at(expected.at(i + 1) - 1) != i) { return false; }
+        }
+
+        return index.bytes() == expected.back();
+    }
+}  // namespace
+
+TEST_CASE("OffsetIndex", "[offset_index]") {
+    SECTION("Offsets count every newline") {
+        const OffsetIndex index({3, 0, 5});
+        REQUIRE(index.offset_of(0) == 0);
+        REQUIRE(index.offset_of(1) == 4);
+        REQUIRE(index.offset_of(2) == 5);
+        REQUIRE(index.bytes() == 11);
+
+        REQUIRE(index.line_at(3) == 0);
+        REQUIRE(index.line_at(4) == 1);
+        REQUIRE(index.line_at(10) == 2);
+        REQUIRE_THROWS_AS(index.line_at(11), std::out_of_range);
+        REQUIRE_THROWS_AS(index.offset_of(4), std::out_of_range);
+    }
+
+    SECTION("Empty") {
+        OffsetIndex index = {};
+        REQUIRE(index.bytes() == 0);
+        REQUIRE_THROWS_AS(index.line_at(0), std::out_of_range);
+
+        index.insert(0, 3);
+        REQUIRE(index.bytes() == 4);
+        REQUIRE(index.line_at(3) == 0);
+    }
+
+    SECTION("Changing a line's length") {
+        OffsetIndex index({1, 2, 3, 4, 5});
+        REQUIRE(index.bytes() == 20);
+
+        index.set(1, 10);
+        REQUIRE(matches(index, {1, 10, 3, 4, 5}));
+    }
+
+    SECTION("Adding and removing lines") {
+        OffsetIndex index({1, 2, 3, 4, 5});
+        REQUIRE(index.bytes() == 20);
+
+        index.insert(3, 7);
+        index.erase(4);
+        REQUIRE(matches(index, {1, 2, 3, 7, 5}));
+
+        // A removed line's node is used again
+        REQUIRE(index.nodes.size() == 6);
+        index.insert(0, 0);
+        REQUIRE(index.nodes.size() == 6);
+        REQUIRE(matches(index, {0, 1, 2, 3, 7, 5}));
+    }
+
+    SECTION("Offsets are right after every insert and delete") {
+        std::vector<std::size_t> lengths(5000, 10);
+        OffsetIndex index(lengths);
+        std::mt19937 rng(7);
+
+        for (int i = 0; i < 1000; i++) {
+            const std::size_t idx = rng() % lengths.size();
+
+            if (i % 2 == 0) {
+                const std::size_t length = rng() % 100;
+                index.insert(idx, length);
+                lengths.insert(lengths.begin() + std::ptrdiff_t(idx), length);
+            } else {
+                index.erase(idx);
+                lengths.erase(lengths.begin() + std::ptrdiff_t(idx));
+            }
+
+            const std::vector<std::size_t> expected = starts(lengths);
+            const std::size_t check = rng() % lengths.size();
+            REQUIRE(index.offset_of(idx) == expected.at(idx));
+            REQUIRE(index.offset_of(check) == expected.at(check));
+            REQUIRE(index.line_at(expected.at(check)) == check);
+            REQUIRE(index.bytes() == expected.back());
+        }
+
+        REQUIRE(matches(index, lengths));
+    }
+
+    SECTION("Matches a vector through random edits") {
+        std::vector<std::size_t> lengths(1000, 10);
+        OffsetIndex index(lengths);
+        std::mt19937 rng(42);
+
+        for (int i = 0; i < 2000; i++) {
+            const std::size_t idx = rng() % (lengths.size() + 1);
+            const std::size_t length = rng() % 100;
+
+            switch (rng() % 3) {
+                case 0:
+                    index.insert(idx, length);
+                    lengths.insert(lengths.begin() + std::ptrdiff_t(idx), length);
+                    break;
+                case 1:
+                    if (idx == lengths.size()) { break; }
+                    index.erase(idx);
+                    lengths.erase(lengths.begin() + std::ptrdiff_t(idx));
+                    break;
+                default:
+                    if (idx == lengths.size()) { break; }
+                    index.set(idx, length);
+                    lengths.at(idx) = length;
+            }
+
+            // Ask now and then, so some edits land on a fresh tree
+            if (i % 50 == 0) {
+                const std::size_t mid = lengths.size() / 2;
+                REQUIRE(index.offset_of(mid) == starts(lengths).at(mid));
+            }
+        }
+
+        REQUIRE(matches(index, lengths));
+    }
+}
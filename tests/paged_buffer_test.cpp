@@ -0,0 +1,61 @@
+#include "paged_buffer.h"
+
+#include <memory>
+#include <stdexcept>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "model.h"
+#include "text_io.h"
+
+TEST_CASE("PagedBuffer", "[paged_buffer]") {
+    const std::string file = "tests/fixture/lorem_ipsum.txt";
+    const lines_t expected = open_file(file).value();
+
+    SECTION("Matches the fully loaded file") {
+        // Small pages so the file spans more pages than the cache holds
+        const PagedBuffer pages(MappedFile(file), 256);
+        REQUIRE(pages.pages.size() > PAGE_CACHE_SIZE);
+        REQUIRE(pages.size() == expected.size());
+
+        for (std::size_t i = 0; i < expected.size(); i++) {
+            REQUIRE(pages.at(i) == expected.at(i));
+        }
+
+        // Then backwards, to hit pages that have been dropped
+        for (std::size_t i = expected.size(); i > 0; i--) {
+            REQUIRE(pages.at(i - 1) == expected.at(i - 1));
+        }
+
+        REQUIRE(pages.cache.size() == PAGE_CACHE_SIZE);
+    }
+
+    SECTION("Pages start on a line") {
+        const PagedBuffer pages(MappedFile(file), 256);
+        for (const Page& p : pages.pages) {
+            REQUIRE((p.offset == 0 || pages.mapping.data[p.offset - 1] == '\n'));
+            REQUIRE(pages.page_of(p.first_line) == std::size_t(&p - pages.pages.data()));
+        }
+    }
+
+    SECTION("Final line without a newline") {
+        const PagedBuffer pages(MappedFile("tests/fixture/no_newline_file.txt"));
+        REQUIRE(pages.size() == 1);
+        REQUIRE(pages.at(0) == "hello");
+        REQUIRE_THROWS_AS(pages.at(1), std::out_of_range);
+    }
+
+    SECTION("Small files aren't paged") {
+        REQUIRE(open_file_paged(file) == nullptr);
+        REQUIRE(open_file_paged("tests/fixture/does_not_exist.txt") == nullptr);
+    }
+
+    SECTION("Backing a model") {
+        auto m = Model(std::make_unique<PagedBuffer>(MappedFile(file), 256), file);
+        REQUIRE(m.readonly);
+        REQUIRE_THROWS_AS(m.buf->edit(0), std::logic_error);
+        REQUIRE(m.line_count() == expected.size());
+        REQUIRE(m.line(3) == expected.at(3));
+        REQUIRE(m.search_text("Lorem").size() > 0);
+    }
+}
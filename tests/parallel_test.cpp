@@ -0,0 +1,27 @@
+#include "parallel.h"
+
+#include <atomic>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("parallel_for", "[parallel]") {
+    SECTION("Every index is visited once") {
+        std::vector<int> visits(1000, 0);
+        parallel_for(visits.size(), [&](std::size_t idx) { visits.at(idx)++; });
+
+        for (const int count : visits) {
+            REQUIRE(count == 1);
+        }
+    }
+
+    SECTION("No work") {
+        std::atomic<int> calls = 0;
+        parallel_for(0, [&](std::size_t) { calls++; });
+        REQUIRE(calls == 0);
+    }
+}
+
+TEST_CASE("worker_count", "[parallel]") {
+    REQUIRE(worker_count() >= 1);
+}
@@ -0,0 +1,287 @@
+#include "piece_table.h"
+
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+    std::vector<std::string> numbered_lines(std::size_t count) {
+        std::vector<std::string> ret = {};
+        ret.reserve(count);
+        for (std::size_t i = 0; i < count; i++) {
+            ret.push_back("line " + std::to_string(i));
+        }
+        return ret;
+    }
+
+    bool matches(const PieceTable& table, const std::vector<std::string>& expected) {
+        if (table.size() != expected.size()) { return false; }
+        for (std::size_t i = 0; i < expected.size(); i++) {
+            if (table.at(i) != expected.at(i)) { return false; }
+        }
+        return true;
+    }
+}  // namespace
+
+TEST_CASE("PieceTable", "[piece_table]") {
+    SECTION("Starts as one piece") {
+        const PieceTable table(numbered_lines(10));
+        REQUIRE(table.size() == 10);
+        REQUIRE(table.piece_count() == 1);
+        REQUIRE(table.at(9) == "line 9");
+        REQUIRE_THROWS_AS(table.at(10), std::out_of_range);
+    }
+
+    SECTION("Empty") {
+        PieceTable table({});
+        REQUIRE(table.empty());
+        REQUIRE(table.piece_count() == 0);
+
+        table.insert(0, "foo");
+        REQUIRE(table.size() == 1);
+        REQUIRE(table.at(0) == "foo");
+    }
+
+    SECTION("Insert splits the piece it lands in") {
+        PieceTable table(numbered_lines(10));
+        table.insert(4, "new");
+
+        REQUIRE(table.size() == 11);
+        REQUIRE(table.piece_count() == 3);
+        REQUIRE(table.at(3) == "line 3");
+        REQUIRE(table.at(4) == "new");
+        REQUIRE(table.at(5) == "line 4");
+
+        // The file's own lines are never copied
+        REQUIRE(table.edited.size() == 1);
+    }
+
+    SECTION("Erase") {
+        PieceTable table(numbered_lines(10));
+        table.erase(0);
+        table.erase(8);
+        table.erase(3);
+
+        REQUIRE(matches(
+            table, {"line 1", "line 2", "line 3", "line 5", "line 6", "line 7", "line 8"}));
+        REQUIRE_THROWS_AS(table.erase(7), std::out_of_range);
+    }
+
+    SECTION("Editing a line only copies it the first time") {
+        PieceTable table(numbered_lines(10));
+        table.edit(5).push_back('a');
+        table.edit(5).push_back('b');
+
+        REQUIRE(table.at(5) == "line 5ab");
+        REQUIRE(table.edited.size() == 1);
+        REQUIRE(table.blocks.at(0).at(5).text() == "line 5");
+
+        table.set(5, "foo");
+        REQUIRE(table.at(5) == "foo");
+        REQUIRE(table.edited.size() == 1);
+    }
+
+    SECTION("Append adds a block") {
+        PieceTable table(numbered_lines(2));
+        table.append({"foo", "bar"});
+        table.append({});
+
+        REQUIRE(table.blocks.size() == 2);
+        REQUIRE(matches(table, {"line 0", "line 1", "foo", "bar"}));
+    }
+
+    SECTION("Loaded lines are packed into the arena") {
+        PieceTable table(numbered_lines(10'000));
+        REQUIRE(table.arena.slabs.size() == 1);
+        REQUIRE(table.at(1).data() == table.at(0).data() + table.at(0).size());
+
+        LineArena more = {};
+        std::vector<LineRef> lines = {LineRef(more.store("foo")), LineRef(more.store("  "))};
+        table.adopt(std::move(more), std::move(lines));
+
+        REQUIRE(table.arena.slabs.size() == 2);
+        REQUIRE(table.size() == 10'002);
+        REQUIRE(table.at(10'001) == "  ");
+        REQUIRE(table.line_ref(10'001).blank());
+
+        // Edited lines are looked at again
+        table.edit(10'001) += "x";
+        REQUIRE_FALSE(table.line_ref(10'001).blank());
+        REQUIRE(table.line_ref(10'001).indent() == 2);
+    }
+
+    SECTION("Matches a vector through random edits") {
+        std::vector<std::string> expected = numbered_lines(500);
+        PieceTable table(expected);
+        std::mt19937 rng(42);
+
+        for (int i = 0; i < 2000; i++) {
+            const std::size_t idx = rng() % (expected.size() + 1);
+            const std::string text = "edit " + std::to_string(i);
+
+            switch (rng() % 4) {
+                case 0:
+                    table.insert(idx, text);
+                    expected.insert(expected.begin() + std::ptrdiff_t(idx), text);
+                    break;
+                case 1:
+                    if (idx == expected.size()) { break; }
+                    table.erase(idx);
+                    expected.erase(expected.begin() + std::ptrdiff_t(idx));
+                    break;
+                case 2:
+                    if (idx == expected.size()) { break; }
+                    table.set(idx, text);
+                    expected.at(idx) = text;
+                    break;
+                default:
+                    if (idx == expected.size()) { break; }
+                    table.edit(idx) += "!";
+                    expected.at(idx) += "!";
+            }
+        }
+
+        REQUIRE(matches(table, expected));
+    }
+
+    SECTION("Kept states don't see later edits") {
+        PieceTable table(numbered_lines(1000));
+        table.set(10, "edited");
+        const std::vector<std::string> before = table.to_vector();
+        const auto state = table.keep_state();
+        REQUIRE(state != nullptr);
+
+        // Edited lines in the state are copied before they're changed again
+        table.edit(10) += "!";
+        table.set(10, "again");
+        REQUIRE(table.edited.size() == 2);
+        table.erase(500);
+        table.insert(600, "new");
+
+        const std::vector<LineSpan> spans = table.restore_state(*state);
+        REQUIRE(table.to_vector() == before);
+
+        REQUIRE(spans.size() == 3);
+        REQUIRE(spans[0].first == 10);
+        REQUIRE(spans[0].removed == 1);
+        REQUIRE(spans[0].added == 1);
+        REQUIRE(spans[1].first == 500);
+        REQUIRE(spans[1].removed == 0);
+        REQUIRE(spans[1].added == 1);
+        REQUIRE(spans[2].first == 601);
+        REQUIRE(spans[2].removed == 1);
+        REQUIRE(spans[2].added == 0);
+    }
+
+    SECTION("Spans turn one state into another through random edits") {
+        PieceTable table(numbered_lines(300));
+        std::vector<std::vector<std::string>> kept = {};
+        std::vector<std::shared_ptr<const BufferState>> states = {};
+        std::mt19937 rng(7);
+
+        for (int i = 0; i < 600; i++) {
+            if (i % 50 == 0) {
+                kept.push_back(table.to_vector());
+                states.push_back(table.keep_state());
+            }
+
+            const std::size_t idx = rng() % table.size();
+            switch (rng() % 3) {
+                case 0:
+                    table.insert(idx, "edit " + std::to_string(i));
+                    break;
+                case 1:
+                    table.erase(idx);
+                    break;
+                default:
+                    table.edit(idx) += "!";
+            }
+
+            if (i % 70 == 0) {
+                const std::size_t which = rng() % states.size();
+                std::vector<std::string> lines = table.to_vector();
+
+                for (const LineSpan& span : table.restore_state(*states.at(which))) {
+                    const auto first = lines.begin() + std::ptrdiff_t(span.first);
+                    lines.erase(first, first + std::ptrdiff_t(span.removed));
+                    lines.insert(
+                        lines.begin() + std::ptrdiff_t(span.first),
+                        kept.at(which).begin() + std::ptrdiff_t(span.first),
+                        kept.at(which).begin() + std::ptrdiff_t(span.first + span.added));
+                }
+
+                REQUIRE(lines == kept.at(which));
+                REQUIRE(matches(table, kept.at(which)));
+            }
+        }
+    }
+}
+
+// Run with `./run.py test "[!benchmark]"`
+TEST_CASE("Benchmark line inserts and erases", "[!benchmark][piece_table]") {
+    const std::size_t count = 1'000'000;
+
+    BENCHMARK_ADVANCED("vector: 1000 new lines mid-file")(Catch::Benchmark::Chronometer meter) {
+        VectorBuffer buf(numbered_lines(count));
+        meter.measure([&] {
+            for (std::size_t i = 0; i < 1000; i++) {
+                buf.insert(count / 2 + i, "");
+            }
+            return buf.size();
+        });
+    };
+
+    BENCHMARK_ADVANCED("piece table: 1000 new lines mid-file")
+    (Catch::Benchmark::Chronometer meter) {
+        PieceTable buf(numbered_lines(count));
+        meter.measure([&] {
+            for (std::size_t i = 0; i < 1000; i++) {
+                buf.insert(count / 2 + i, "");
+            }
+            return buf.size();
+        });
+    };
+
+    BENCHMARK_ADVANCED("vector: 1000 deleted lines mid-file")
+    (Catch::Benchmark::Chronometer meter) {
+        VectorBuffer buf(numbered_lines(count));
+        meter.measure([&] {
+            for (std::size_t i = 0; i < 1000; i++) {
+                buf.erase(count / 4);
+            }
+            return buf.size();
+        });
+    };
+
+    BENCHMARK_ADVANCED("piece table: 1000 deleted lines mid-file")
+    (Catch::Benchmark::Chronometer meter) {
+        PieceTable buf(numbered_lines(count));
+        meter.measure([&] {
+            for (std::size_t i = 0; i < 1000; i++) {
+                buf.erase(count / 4);
+            }
+            return buf.size();
+        });
+    };
+
+    const PieceTable edited = [&] {
+        PieceTable buf(numbered_lines(count));
+        for (std::size_t i = 0; i < 10'000; i++) {
+            buf.insert((i * 7919) % buf.size(), "");
+        }
+        return buf;
+    }();
+    BENCHMARK("piece table: read every line after 10k edits") {
+        std::size_t bytes = 0;
+        for (std::size_t i = 0; i < edited.size(); i++) {
+            bytes += edited.at(i).size();
+        }
+        return bytes;
+    };
+}
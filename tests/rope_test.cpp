@@ -0,0 +1,282 @@
+#include "rope.h"
+
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "change.h"
+#include "controller.h"
+#include "model.h"
+
+namespace {
+    std::vector<std::string> numbered_lines(std::size_t count) {
+        std::vector<std::string> ret = {};
+        ret.reserve(count);
+        for (std::size_t i = 0; i < count; i++) {
+            ret.push_back("line " + std::to_string(i));
+        }
+        return ret;
+    }
+
+    // How deep the tree is, and whether every leaf is at that depth
+    std::size_t depth(const RopeNode& node) {
+        if (node.leaf()) { return 1; }
+
+        const std::size_t first = depth(*node.children.front());
+        for (const auto& child : node.children) {
+            if (depth(*child) != first) { return 0; }
+        }
+        return first + 1;
+    }
+}  // namespace
+
+TEST_CASE("Rope", "[rope]") {
+    SECTION("Lines are found through the tree") {
+        const Rope rope(numbered_lines(10'000));
+        REQUIRE(rope.size() == 10'000);
+        REQUIRE(rope.at(0) == "line 0");
+        REQUIRE(rope.at(6789) == "line 6789");
+        REQUIRE(depth(*rope.root) == 3);
+        REQUIRE_THROWS_AS(rope.at(10'000), std::out_of_range);
+    }
+
+    SECTION("Empty") {
+        Rope rope({});
+        REQUIRE(rope.empty());
+        REQUIRE(rope.bytes() == 0);
+
+        rope.insert(0, "foo");
+        REQUIRE(rope.size() == 1);
+        REQUIRE(rope.at(0) == "foo");
+    }
+
+    SECTION("Counts") {
+        // "é" is two bytes and one codepoint
+        const Rope rope({"café", "", "\tfoo"});
+        REQUIRE(rope.bytes() == 5 + 1 + 0 + 1 + 4 + 1);
+        REQUIRE(rope.codepoints() == 4 + 1 + 0 + 1 + 4 + 1);
+    }
+
+    SECTION("Line to offset and back") {
+        const std::vector<std::string> lines = numbered_lines(5000);
+        const Rope rope(lines);
+
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < lines.size(); i++) {
+            REQUIRE(rope.offset_of(i) == offset);
+            REQUIRE(rope.line_at(offset) == i);
+            REQUIRE(rope.line_at(offset + lines.at(i).size()) == i);
+            offset += lines.at(i).size() + 1;
+        }
+
+        REQUIRE(rope.offset_of(lines.size()) == rope.bytes());
+        REQUIRE_THROWS_AS(rope.line_at(rope.bytes()), std::out_of_range);
+    }
+
+    SECTION("Edited lines are put back before the tree is used") {
+        Rope rope(numbered_lines(100));
+        rope.edit(50) += "!";
+        rope.edit(50) += "!";
+
+        REQUIRE(rope.at(50) == "line 50!!");
+        REQUIRE(rope.checked_out == 50);
+        REQUIRE(rope.bytes() == Rope(rope.to_vector()).bytes());
+        REQUIRE(rope.checked_out == std::string::npos);
+        REQUIRE(rope.at(50) == "line 50!!");
+    }
+
+    SECTION("Snapshots don't see later edits") {
+        Rope rope(numbered_lines(1000));
+        const RopeRef before = rope.snapshot();
+
+        rope.set(10, "changed");
+        rope.erase(500);
+        rope.edit(0).clear();
+
+        REQUIRE(rope_line(before, 10) == "line 10");
+        REQUIRE(rope_line(before, 500) == "line 500");
+        REQUIRE(rope_line(before, 0) == "line 0");
+
+        // Only the leaves that changed were copied
+        const RopeRef after = rope.snapshot();
+        REQUIRE(after->children.back() == before->children.back());
+
+        rope.restore(before);
+        REQUIRE(rope.size() == 1000);
+        REQUIRE(rope.at(500) == "line 500");
+    }
+
+    SECTION("Diffing snapshots") {
+        Rope rope(numbered_lines(1000));
+        const RopeRef before = rope.snapshot();
+        REQUIRE(rope_diff(before, before).empty());
+
+        rope.set(10, "changed");
+        rope.splice(600, 2, {"a", "b", "c"});
+        const std::vector<LineSpan> spans = rope_diff(before, rope.snapshot());
+
+        // Just the leaves around each edit, in the lines of the newer rope
+        REQUIRE(spans.size() == 2);
+        REQUIRE(spans[0].first <= 10);
+        REQUIRE(spans[0].first + spans[0].added > 10);
+        REQUIRE(spans[0].removed == spans[0].added);
+        REQUIRE(spans[1].first <= 600);
+        REQUIRE(spans[1].first + spans[1].added >= 603);
+        REQUIRE(spans[1].added == spans[1].removed + 1);
+        REQUIRE(spans[1].added < 100);
+    }
+
+    SECTION("Splice") {
+        Rope rope(numbered_lines(1000));
+        rope.splice(100, 800, numbered_lines(10'000));
+
+        REQUIRE(rope.size() == 10'200);
+        REQUIRE(rope.at(99) == "line 99");
+        REQUIRE(rope.at(100) == "line 0");
+        REQUIRE(rope.at(10'099) == "line 9999");
+        REQUIRE(rope.at(10'100) == "line 900");
+        REQUIRE(depth(*rope.root) != 0);
+
+        rope.splice(0, rope.size(), {});
+        REQUIRE(rope.empty());
+        REQUIRE_THROWS_AS(rope.splice(0, 1, {}), std::out_of_range);
+    }
+
+    SECTION("Matches a vector through random edits") {
+        std::vector<std::string> expected = numbered_lines(3000);
+        Rope rope(expected);
+        std::mt19937 rng(42);
+
+        for (int i = 0; i < 3000; i++) {
+            const std::size_t idx = rng() % (expected.size() + 1);
+            const std::string text = "edit " + std::to_string(i);
+
+            switch (rng() % 5) {
+                case 0:
+                    rope.insert(idx, text);
+                    expected.insert(expected.begin() + std::ptrdiff_t(idx), text);
+                    break;
+                case 1:
+                    if (idx == expected.size()) { break; }
+                    rope.erase(idx);
+                    expected.erase(expected.begin() + std::ptrdiff_t(idx));
+                    break;
+                case 2:
+                    if (idx == expected.size()) { break; }
+                    rope.set(idx, text);
+                    expected.at(idx) = text;
+                    break;
+                case 3: {
+                    const std::size_t count =
+                        std::min<std::size_t>(rng() % 200, expected.size() - idx);
+                    const auto start = expected.begin() + std::ptrdiff_t(idx);
+                    expected.erase(start, start + std::ptrdiff_t(count));
+                    expected.insert(expected.begin() + std::ptrdiff_t(idx), 150, text);
+                    rope.splice(idx, count, std::vector<std::string>(150, text));
+                } break;
+                default:
+                    if (idx == expected.size()) { break; }
+                    rope.edit(idx) += "!";
+                    expected.at(idx) += "!";
+            }
+        }
+
+        REQUIRE(rope.to_vector() == expected);
+        REQUIRE(depth(*rope.root) != 0);
+    }
+
+    SECTION("Selected per model") {
+        auto m = Model(std::vector<std::string> {"foo", "bar"}, "");
+        m.set_backend(Backend::Rope);
+        REQUIRE(dynamic_cast<Rope*>(m.buf.get()) != nullptr);
+
+        m.current_line = 1;
+        m.current_char = 3;
+        std::ignore = m.newline();
+        m.insert('x');
+        REQUIRE(m.buf->to_vector() == std::vector<std::string> {"foo", "bar", "x "});
+    }
+}
+
+// The model_test scenarios that add or remove whole lines, on a buffer of
+// millions of lines in each backend. Run with `./run.py test "[!benchmark]"`
+TEST_CASE("Benchmark backends", "[!benchmark][rope]") {
+    const std::vector<std::string> lines = numbered_lines(2'000'000);
+
+    for (const auto& [name, backend] : std::vector<std::pair<std::string, Backend>> {
+             {"vector", Backend::Vector},
+             {"piece table", Backend::PieceTable},
+             {"rope", Backend::Rope}}) {
+        BENCHMARK_ADVANCED("newline mid-file: " + name)(Catch::Benchmark::Chronometer meter) {
+            auto m = Model(lines, "");
+            m.set_backend(backend);
+            m.current_line = 1'000'000;
+            m.current_char = 2;
+            meter.measure([&] { return m.newline(); });
+        };
+
+        BENCHMARK_ADVANCED("backspace join mid-file: " + name)
+        (Catch::Benchmark::Chronometer meter) {
+            auto m = Model(lines, "");
+            m.set_backend(backend);
+            meter.measure([&] {
+                m.current_line = 1'000'000;
+                m.current_char = 0;
+                return m.backspace().count;
+            });
+        };
+
+        BENCHMARK_ADVANCED("delete_current_line mid-file: " + name)
+        (Catch::Benchmark::Chronometer meter) {
+            auto m = Model(lines, "");
+            m.set_backend(backend);
+            meter.measure([&] {
+                m.current_line = 1'000'000;
+                m.delete_current_line();
+                return m.current_line;
+            });
+        };
+
+        BENCHMARK_ADVANCED("undo DelCurrentLine mid-file: " + name)
+        (Catch::Benchmark::Chronometer meter) {
+            auto m = Model(lines, "");
+            m.set_backend(backend);
+            meter.measure([&] {
+                m.current_line = 1'000'000;
+                std::ignore = m.undo_log.append(Change {{Hunk {m.current_line, {"foo"}, {}}}}, 0);
+                return m.undo(24);
+            });
+        };
+
+        BENCHMARK_ADVANCED("type a line mid-file: " + name)(Catch::Benchmark::Chronometer meter) {
+            auto m = Model(lines, "");
+            m.set_backend(backend);
+            m.current_line = 1'000'000;
+            meter.measure([&] {
+                for (const char c : std::string("hello world")) {
+                    m.insert(c);
+                }
+                return m.current_char;
+            });
+        };
+
+        BENCHMARK_ADVANCED("read every line: " + name)(Catch::Benchmark::Chronometer meter) {
+            auto m = Model(lines, "");
+            m.set_backend(backend);
+            meter.measure([&] {
+                std::size_t bytes = 0;
+                for (std::size_t i = 0; i < m.line_count(); i++) {
+                    bytes += m.line(i).size();
+                }
+                return bytes;
+            });
+        };
+    }
+}
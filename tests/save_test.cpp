@@ -0,0 +1,129 @@
+#include "save.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace {
+    std::string read_all(const std::string& path) {
+        std::ifstream in(path);
+        std::stringstream ss;
+        ss << in.rdbuf();
+        return ss.str();
+    }
+}  // namespace
+
+TEST_CASE("atomic_write", "[save]") {
+    namespace fs = std::filesystem;
+    const std::string path = "tests/fixture/temp_save_file.txt";
+    const std::vector<std::string> lines = {"foo", "\tbar", "", "baz"};
+    auto source = [&](std::size_t idx) { return std::string_view(lines.at(idx)); };
+
+    SECTION("New file") {
+        fs::remove(path);
+        const auto written = atomic_write(path, lines.size(), source);
+
+        REQUIRE(written.has_value());
+        REQUIRE(written.value().bytes == 14);
+        REQUIRE(read_all(path) == "foo\n\tbar\n\nbaz\n");
+        REQUIRE(written.value().hash == content_hash(read_all(path)));
+    }
+
+    SECTION("Replaces the file and keeps its permissions") {
+        {
+            std::ofstream out(path);
+            out << "old contents that are longer than the new ones\n";
+        }
+        fs::permissions(path, fs::perms::owner_read | fs::perms::owner_write);
+
+        REQUIRE(atomic_write(path, lines.size(), source).has_value());
+        REQUIRE(read_all(path) == "foo\n\tbar\n\nbaz\n");
+        REQUIRE(
+            (fs::status(path).permissions() & fs::perms::all) ==
+            (fs::perms::owner_read | fs::perms::owner_write));
+    }
+
+    SECTION("No temp file left behind") {
+        REQUIRE(atomic_write(path, lines.size(), source).has_value());
+        for (const auto& entry : fs::directory_iterator("tests/fixture")) {
+            REQUIRE_FALSE(entry.path().filename().string().contains(".iris-"));
+        }
+    }
+
+    SECTION("Writes through a symlink") {
+        const std::string link = "tests/fixture/temp_save_link.txt";
+        fs::remove(link);
+        std::ofstream(path) << "old\n";
+        fs::create_symlink("temp_save_file.txt", link);
+
+        REQUIRE(atomic_write(link, lines.size(), source).has_value());
+        REQUIRE(fs::is_symlink(link));
+        REQUIRE(read_all(path) == "foo\n\tbar\n\nbaz\n");
+        fs::remove(link);
+    }
+
+    SECTION("Lines bigger than the write buffer") {
+        const std::vector<std::string> big = {"a", std::string(3 * 1024 * 1024, 'x'), "b"};
+        const auto written = atomic_write(
+            path, big.size(), [&](std::size_t idx) { return std::string_view(big.at(idx)); });
+
+        REQUIRE(written.value().bytes == big.at(1).size() + 5);
+        REQUIRE(read_all(path) == "a\n" + big.at(1) + "\nb\n");
+        REQUIRE(written.value().hash == content_hash(read_all(path)));
+    }
+
+    SECTION("Rewrite from an offset") {
+        {
+            std::ofstream out(path);
+            out << "foo\nold line\nold tail that is long\n";
+        }
+
+        const auto written = incremental_write(path, 4, 1, lines.size(), source);
+        REQUIRE(written.value().bytes == 14);
+        REQUIRE(read_all(path) == "foo\n\tbar\n\nbaz\n");
+
+        // The part that was kept is in the hash too
+        REQUIRE(written.value().hash == content_hash(read_all(path)));
+        REQUIRE_FALSE(incremental_write(path, 100, 1, lines.size(), source).has_value());
+    }
+
+    SECTION("Without a reflink the original isn't written to") {
+        const std::string link = "tests/fixture/temp_save_link.txt";
+        fs::remove(link);
+        {
+            std::ofstream out(path);
+            out << "foo\nold line\nold tail that is long\n";
+        }
+        fs::create_hard_link(path, link);
+
+        const auto written = incremental_write(path, 4, 1, lines.size(), source, false);
+        REQUIRE(written.value().bytes == 14);
+        REQUIRE(read_all(path) == "foo\n\tbar\n\nbaz\n");
+        REQUIRE(written.value().hash == content_hash(read_all(path)));
+
+        // A new file took its place, the old one is left as it was
+        REQUIRE(read_all(link) == "foo\nold line\nold tail that is long\n");
+        REQUIRE(fs::hard_link_count(path) == 1);
+        fs::remove(link);
+    }
+
+    SECTION("Stamp changes with the file") {
+        REQUIRE(atomic_write(path, lines.size(), source).has_value());
+        const auto before = file_stamp(path);
+        REQUIRE(before.has_value());
+        REQUIRE(before.value().size == 14);
+
+        REQUIRE(atomic_write(path, 1, source).has_value());
+        REQUIRE_FALSE(file_stamp(path).value() == before.value());
+        REQUIRE_FALSE(file_stamp("tests/fixture/does_not_exist.txt").has_value());
+    }
+
+    SECTION("Directory doesn't exist") {
+        REQUIRE_FALSE(atomic_write("tests/does_not_exist/file.txt", 1, source).has_value());
+    }
+
+    fs::remove(path);
+}
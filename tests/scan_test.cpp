@@ -0,0 +1,234 @@
+#include "scan.h"
+
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "constants.h"
+#include "mapped_file.h"
+#include "text_io.h"
+
+namespace {
+    std::vector<std::size_t> scan(std::string_view text, ScanKernel kernel) {
+        std::vector<std::size_t> ret = {};
+        scan_line_chars(text, 0, ret, kernel);
+        return ret;
+    }
+
+    // Lines of random printable text with the occasional tab and CRLF ending
+    std::string synthetic_text(std::size_t bytes) {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> line_len(0, 120);
+        std::uniform_int_distribution<int> printable(' ', '~');
+        std::uniform_int_distribution<int> percent(0, 99);
+
+        std::string ret;
+        ret.reserve(bytes + 128);
+
+        while (ret.size() < bytes) {
+            if (percent(rng) < 20) { ret.push_back('\t'); }
+
+            const int len = line_len(rng);
+            for (int i = 0; i < len; i++) {
+                ret.push_back(char(printable(rng)));
+            }
+
+            if (percent(rng) < 10) { ret.push_back('\r'); }
+            ret.push_back('\n');
+        }
+
+        return ret;
+    }
+
+    // The char-at-a-time loop `open_file` used before the scanning kernel,
+    // kept here as the baseline to benchmark against
+    std::size_t per_byte_lines(std::string_view text) {
+        std::vector<std::string> ret;
+        std::string line = "";
+
+        for (const char ch : text) {
+            switch (ch) {
+                case '\r':
+                    break;
+                case '\t':
+                    line += std::string(TAB_SIZE, ' ');
+                    break;
+                case '\n':
+                    ret.push_back(line);
+                    line = "";
+                    break;
+                default:
+                    line.push_back(ch);
+            };
+        }
+
+        if (line.size()) { ret.push_back(line); }
+        return ret.size();
+    }
+
+    std::size_t kernel_lines(std::string_view text, ScanKernel kernel) {
+        std::vector<std::size_t> special_chars = {};
+        scan_line_chars(text, 0, special_chars, kernel);
+
+        std::vector<std::string> ret;
+        std::string line = "";
+        std::size_t run_start = 0;
+
+        for (const std::size_t pos : special_chars) {
+            line.append(text.substr(run_start, pos - run_start));
+            run_start = pos + 1;
+
+            if (text[pos] == '\n') {
+                ret.push_back(std::move(line));
+                line = "";
+            }
+        }
+
+        line.append(text.substr(run_start));
+        if (line.size()) { ret.push_back(std::move(line)); }
+        return ret.size();
+    }
+}  // namespace
+
+TEST_CASE("scan_line_chars", "[scan]") {
+    const std::vector<ScanKernel> kernels = {
+        ScanKernel::Scalar, ScanKernel::SSE2, ScanKernel::AVX2, ScanKernel::Auto};
+
+    SECTION("Finds every newline and CR") {
+        const std::string text = "foo\tbar\r\nbaz\n";
+        const std::vector<std::size_t> expected = {7, 8, 12};
+
+        for (const auto kernel : kernels) {
+            REQUIRE(scan(text, kernel) == expected);
+        }
+    }
+
+    SECTION("No special chars") {
+        const std::string text(100, 'a');
+        for (const auto kernel : kernels) {
+            REQUIRE(scan(text, kernel).empty());
+        }
+    }
+
+    SECTION("Offsets are relative to the given base") {
+        std::vector<std::size_t> ret = {};
+        scan_line_chars("ab\n", 100, ret);
+        REQUIRE(ret == std::vector<std::size_t> {102});
+    }
+
+    SECTION("Vector kernels match the scalar kernel") {
+        // Odd length so every kernel has to handle a ragged tail
+        const std::string text = synthetic_text(64 * 1024 + 7);
+        const auto expected = scan(text, ScanKernel::Scalar);
+
+        for (const auto kernel : kernels) {
+            REQUIRE(scan(text, kernel) == expected);
+        }
+    }
+
+    SECTION("Matches at register boundaries") {
+        std::string text(96, 'a');
+        for (const std::size_t i : {0, 15, 16, 31, 32, 63, 95}) {
+            text[i] = '\n';
+        }
+
+        const std::vector<std::size_t> expected = {0, 15, 16, 31, 32, 63, 95};
+        for (const auto kernel : kernels) {
+            REQUIRE(scan(text, kernel) == expected);
+        }
+    }
+}
+
+TEST_CASE("trim_point", "[scan]") {
+    const std::vector<ScanKernel> kernels = {ScanKernel::Scalar, ScanKernel::SSE2, ScanKernel::Auto};
+
+    SECTION("Short lines") {
+        for (const auto kernel : kernels) {
+            REQUIRE(trim_point("hello  ", kernel) == 5);
+            REQUIRE(trim_point("hello", kernel) == 5);
+            REQUIRE(trim_point(" \t\f\v", kernel) == 0);
+            REQUIRE(trim_point("", kernel) == 0);
+        }
+    }
+
+    SECTION("Whitespace across register boundaries") {
+        for (const std::size_t spaces : {15, 16, 17, 40}) {
+            const std::string text = "\tfoo" + std::string(spaces, ' ') + "\r";
+            for (const auto kernel : kernels) {
+                REQUIRE(trim_point(text, kernel) == 4);
+            }
+        }
+    }
+
+    SECTION("Bytes around the whitespace range") {
+        // '\b' and '\x0e' sit either side of '\t'-'\r', and high bytes must
+        // not wrap round into it
+        for (const char ch : {'\b', '\x0e', '\x80', '\xff', '!'}) {
+            const std::string text = std::string(20, 'a') + ch + std::string(20, ' ');
+            for (const auto kernel : kernels) {
+                REQUIRE(trim_point(text, kernel) == 21);
+            }
+        }
+    }
+}
+
+TEST_CASE("split_on_lines", "[scan]") {
+    SECTION("Chunks end on a newline") {
+        const std::string text = synthetic_text(10 * 1024);
+        const auto chunks = split_on_lines(text, 4);
+
+        REQUIRE(chunks.size() == 4);
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < chunks.size(); i++) {
+            if (i + 1 < chunks.size()) { REQUIRE(chunks.at(i).back() == '\n'); }
+            total += chunks.at(i).size();
+        }
+        REQUIRE(total == text.size());
+    }
+
+    SECTION("Fewer lines than parts") {
+        const auto chunks = split_on_lines("foo\nbar", 8);
+        REQUIRE(chunks.size() == 2);
+        REQUIRE(chunks.at(0) == "foo\n");
+        REQUIRE(chunks.at(1) == "bar");
+    }
+
+    SECTION("No newlines") {
+        const auto chunks = split_on_lines("hello", 4);
+        REQUIRE(chunks.size() == 1);
+        REQUIRE(chunks.at(0) == "hello");
+    }
+
+    SECTION("Empty input") {
+        REQUIRE(split_on_lines("", 4).empty());
+    }
+}
+
+// Run with `./run.py test "[!benchmark]"`. Set IRIS_BENCH_MB to change the
+// size of the synthetic input (default 2048)
+TEST_CASE("Benchmark file ingestion", "[!benchmark][scan]") {
+    for (const std::string file :
+         {"tests/fixture/lorem_ipsum.txt", "tests/fixture/very_long_line.txt"}) {
+        const MappedFile mapping(file);
+        const std::string_view text = mapping.view();
+
+        BENCHMARK("per-byte loop: " + file) { return per_byte_lines(text); };
+        BENCHMARK("scalar kernel: " + file) { return kernel_lines(text, ScanKernel::Scalar); };
+        BENCHMARK("best kernel: " + file) { return kernel_lines(text, ScanKernel::Auto); };
+        BENCHMARK("open_file: " + file) { return open_file(file); };
+    }
+
+    const char* env_size = std::getenv("IRIS_BENCH_MB");
+    const std::size_t megabytes = env_size ? std::stoul(env_size) : 2048;
+    const std::string text = synthetic_text(megabytes * 1024 * 1024);
+
+    BENCHMARK("per-byte loop: synthetic") { return per_byte_lines(text); };
+    BENCHMARK("scan only (scalar): synthetic") { return scan(text, ScanKernel::Scalar).size(); };
+    BENCHMARK("scan only (SSE2): synthetic") { return scan(text, ScanKernel::SSE2).size(); };
+    BENCHMARK("scan only (AVX2): synthetic") { return scan(text, ScanKernel::AVX2).size(); };
+    BENCHMARK("best kernel: synthetic") { return kernel_lines(text, ScanKernel::Auto); };
+}
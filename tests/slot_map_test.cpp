@@ -0,0 +1,81 @@
+#include "slot_map.h"
+
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("SlotMap", "[slot_map]") {
+    SECTION("Values are found through their handle") {
+        SlotMap<std::string> map = {};
+        const SlotHandle foo = map.insert("foo");
+        const SlotHandle bar = map.emplace(3, 'x');
+
+        REQUIRE(map.size() == 2);
+        REQUIRE(*map.get(foo) == "foo");
+        REQUIRE(*map.get(bar) == "xxx");
+        REQUIRE(map.at(1) == "xxx");
+        REQUIRE_THROWS_AS(map.at(2), std::out_of_range);
+    }
+
+    SECTION("Values don't move as more are added") {
+        SlotMap<std::string> map = {};
+        const SlotHandle first = map.insert("first");
+        const std::string* const addr = map.get(first);
+
+        for (int i = 0; i < 1000; i++) {
+            std::ignore = map.insert(std::to_string(i));
+        }
+
+        REQUIRE(map.get(first) == addr);
+        REQUIRE(map.size() == 1001);
+    }
+
+    SECTION("Erased handles go stale") {
+        SlotMap<std::string> map = {};
+        const SlotHandle foo = map.insert("foo");
+        std::ignore = map.insert("bar");
+
+        REQUIRE(map.erase(foo));
+        REQUIRE(!map.erase(foo));
+        REQUIRE(map.get(foo) == nullptr);
+        REQUIRE(!map.handle_at(0).has_value());
+        REQUIRE(map.size() == 1);
+
+        // The slot is reused, but the old handle doesn't find the new value
+        const SlotHandle baz = map.insert("baz");
+        REQUIRE(baz.index == foo.index);
+        REQUIRE(!map.contains(foo));
+        REQUIRE(*map.get(baz) == "baz");
+        REQUIRE(map.handle_at(0) == baz);
+    }
+
+    SECTION("Iteration skips empty slots") {
+        SlotMap<int> map = {};
+        std::vector<SlotHandle> handles = {};
+        for (int i = 0; i < 6; i++) {
+            handles.push_back(map.insert(i));
+        }
+        map.erase(handles.at(0));
+        map.erase(handles.at(3));
+        map.erase(handles.at(5));
+
+        std::vector<int> seen = {};
+        for (const int value : map) {
+            seen.push_back(value);
+        }
+
+        REQUIRE(seen == std::vector<int> {1, 2, 4});
+        const std::vector<SlotHandle> live = {handles.at(1), handles.at(2), handles.at(4)};
+        REQUIRE(map.handles() == live);
+    }
+
+    SECTION("Empty") {
+        SlotMap<int> map = {};
+        REQUIRE(map.empty());
+        REQUIRE(map.begin() == map.end());
+        REQUIRE(map.get(SlotHandle {}) == nullptr);
+    }
+}
@@ -0,0 +1,56 @@
+#include "text_buffer.h"
+
+#include <string>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "constants.h"
+#include "piece_table.h"
+
+TEST_CASE("VectorBuffer", "[text_buffer]") {
+    VectorBuffer buf({"foo", "bar"});
+
+    buf.insert(1, "baz");
+    buf.edit(0).push_back('!');
+    buf.set(2, "qux");
+    buf.append({"end"});
+    buf.erase(1);
+
+    REQUIRE(buf.lines == std::vector<std::string> {"foo!", "qux", "end"});
+
+    SECTION("What's known about a line is kept until it changes") {
+        REQUIRE_FALSE(buf.line_ref(1).has_tabs());
+        buf.edit(1) += "\t";
+        REQUIRE(buf.line_ref(1).has_tabs());
+        REQUIRE(buf.line_ref(1).text() == "qux\t");
+
+        buf.splice(0, 2, {"  ", "bar"});
+        REQUIRE(buf.line_ref(0).blank());
+        REQUIRE_FALSE(buf.line_ref(1).has_tabs());
+        REQUIRE(buf.info.size() == buf.lines.size());
+    }
+}
+
+TEST_CASE("Comparing buffers", "[text_buffer]") {
+    const VectorBuffer lines({"foo", "bar"});
+    const PieceTable pieces({"foo", "bar"});
+
+    REQUIRE(lines == pieces);
+    REQUIRE_FALSE(lines == PieceTable({"foo"}));
+    REQUIRE_FALSE(lines == VectorBuffer({"foo", "baz"}));
+}
+
+TEST_CASE("make_text_buffer", "[text_buffer]") {
+    SECTION("Small buffers are a vector") {
+        const auto buf = make_text_buffer({"foo", "bar"});
+        REQUIRE(dynamic_cast<VectorBuffer*>(buf.get()) != nullptr);
+        REQUIRE(buf->at(1) == "bar");
+    }
+
+    SECTION("Large buffers are a piece table") {
+        const auto buf = make_text_buffer(std::vector<std::string>(PIECE_TABLE_LINES, "foo"));
+        REQUIRE(dynamic_cast<PieceTable*>(buf.get()) != nullptr);
+        REQUIRE(buf->size() == PIECE_TABLE_LINES);
+    }
+}
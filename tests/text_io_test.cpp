@@ -1,8 +1,15 @@
 #include "text_io.h"
 
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
 #include <catch2/catch_test_macros.hpp>
 
+#include "constants.h"
 #include "model.h"
+#include "undo_log.h"
 
 TEST_CASE("open_file", "[textio]") {
     SECTION("Normal file") {
@@ -22,6 +29,34 @@ TEST_CASE("open_file", "[textio]") {
         REQUIRE(actual.value().size() == 1);
         REQUIRE(actual.value().at(0) == "hello");
     }
+
+    SECTION("Large file loaded in parallel") {
+        const std::string filename = "tests/fixture/large_temp_file.txt";
+        const std::string line = "\tThe quick brown fox jumps over the lazy dog\r\n";
+        std::size_t lines = 0;
+        {
+            std::ofstream out(filename);
+            while (std::size_t(out.tellp()) <= PARALLEL_LOAD_SIZE) {
+                out << line;
+                lines++;
+            }
+            out << "last line";
+        }
+
+        opt_lines_t actual = open_file(filename);
+        std::filesystem::remove(filename);
+
+        REQUIRE(actual.has_value());
+        REQUIRE(actual.value().size() == lines + 1);
+        REQUIRE(actual.value().at(0) == "\tThe quick brown fox jumps over the lazy dog");
+        REQUIRE(actual.value().at(lines / 2) == actual.value().at(0));
+        REQUIRE(actual.value().back() == "last line");
+    }
+
+    SECTION("File does not exist") {
+        opt_lines_t actual = open_file("tests/fixture/does_not_exist.txt");
+        REQUIRE_FALSE(actual.has_value());
+    }
 }
 
 TEST_CASE("get_file_size", "[textio]") {
@@ -57,6 +92,191 @@ TEST_CASE("write_to_file", "[textio]") {
         REQUIRE(data.bytes == 0);
         REQUIRE(data.lines == 0);
     }
+
+    SECTION("Only edited lines are rewritten") {
+        const std::string filename = "tests/fixture/temp_edit_file.txt";
+        {
+            std::ofstream out(filename);
+            out << "keep  \r\nfoo  \nbar\nbaz";
+        }
+
+        auto edited = Model(open_file(filename).value(), filename);
+        edited.current_line = 2;
+        edited.insert('x');
+        REQUIRE(edited.dirty_from == 2);
+
+        WriteData data = write_to_file(&edited, std::nullopt);
+        REQUIRE(data.valid);
+        REQUIRE(data.lines == 4);
+        REQUIRE(edited.disk_synced);
+        REQUIRE(edited.dirty_from == std::string::npos);
+
+        // Untouched lines keep their whitespace, but the CR is gone as the
+        // buffer doesn't have it
+        std::stringstream contents;
+        contents << std::ifstream(filename).rdbuf();
+        REQUIRE(contents.str() == "keep  \nfoo  \nxbar\nbaz\n");
+
+        // Saving again after editing the end of the file
+        edited.current_line = 3;
+        edited.current_char = 3;
+        edited.insert('!');
+        data = write_to_file(&edited, std::nullopt);
+        REQUIRE(data.valid);
+        REQUIRE(data.bytes == 23);
+
+        contents.str("");
+        contents << std::ifstream(filename).rdbuf();
+        REQUIRE(contents.str() == "keep  \nfoo  \nxbar\nbaz!\n");
+    }
+    SECTION("Trimming an edited line can be undone in one step") {
+        auto trimmed = Model({"foo", "bar", "baz"}, "tests/fixture/temp_file.txt");
+        trimmed.begin_undo_group();
+        trimmed.insert(' ');
+        trimmed.current_line = 2;
+        trimmed.current_char = 3;
+        trimmed.insert(' ');
+        trimmed.end_undo_group();
+
+        REQUIRE(write_to_file(&trimmed, std::nullopt).valid);
+        REQUIRE(trimmed.buf->to_vector() == lines_t {" foo", "bar", "baz"});
+        REQUIRE(!trimmed.unsaved);
+
+        REQUIRE(trimmed.undo(24));
+        REQUIRE(trimmed.buf->to_vector() == lines_t {" foo", "bar", "baz "});
+        REQUIRE(trimmed.unsaved);
+        REQUIRE(trimmed.undo(24));
+        REQUIRE(trimmed.buf->to_vector() == lines_t {"foo", "bar", "baz"});
+    }
+
+    SECTION("Undo history is kept for the next time the file is opened") {
+        namespace fs = std::filesystem;
+        const std::string filename = "tests/fixture/temp_edit_file.txt";
+        const std::string state = "tests/fixture/state";
+        setenv("XDG_STATE_HOME", state.c_str(), 1);
+        {
+            std::ofstream out(filename);
+            out << "foo\nbar\n";
+        }
+
+        {
+            auto first = Model(open_file(filename).value(), filename);
+            first.begin_undo_group();
+            first.insert('x');
+            first.end_undo_group();
+            REQUIRE(write_to_file(&first, std::nullopt).valid);
+            REQUIRE(fs::exists(undo_path(filename)));
+        }
+
+        auto second = Model(open_file(filename).value(), filename);
+        REQUIRE(second.undo(24));
+        REQUIRE(second.buf->at(0) == "foo");
+        REQUIRE(second.unsaved);
+        REQUIRE(second.redo(24));
+        REQUIRE(!second.unsaved);
+
+        // It's only for the file as it was saved
+        {
+            std::ofstream out(filename);
+            out << "changed\n";
+        }
+        auto third = Model(open_file(filename).value(), filename);
+        REQUIRE(!third.undo(24));
+
+        fs::remove_all(state);
+        unsetenv("XDG_STATE_HOME");
+    }
+}
+
+TEST_CASE("start_save", "[textio]") {
+    const std::string filename = "tests/fixture/temp_edit_file.txt";
+    auto m = Model({"foo", "bar"}, filename);
+    m.insert('x');
+    REQUIRE(m.unsaved);
+
+    SECTION("Saved in the background") {
+        REQUIRE(start_save(&m, std::nullopt));
+        REQUIRE(m.saving != nullptr);
+
+        const std::optional<WriteData> data = poll_save(&m, true);
+        REQUIRE(data.has_value());
+        REQUIRE(data.value().valid);
+        REQUIRE(data.value().bytes == 9);
+        REQUIRE(m.saving == nullptr);
+        REQUIRE(!m.unsaved);
+    }
+
+    SECTION("Edited while saving") {
+        REQUIRE(start_save(&m, std::nullopt));
+        m.current_line = 1;
+        m.insert('y');
+
+        const std::optional<WriteData> data = poll_save(&m, true);
+        REQUIRE(data.value().valid);
+        REQUIRE(m.unsaved);
+        REQUIRE(m.dirty_from == 1);
+
+        // The snapshot is what's on disk, not the edit
+        std::stringstream contents;
+        contents << std::ifstream(filename).rdbuf();
+        REQUIRE(contents.str() == "xfoo\nbar\n");
+
+        REQUIRE(write_to_file(&m, std::nullopt).valid);
+        REQUIRE(!m.unsaved);
+    }
+
+    SECTION("Rope snapshot") {
+        m.set_backend(Backend::Rope);
+        REQUIRE(start_save(&m, std::nullopt));
+        m.current_line = 1;
+        m.insert('y');
+
+        REQUIRE(poll_save(&m, true).value().valid);
+        std::stringstream contents;
+        contents << std::ifstream(filename).rdbuf();
+        REQUIRE(contents.str() == "xfoo\nbar\n");
+    }
+
+    SECTION("Undo history is kept by the save's own thread") {
+        namespace fs = std::filesystem;
+        const std::string state = "tests/fixture/state";
+        setenv("XDG_STATE_HOME", state.c_str(), 1);
+        const std::string before(m.buf->at(0));
+        m.begin_undo_group();
+        m.insert('y');
+        m.end_undo_group();
+        const std::string saved(m.buf->at(0));
+
+        REQUIRE(start_save(&m, std::nullopt));
+        REQUIRE(m.saving->job.history != nullptr);
+        REQUIRE(m.undo_log.held);
+
+        // Edits made meanwhile aren't in what's kept
+        m.begin_undo_group();
+        m.insert('z');
+        m.end_undo_group();
+
+        REQUIRE(poll_save(&m, true).value().valid);
+        REQUIRE(!m.undo_log.held);
+        REQUIRE(m.undo_log.path == undo_path(filename));
+
+        auto reopened = Model(open_file(filename).value(), filename);
+        REQUIRE(reopened.buf->at(0) == saved);
+        REQUIRE(reopened.undo(24));
+        REQUIRE(reopened.buf->at(0) == before);
+        REQUIRE(reopened.redo(24));
+        REQUIRE(!reopened.redo(24));
+
+        fs::remove_all(state);
+        unsetenv("XDG_STATE_HOME");
+    }
+
+    SECTION("No filename given") {
+        m.filename = "";
+        REQUIRE(!start_save(&m, std::nullopt));
+        REQUIRE(m.saving == nullptr);
+        REQUIRE(!poll_save(&m).has_value());
+    }
 }
 
 TEST_CASE("rtrim", "[textio]") {
@@ -83,13 +303,46 @@ TEST_CASE("is_letter", "[textio]") {
     REQUIRE_FALSE(is_letter(':'));
 }
 
-TEST_CASE("check_filename", "[textio]") {
-    std::string err_text = "Iris currently does not support tab-delineated files";
+TEST_CASE("draw_columns", "[textio]") {
+    auto drawn = [](std::string_view text, std::size_t from = 0, std::size_t count = 80) {
+        return draw_columns({text, "", text.find('\t') != std::string_view::npos}, from, count);
+    };
+
+    REQUIRE(drawn("no tabs").text == "no tabs");
+    REQUIRE(drawn("\tfoo").text == "    foo");
+    REQUIRE(drawn("ab\tc").text == "ab  c");
+    REQUIRE(drawn("abcd\t\tx").text == "abcd        x");
+    REQUIRE(drawn("abcd\t\tx").width == 13);
+
+    SECTION("Only the columns asked for") {
+        REQUIRE(drawn("abcdefgh", 2, 3).text == "cde");
+        REQUIRE(drawn("abcdefgh", 20, 3).text.empty());
+        REQUIRE(drawn("ab\tcdefgh", 3, 3).text == " cd");
+
+        // and only as far past them as it takes to know the line goes on
+        const std::string long_line(10'000, 'x');
+        REQUIRE(drawn(long_line, 10, 5).width == long_line.size());
+        REQUIRE(drawn("\t" + long_line, 10, 5).width < 100);
+    }
+
+    SECTION("Either side of a gap") {
+        const LineParts parts = {"ab", "\tcd", true};
+        REQUIRE(draw_columns(parts, 1, 10).text == "b  cd");
+    }
+}
+
+TEST_CASE("column_of", "[textio]") {
+    REQUIRE(column_of({"ab\tc", "", false}, 3) == 3);
+    REQUIRE(column_of({"ab", "\tc", true}, 3) == 4);
+    REQUIRE(column_of({"ab", "\tc", true}, 6) == 7);
+}
+
+TEST_CASE("tab_columns", "[textio]") {
+    REQUIRE(tab_columns("no tabs").empty());
 
-    REQUIRE(check_filename("Makefile") == err_text);
-    REQUIRE(check_filename("makefile") == err_text);
-    REQUIRE(check_filename("t.go") == err_text);
-    REQUIRE(check_filename("t.py") == "");
+    const std::vector<std::size_t> expected = {0, 1, 2, 4, 5};
+    REQUIRE(tab_columns("ab\tc") == expected);
+    REQUIRE(tab_columns("\t\t") == std::vector<std::size_t> {0, 4, 8});
 }
 
 TEST_CASE("file_exists", "[textio]") {
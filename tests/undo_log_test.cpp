@@ -0,0 +1,255 @@
+#include "undo_log.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include "change.h"
+
+TEST_CASE("UndoLog", "[undo_log]") {
+    UndoLog log = {};
+    const Change first = {{{2, {"foo"}, {"foo bar", "baz"}}, {10, {}, {""}}}, 2, 3};
+    const Change second = {{{0, {"a", "b", "c"}, {}}}, 0, 0};
+
+    SECTION("Records read back as they were written") {
+        REQUIRE(log.append(first, 0) == 1);
+        REQUIRE(log.size() == 1);
+        REQUIRE(log.undo_step() == UndoStep {1, true});
+
+        const std::string_view record = log.record(1);
+        const auto hunks = log.hunks(record);
+        REQUIRE(hunks.size() == 2);
+        REQUIRE(hunks[0].first == 2);
+        REQUIRE(log.lines(record, hunks[0].before, hunks[0].before_count) == first.hunks[0].before);
+        REQUIRE(log.lines(record, hunks[0].after, hunks[0].after_count) == first.hunks[0].after);
+        REQUIRE(hunks[1].first == 10);
+        REQUIRE(hunks[1].before_count == 0);
+        REQUIRE(log.lines(record, hunks[1].after, hunks[1].after_count) == first.hunks[1].after);
+    }
+
+    SECTION("Undo and redo step over whole records") {
+        std::ignore = log.append(first, 0);
+        std::ignore = log.append(second, 0);
+        REQUIRE(log.depth() == 2);
+
+        log.step(log.undo_step().value());
+        REQUIRE(log.current == 1);
+        log.step(log.undo_step().value());
+        REQUIRE(!log.can_undo());
+        REQUIRE(!log.undo_step().has_value());
+        REQUIRE(log.depth() == 0);
+
+        REQUIRE(log.redo_step() == UndoStep {1, false});
+        log.step(log.redo_step().value());
+        log.step(log.redo_step().value());
+        REQUIRE(log.current == 2);
+        REQUIRE(!log.can_redo());
+    }
+
+    SECTION("A new record after an undo starts a branch") {
+        std::ignore = log.append(first, 0);
+        std::ignore = log.append(second, 0);
+        log.step(log.undo_step().value());
+        log.step(log.undo_step().value());
+
+        REQUIRE(log.append(second, 0) == 3);
+        REQUIRE(!log.can_redo());
+        REQUIRE(log.size() == 3);
+        REQUIRE(log.depth() == 1);
+        REQUIRE(log.nodes.at(3).parent == 0);
+
+        // Undo goes back up the new branch, and redo follows it down again
+        log.step(log.undo_step().value());
+        REQUIRE(log.redo_step() == UndoStep {3, false});
+
+        // Up to where the branches meet and down the other
+        REQUIRE(log.route(3, 2) ==
+                std::vector<UndoStep> {{3, true}, {1, false}, {2, false}});
+        REQUIRE(log.route(2, 2).empty());
+    }
+
+    SECTION("Through time") {
+        std::ignore = log.append(first, 100);
+        std::ignore = log.append(second, 160);
+        log.step(log.undo_step().value());
+        std::ignore = log.append(second, 400);
+
+        REQUIRE(log.state_at(50) == 0);
+        REQUIRE(log.state_at(159) == 1);
+        REQUIRE(log.state_at(1000) == 3);
+
+        // In the order states were made, whichever branch they're on
+        REQUIRE(log.travel(-1, false) == 2);
+        REQUIRE(log.travel(-10, false) == 0);
+        REQUIRE(log.travel(5, false) == 3);
+        REQUIRE(log.travel(-240, true) == 2);
+        REQUIRE(log.travel(-301, true) == 0);
+    }
+
+    SECTION("Long lines and far away hunks") {
+        const std::string line(100'000, 'x');
+        std::ignore = log.append({{{5'000'000'000, {line}, {}}}, 0, 0}, 0);
+
+        const std::string_view record = log.record(1);
+        const auto hunks = log.hunks(record);
+        REQUIRE(hunks.front().first == 5'000'000'000);
+        REQUIRE(log.lines(record, hunks.front().before, 1).front() == line);
+    }
+
+    SECTION("Records are only as big as the lines in them") {
+        std::ignore = log.append({{{1, {"a"}, {"ab"}}}, 1, 1}, 0);
+        // Op, parent, time, cursor, hunk count, hunk header and lines
+        REQUIRE(log.bytes.size() == 1 + 1 + 1 + 2 + 1 + 3 + 5);
+    }
+
+    SECTION("Bad records") {
+        REQUIRE_THROWS_AS(log.record(0), std::out_of_range);
+        REQUIRE_THROWS_AS(log.record(1), std::out_of_range);
+        REQUIRE_THROWS_AS(log.hunks("x"), std::out_of_range);
+        std::ignore = log.append(first, 0);
+        REQUIRE_THROWS_AS(log.hunks(log.record(1).substr(0, 4)), std::out_of_range);
+    }
+}
+
+TEST_CASE("UndoLog on disk", "[undo_log]") {
+    namespace fs = std::filesystem;
+    const std::string path = "tests/fixture/temp_undo_log";
+    fs::remove(path);
+
+    // A hundred records of about 100 bytes each
+    UndoLog log = {};
+    auto fill = [](UndoLog& into) {
+        for (std::size_t i = 0; i < 100; i++) {
+            std::ignore = into.append({{{i, {std::string(90, 'a')}, {std::to_string(i)}}}, 0, 0}, 0);
+        }
+    };
+
+    // Undo all the way back, checking each record is the one expected
+    auto undo_all = [](UndoLog& from) {
+        std::size_t undone = 0;
+        for (std::size_t i = from.depth(); i-- > 0; undone++) {
+            const std::optional<UndoStep> step = from.undo_step();
+            REQUIRE(step.has_value());
+
+            const std::string_view record = from.record(step->seq);
+            const LoggedHunk hunk = from.hunks(record).front();
+            REQUIRE(hunk.first == i);
+            REQUIRE(from.lines(record, hunk.after, 1).front() == std::to_string(i));
+            from.step(step.value());
+        }
+
+        REQUIRE(!from.can_undo());
+        return undone;
+    };
+
+    SECTION("Saved and reloaded") {
+        fill(log);
+        log.step(log.undo_step().value());
+        std::ignore = log.append({{{0, {"x"}, {"y"}}}, 0, 0}, 0);
+        log.step(log.undo_step().value());
+        REQUIRE(log.persist(path, 42));
+
+        UndoLog loaded = {};
+        REQUIRE(loaded.restore(path, 42));
+        REQUIRE(loaded.size() == 101);
+        REQUIRE(loaded.current == 99);
+        REQUIRE(loaded.clean == 99);
+        REQUIRE(loaded.nodes.at(101).parent == 99);
+        REQUIRE(loaded.route(99, 100) == std::vector<UndoStep> {{100, false}});
+        REQUIRE(undo_all(loaded) == 99);
+
+        // Only for the file it was kept for
+        UndoLog other = {};
+        REQUIRE(!other.restore(path, 43));
+        REQUIRE(other.path == path);
+        REQUIRE(!other.can_undo());
+    }
+
+    SECTION("The oldest records are spilled once over budget") {
+        log.path = path;
+        log.budget = 2000;
+        fill(log);
+
+        REQUIRE(log.bytes.size() <= log.budget);
+        REQUIRE(log.spilled > 0);
+        REQUIRE(fs::exists(path));
+
+        // and read back as they're undone
+        REQUIRE(undo_all(log) == 100);
+    }
+
+    SECTION("Nothing is spilled while held") {
+        log.path = path;
+        log.budget = 2000;
+        log.held = true;
+        fill(log);
+        REQUIRE(log.spilled == 0);
+        REQUIRE(!fs::exists(path));
+
+        log.held = false;
+        log.spill();
+        REQUIRE(log.bytes.size() <= log.budget);
+        REQUIRE(undo_all(log) == 100);
+    }
+
+    SECTION("Spilled records are saved along with the rest") {
+        log.path = path;
+        log.budget = 2000;
+        fill(log);
+        REQUIRE(log.persist(path, 42));
+
+        UndoLog loaded = {};
+        loaded.budget = 2000;
+        REQUIRE(loaded.restore(path, 42));
+        REQUIRE(loaded.bytes.size() <= 2000);
+        REQUIRE(undo_all(loaded) == 100);
+    }
+
+    SECTION("A saved log stays valid as more is spilled after it") {
+        log.path = path;
+        log.budget = 2000;
+        fill(log);
+        REQUIRE(log.persist(path, 42));
+
+        fill(log);
+        UndoLog loaded = {};
+        REQUIRE(loaded.restore(path, 42));
+        REQUIRE(loaded.size() == 100);
+    }
+
+    SECTION("Spilling over another file's log stops it being reloaded") {
+        fill(log);
+        REQUIRE(log.persist(path, 42));
+
+        UndoLog other = {};
+        REQUIRE(!other.restore(path, 43));
+        other.budget = 2000;
+        fill(other);
+        REQUIRE(other.spilled > 0);
+        REQUIRE(!UndoLog().restore(path, 42));
+    }
+
+    fs::remove(path);
+}
+
+TEST_CASE("undo_path", "[undo_log]") {
+    setenv("XDG_STATE_HOME", "/tmp/state", 1);
+    REQUIRE(undo_path("/home/foo/bar.txt") == "/tmp/state/iris/undo/%home%foo%bar.txt");
+    REQUIRE(undo_path("/home/foo/../bar.txt") == "/tmp/state/iris/undo/%home%bar.txt");
+    unsetenv("XDG_STATE_HOME");
+}
+
+TEST_CASE("content_hash", "[undo_log]") {
+    REQUIRE(content_hash("") == 0xcbf29ce484222325);
+    REQUIRE(content_hash("foo") == content_hash("foo"));
+    REQUIRE(content_hash("foo") != content_hash("fop"));
+    REQUIRE(content_hash("bar", content_hash("foo")) == content_hash("foobar"));
+}
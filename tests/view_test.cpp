@@ -4,10 +4,24 @@
 #include <catch2/matchers/catch_matchers.hpp>
 #include <rawterm/text.h>
 
+#include "action.h"
 #include "constants.h"
 #include "controller.h"
 #include "text_io.h"
 
+namespace {
+    // Hand a model to the controller, and show it in `v`
+    Model& add_model(View& v, Model m) {
+        const ModelHandle handle = v.ctrlr_ptr->models.insert(std::move(m));
+        v.add_model(handle);
+        return *v.ctrlr_ptr->models.get(handle);
+    }
+
+    Model& add_model(View& v, const std::string& filename) {
+        return add_model(v, Model(open_file(filename).value(), filename));
+    }
+}  // namespace
+
 TEST_CASE("Constructor", "[view]") {
     Controller c;
     auto v = View(&c, {24, 80});
@@ -22,8 +36,7 @@ TEST_CASE("add_model", "[view]") {
     lines_t raw = {"This is some text", "    here is a newline and tab", "and another newline"};
 
     auto v = View(&c, rawterm::Pos(24, 80));
-    auto m = Model(raw, "test_file.txt");
-    v.add_model(&m);
+    add_model(v, Model(raw, "test_file.txt"));
 
     REQUIRE(v.active_model == 0);
     REQUIRE(v.get_active_model()->filename == "test_file.txt");
@@ -36,8 +49,7 @@ TEST_CASE("get_active_model", "[view]") {
     lines_t raw = {"This is some text", "    here is a newline and tab", "and another newline"};
 
     auto v = View(&c, rawterm::Pos(24, 80));
-    auto m = Model(raw, "test_file.txt");
-    v.add_model(&m);
+    Model& m = add_model(v, Model(raw, "test_file.txt"));
 
     REQUIRE(v.get_active_model() == &m);
 }
@@ -46,9 +58,7 @@ TEST_CASE("render_screen", "[view]") {
     SECTION("Render single text file") {
         Controller c;
         auto v = View(&c, rawterm::Pos(24, 80));
-        auto m = Model(
-            open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
-        v.add_model(&m);
+        add_model(v, "tests/fixture/test_file_1.txt");
 
         auto buffer = lines(v.render_screen());
 
@@ -60,11 +70,10 @@ TEST_CASE("render_screen", "[view]") {
     SECTION("Truncated line") {
         Controller c;
         auto v = View(&c, rawterm::Pos(24, 80));
-        auto m = Model(32, "");
-        v.add_model(&m);
+        Model& m = add_model(v, Model(32, ""));
 
         for (int i = 0; i < 80; i++) {
-            m.buf.at(0).push_back('_');
+            m.buf->edit(0).push_back('_');
         }
 
         auto buffer = lines(v.render_screen());
@@ -80,12 +89,9 @@ TEST_CASE("render_tab_bar", "[view]") {
     lines_t raw = {"This is some text", "    here is a newline and tab", "and another newline"};
 
     auto v = View(&c, rawterm::Pos(24, 80));
-    auto m = Model(raw, "test_file.txt");
 
-    v.add_model(&m);
-    auto m2 =
-        Model(open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
-    v.add_model(&m2);
+    add_model(v, Model(raw, "test_file.txt"));
+    Model& m2 = add_model(v, "tests/fixture/test_file_1.txt");
 
     SECTION("Unmodified") {
         std::string ret = v.render_tab_bar();
@@ -110,11 +116,9 @@ TEST_CASE("render_tab_bar", "[view]") {
 TEST_CASE("render_line", "[view]") {
     SECTION("Standard line rendering") {
         Controller c;
-        auto m = Model(
-            open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
 
         auto v = View(&c, rawterm::Pos(24, 80));
-        v.add_model(&m);
+        add_model(v, "tests/fixture/test_file_1.txt");
 
         const std::string line = rawterm::raw_str(v.render_line(0));
 
@@ -133,12 +137,11 @@ TEST_CASE("render_line", "[view]") {
 
     SECTION("Truncated line") {
         Controller c;
-        auto m = Model(32, "");
         auto v = View(&c, rawterm::Pos(24, 80));
-        v.add_model(&m);
+        Model& m = add_model(v, Model(32, ""));
 
         for (int i = 0; i <= 80; i++) {
-            m.buf.at(0).push_back('_');
+            m.buf->edit(0).push_back('_');
         }
 
         const std::string line = rawterm::raw_str(v.render_line(0));
@@ -146,16 +149,41 @@ TEST_CASE("render_line", "[view]") {
         REQUIRE(line.substr(line.size() - 2, 2) == "\u00BB");
         REQUIRE(line.size() == 82);  // +3 for unicode chars
     }
+    SECTION("Tabs are expanded") {
+        Controller c;
+        auto v = View(&c, rawterm::Pos(24, 80));
+        Model& m = add_model(v, Model({"\tfoo"}, ""));
+
+        const std::string line = rawterm::raw_str(v.render_line(0));
+        REQUIRE(line.ends_with("\u2502    foo"));
+        REQUIRE(m.buf->at(0) == "\tfoo");
+    }
+
+    SECTION("The line being typed into isn't put back together") {
+        Controller c;
+        auto v = View(&c, rawterm::Pos(24, 80));
+        Model& m = add_model(v, Model({std::string(100'000, 'x') + "\tend"}, ""));
+
+        m.start_typing();
+        m.current_char = 3;
+        m.insert('a');
+        m.insert('\t');
+
+        const std::string line = rawterm::raw_str(v.render_line(0));
+        REQUIRE(line.contains("\u2502xxxa    xxx"));
+        REQUIRE(line.size() < 200);
+        REQUIRE(m.display_col(0, 5) == 8);
+        REQUIRE(v.clamp_horizontal_movement(0) == 0);
+        REQUIRE(m.typed.stale);
+    }
 }
 
 TEST_CASE("render_status_bar", "[view]") {
     Controller c;
     auto v = View(&c, rawterm::Pos(24, 100));
 
-    auto m =
-        Model(open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
 
-    v.add_model(&m);
+    add_model(v, "tests/fixture/test_file_1.txt");
     std::string ret = v.render_status_bar();
 
     REQUIRE(ret.find("READ") != std::string::npos);
@@ -168,10 +196,8 @@ TEST_CASE("clamp_horizontal_movement", "[view]") {
     Controller c;
     auto v = View(&c, rawterm::Pos(24, 80));
 
-    auto m =
-        Model(open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
 
-    v.add_model(&m);
+    Model& m = add_model(v, "tests/fixture/lorem_ipsum.txt");
     m.current_line = 7;
     m.current_char = 7;
 
@@ -187,9 +213,7 @@ TEST_CASE("cursor_left", "[view]") {
     SECTION("Already at left-most position") {
         Controller c;
         auto v = View(&c, rawterm::Pos(24, 80));
-        auto m = Model(
-            open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
-        v.add_model(&m);
+        add_model(v, "tests/fixture/test_file_1.txt");
 
         REQUIRE(v.cur == rawterm::Pos(1, 1));
         v.cursor_left(1);
@@ -199,9 +223,7 @@ TEST_CASE("cursor_left", "[view]") {
     SECTION("Move left") {
         Controller c;
         auto v = View(&c, rawterm::Pos(24, 80));
-        auto m = Model(
-            open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
-        v.add_model(&m);
+        Model& m = add_model(v, "tests/fixture/test_file_1.txt");
 
         v.cursor_right(4);
         v.cursor_left(1);
@@ -215,9 +237,7 @@ TEST_CASE("cursor_up", "[view]") {
     SECTION("Already at top-most row") {
         Controller c;
         auto v = View(&c, rawterm::Pos(24, 80));
-        auto m = Model(
-            open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
-        v.add_model(&m);
+        add_model(v, "tests/fixture/test_file_1.txt");
 
         REQUIRE(v.cur == rawterm::Pos(1, 1));
         v.cursor_up(1);
@@ -227,9 +247,7 @@ TEST_CASE("cursor_up", "[view]") {
     SECTION("Move cursor up") {
         Controller c;
         auto v = View(&c, rawterm::Pos(24, 80));
-        auto m = Model(
-            open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
-        v.add_model(&m);
+        Model& m = add_model(v, "tests/fixture/test_file_1.txt");
         v.cursor_down();
         v.cursor_down();
         REQUIRE(v.cur == rawterm::Pos(3, 1));
@@ -243,9 +261,7 @@ TEST_CASE("cursor_up", "[view]") {
     SECTION("Move view up (scroll)") {
         Controller c;
         auto v = View(&c, rawterm::Pos(24, 80));
-        auto m = Model(
-            open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
-        v.add_model(&m);
+        Model& m = add_model(v, "tests/fixture/lorem_ipsum.txt");
 
         // Scroll down below initial view
         for (int i = 1; i < 35; i++) {
@@ -270,13 +286,31 @@ TEST_CASE("cursor_up", "[view]") {
     }
 }
 
+TEST_CASE("Cursor over tabs", "[view]") {
+    Controller c;
+    auto v = View(&c, rawterm::Pos(24, 80));
+    Model& m = add_model(v, Model({"\tfoo", "abc"}, ""));
+    const int start = v.cur.horizontal;
+
+    v.cursor_right();
+    REQUIRE(m.current_char == 1);
+    REQUIRE(v.cur.horizontal == start + 4);
+
+    v.cursor_down();
+    REQUIRE(m.current_char == 1);
+    REQUIRE(v.cur.horizontal == start + 1);
+
+    v.cursor_up();
+    v.cursor_left();
+    REQUIRE(m.current_char == 0);
+    REQUIRE(v.cur.horizontal == start);
+}
+
 TEST_CASE("cursor_down", "[view]") {
     SECTION("Move cursor down") {
         Controller c;
-        auto m = Model(
-            open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
         auto v = View(&c, rawterm::Pos(24, 80));
-        v.add_model(&m);
+        Model& m = add_model(v, "tests/fixture/lorem_ipsum.txt");
 
         REQUIRE(v.cur == rawterm::Pos(1, 1));
         v.cursor_down();
@@ -286,10 +320,8 @@ TEST_CASE("cursor_down", "[view]") {
 
     SECTION("Move view down (scroll)") {
         Controller c;
-        auto m = Model(
-            open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
         auto v = View(&c, rawterm::Pos(24, 80));
-        v.add_model(&m);
+        Model& m = add_model(v, "tests/fixture/lorem_ipsum.txt");
 
         for (int i = 1; i < 22; i++) {
             v.cursor_down();
@@ -310,29 +342,25 @@ TEST_CASE("cursor_down", "[view]") {
 
     SECTION("Already at bottom-most row in file") {
         Controller c;
-        auto m = Model(
-            open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
         auto v = View(&c, rawterm::Pos(24, 80));
-        v.add_model(&m);
+        Model& m = add_model(v, "tests/fixture/lorem_ipsum.txt");
 
-        for (unsigned int i = 1; i < m.buf.size(); i++) {
+        for (unsigned int i = 1; i < m.buf->size(); i++) {
             v.cursor_down();
         }
 
         REQUIRE(v.cur == rawterm::Pos(22, 1));
-        REQUIRE(m.current_line == m.buf.size() - 1);
+        REQUIRE(m.current_line == m.buf->size() - 1);
 
         v.cursor_down();
         REQUIRE(v.cur == rawterm::Pos(22, 1));
-        REQUIRE(m.current_line == m.buf.size() - 1);
+        REQUIRE(m.current_line == m.buf->size() - 1);
     }
 
     SECTION("bottom row of file within view (no scrolling required)") {
         Controller c;
-        auto m = Model(
-            open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
         auto v = View(&c, rawterm::Pos(24, 80));
-        v.add_model(&m);
+        Model& m = add_model(v, "tests/fixture/test_file_1.txt");
 
         // Move to end of file
         v.cursor_down();
@@ -351,9 +379,7 @@ TEST_CASE("cursor_right", "[view]") {
     SECTION("Already at right-most position in view") {
         Controller c;
         auto v = View(&c, rawterm::Pos(24, 80));
-        auto m = Model(
-            open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
-        v.add_model(&m);
+        add_model(v, "tests/fixture/test_file_1.txt");
         v.cur.move({v.cur.vertical, int(v.line_number_offset + 1)});
 
         v.cursor_right(80);
@@ -365,9 +391,7 @@ TEST_CASE("cursor_right", "[view]") {
     SECTION("Already at right-most position in line") {
         Controller c;
         auto v = View(&c, rawterm::Pos(24, 80));
-        auto m = Model(
-            open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
-        v.add_model(&m);
+        Model& m = add_model(v, "tests/fixture/test_file_1.txt");
         v.cur.move({v.cur.vertical, int(v.line_number_offset + 1)});
 
         v.cursor_right(99);
@@ -378,9 +402,7 @@ TEST_CASE("cursor_right", "[view]") {
     SECTION("Move right") {
         Controller c;
         auto v = View(&c, rawterm::Pos(24, 80));
-        auto m = Model(
-            open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
-        v.add_model(&m);
+        add_model(v, "tests/fixture/test_file_1.txt");
 
         v.cursor_right(1);
         REQUIRE(v.cur == rawterm::Pos(1, 2));
@@ -390,9 +412,7 @@ TEST_CASE("cursor_right", "[view]") {
 TEST_CASE("cursor_end_of_line", "[view]") {
     Controller c;
     auto v = View(&c, rawterm::Pos(24, 80));
-    auto m =
-        Model(open_file("tests/fixture/test_file_1.txt").value(), "tests/fixture/test_file_1.txt");
-    v.add_model(&m);
+    add_model(v, "tests/fixture/test_file_1.txt");
 
     REQUIRE(v.cur == rawterm::Pos(1, 1));
     v.cursor_end_of_line();
@@ -403,9 +423,7 @@ TEST_CASE("center_current_line", "[view]") {
     SECTION("Do nothing if current line is already near the top") {
         Controller c;
         auto v = View(&c, rawterm::Pos(24, 80));
-        auto m = Model(
-            open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
-        v.add_model(&m);
+        Model& m = add_model(v, "tests/fixture/lorem_ipsum.txt");
 
         // Initial state
         REQUIRE(m.current_line == 0);
@@ -423,9 +441,7 @@ TEST_CASE("center_current_line", "[view]") {
     SECTION("Center the view when current line is far down") {
         Controller c;
         auto v = View(&c, rawterm::Pos(24, 80));
-        auto m = Model(
-            open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
-        v.add_model(&m);
+        Model& m = add_model(v, "tests/fixture/lorem_ipsum.txt");
 
         // Move cursor far down
         for (int i = 0; i < 30; i++) {
@@ -451,9 +467,7 @@ TEST_CASE("center_current_line", "[view]") {
 TEST_CASE("set_current_line", "[view]") {
     Controller c;
     auto v = View(&c, rawterm::Pos(24, 80));
-    auto m =
-        Model(open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
-    v.add_model(&m);
+    Model& m = add_model(v, "tests/fixture/lorem_ipsum.txt");
 
     SECTION("Move cursor to line already on screen") {
         v.set_current_line(20);
@@ -483,9 +497,7 @@ TEST_CASE("set_current_line", "[view]") {
 TEST_CASE("tab_new", "[view]") {
     Controller c;
     auto v = View(&c, rawterm::Pos(24, 80));
-    auto m =
-        Model(open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
-    v.add_model(&m);
+    add_model(v, "tests/fixture/lorem_ipsum.txt");
 
     v.tab_new();
 
@@ -494,15 +506,13 @@ TEST_CASE("tab_new", "[view]") {
 
     Model* active_model = v.get_active_model();
     REQUIRE(active_model->filename == "NO NAME");
-    REQUIRE(active_model->buf.size() == 1);
+    REQUIRE(active_model->buf->size() == 1);
 }
 
 TEST_CASE("tab_next", "[view]") {
     Controller c;
     auto v = View(&c, rawterm::Pos(24, 80));
-    auto m =
-        Model(open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
-    v.add_model(&m);
+    add_model(v, "tests/fixture/lorem_ipsum.txt");
 
     v.tab_new();
     v.tab_next();
@@ -517,9 +527,7 @@ TEST_CASE("tab_next", "[view]") {
 TEST_CASE("tab_prev", "[view]") {
     Controller c;
     auto v = View(&c, rawterm::Pos(24, 80));
-    auto m =
-        Model(open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
-    v.add_model(&m);
+    add_model(v, "tests/fixture/lorem_ipsum.txt");
 
     v.tab_new();
     v.tab_prev();
@@ -534,9 +542,7 @@ TEST_CASE("tab_prev", "[view]") {
 TEST_CASE("visible_tab_bar", "[view]") {
     Controller c;
     auto v = View(&c, rawterm::Pos(24, 80));
-    auto m =
-        Model(open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
-    v.add_model(&m);
+    add_model(v, "tests/fixture/lorem_ipsum.txt");
 
     REQUIRE(v.visible_tab_bar() == 0);
     v.tab_new();
@@ -548,9 +554,7 @@ TEST_CASE("visible_tab_bar", "[view]") {
 TEST_CASE("set_lineno_offset", "[view]") {
     Controller c;
     auto v = View(&c, rawterm::Pos(24, 80));
-    auto m =
-        Model(open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
-    v.add_model(&m);
+    Model& m = add_model(v, "tests/fixture/lorem_ipsum.txt");
     unsigned int ret = v.set_lineno_offset(&m);
 
     REQUIRE(ret == 3);
@@ -564,9 +568,7 @@ TEST_CASE("set_lineno_offset", "[view]") {
 TEST_CASE("change_model_cursor", "[view]") {
     Controller c;
     auto v = View(&c, rawterm::Pos(24, 80));
-    auto m =
-        Model(open_file("tests/fixture/lorem_ipsum.txt").value(), "tests/fixture/lorem_ipsum.txt");
-    v.add_model(&m);
+    add_model(v, "tests/fixture/lorem_ipsum.txt");
 
     v.cursor_right(5);
 
@@ -591,9 +593,10 @@ TEST_CASE("set_buffer", "[view]") {
     REQUIRE(c.models.size() == 2);
     REQUIRE(c.view.get_active_model()->current_line == 5);
 
-    c.view.set_buffer(0, c.models.size());
-    REQUIRE(c.view.view_models.at(0)->filename == "tests/fixture/lorem_ipsum.txt");
+    REQUIRE(c.view.set_buffer(0));
+    REQUIRE(c.view.get_active_model()->filename == "tests/fixture/lorem_ipsum.txt");
     REQUIRE(c.view.get_active_model()->current_line == 0);
+    REQUIRE(!c.view.set_buffer(2));
 }
 
 TEST_CASE("render_cursor_coords", "[view]") {
@@ -611,3 +614,24 @@ TEST_CASE("render_cursor_coords", "[view]") {
     std::size_t second_bg = statusbar.substr(first_bg, statusbar.size()).find(COLOR_UI_BG.to_str());
     REQUIRE(second_bg != std::string::npos);
 }
+
+TEST_CASE("Moving a line is undone in one step", "[view]") {
+    Controller c;
+    auto v = View(&c, rawterm::Pos(24, 80));
+    Model& m = add_model(v, Model({"one", "two", "three"}, ""));
+    m.current_line = 1;
+
+    parse_action<void, None>(&v, Action<void> {ActionType::MoveLineDown});
+    REQUIRE(m.buf->to_vector() == lines_t {"one", "three", "two"});
+    parse_action<void, None>(&v, Action<void> {ActionType::MoveLineUp});
+    parse_action<void, None>(&v, Action<void> {ActionType::MoveLineUp});
+    REQUIRE(m.buf->to_vector() == lines_t {"two", "one", "three"});
+
+    REQUIRE(m.undo(24));
+    REQUIRE(m.buf->to_vector() == lines_t {"one", "two", "three"});
+    REQUIRE(m.undo(24));
+    REQUIRE(m.buf->to_vector() == lines_t {"one", "three", "two"});
+    REQUIRE(m.undo(24));
+    REQUIRE(m.buf->to_vector() == lines_t {"one", "two", "three"});
+    REQUIRE_FALSE(m.undo(24));
+}